@@ -34,6 +34,10 @@ typedef unsigned __int64 uint64_t;
 #include <cassert>
 #include <cstddef>
 #include <cstring>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
 
 #define OTS_TAG(c1,c2,c3,c4) ((uint32_t)((((uint8_t)(c1))<<24)|(((uint8_t)(c2))<<16)|(((uint8_t)(c3))<<8)|((uint8_t)(c4))))
 #define OTS_UNTAG(tag)       ((char)((tag)>>24)), ((char)((tag)>>16)), ((char)((tag)>>8)), ((char)(tag))
@@ -48,6 +52,51 @@ typedef unsigned __int64 uint64_t;
 
 namespace ots {
 
+// -----------------------------------------------------------------------------
+// Table checksums: the sum, modulo 2^32, of the data read as big-endian 32-bit
+// words. Long runs of words are summed with SIMD instructions when the CPU
+// has them.
+// -----------------------------------------------------------------------------
+
+// Returns the checksum of the |num_words| 32-bit words at |data|.
+uint32_t ChecksumWords(const void *data, size_t num_words);
+
+// Same as ChecksumWords(), but also copies the words to |dest|.
+uint32_t CopyAndChecksumWords(void *dest, const void *data, size_t num_words);
+
+// Same as Checksum() below, which calls this for data long enough to be worth
+// handing to the SIMD code.
+uint32_t ChecksumLarge(const void *data, size_t length, size_t position,
+                       void *dest);
+
+// Returns what |length| bytes of |data| add to the checksum of a table when
+// written at |position| in it. If |dest| is not NULL, they are also copied
+// there.
+inline uint32_t Checksum(const void *data, size_t length, size_t position = 0,
+                         void *dest = NULL) {
+  if (length >= 256) {
+    return ChecksumLarge(data, length, position, dest);
+  }
+  if (dest) {
+    std::memcpy(dest, data, length);
+  }
+  const uint8_t *src = static_cast<const uint8_t*>(data);
+  uint32_t sum = 0;
+  size_t i = 0;
+  for (; i < length && ((position + i) & 3); ++i) {
+    sum += static_cast<uint32_t>(src[i]) << (8 * (3 - ((position + i) & 3)));
+  }
+  for (; i + 4 <= length; i += 4) {
+    uint32_t word;
+    std::memcpy(&word, src + i, sizeof(uint32_t));
+    sum += ots_ntohl(word);
+  }
+  for (; i < length; ++i) {
+    sum += static_cast<uint32_t>(src[i]) << (8 * (3 - ((position + i) & 3)));
+  }
+  return sum;
+}
+
 // -----------------------------------------------------------------------------
 // This is an interface for an abstract stream class which is used for writing
 // the serialised results out.
@@ -63,40 +112,61 @@ class OTSStream {
   // This should be implemented to perform the actual write.
   virtual bool WriteRaw(const void *data, size_t length) = 0;
 
-  bool Write(const void *data, size_t length) {
-    if (!length) return false;
-
-    const size_t orig_length = length;
-    size_t offset = 0;
-
-    size_t chksum_offset = Tell() & 3;
-    if (chksum_offset) {
-      const size_t l = std::min(length, static_cast<size_t>(4) - chksum_offset);
-      uint32_t tmp = 0;
-      std::memcpy(reinterpret_cast<uint8_t *>(&tmp) + chksum_offset, data, l);
-      chksum_ += ots_ntohl(tmp);
-      length -= l;
-      offset += l;
+  // A piece of data to write with WriteV(): its address and its length.
+  typedef std::pair<const uint8_t*, size_t> Segment;
+
+  // This can be overridden to write several pieces of data in one go, e.g.
+  // with a single reservation, instead of calling WriteRaw() for each.
+  // |total_length| is the sum of their lengths.
+  virtual bool WriteRawV(const Segment *segments, size_t count,
+                         size_t total_length OTS_UNUSED) {
+    for (size_t i = 0; i < count; ++i) {
+      if (segments[i].second &&
+          !WriteRaw(segments[i].first, segments[i].second)) {
+        return false;
+      }
     }
+    return true;
+  }
 
-    while (length >= 4) {
-      uint32_t tmp;
-      std::memcpy(&tmp, reinterpret_cast<const uint8_t *>(data) + offset,
-        sizeof(uint32_t));
-      chksum_ += ots_ntohl(tmp);
-      length -= 4;
-      offset += 4;
+  // These write data as WriteRaw() and WriteRawV() do, and add it to the
+  // checksum. Streams that copy the data into memory can override them to
+  // compute the checksum while copying it (see ots::Checksum()).
+  virtual bool WriteRawAndChecksum(const void *data, size_t length) {
+    chksum_ += Checksum(data, length, Tell());
+    return WriteRaw(data, length);
+  }
+
+  virtual bool WriteRawVAndChecksum(const Segment *segments, size_t count,
+                                    size_t total_length) {
+    size_t position = Tell();
+    for (size_t i = 0; i < count; ++i) {
+      chksum_ += Checksum(segments[i].first, segments[i].second, position);
+      position += segments[i].second;
     }
+    return WriteRawV(segments, count, total_length);
+  }
+
+  bool Write(const void *data, size_t length) {
+    if (!length) return false;
 
-    if (length) {
-      if (length > 4) return false;  // not reached
-      uint32_t tmp = 0;
-      std::memcpy(&tmp,
-                  reinterpret_cast<const uint8_t*>(data) + offset, length);
-      chksum_ += ots_ntohl(tmp);
+    return WriteRawAndChecksum(data, length);
+  }
+
+  // Writes |count| pieces of data one after the other, as Write() would for
+  // each of them, but with a single call to WriteRawV().
+  bool WriteV(const Segment *segments, size_t count) {
+    size_t total_length = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const size_t length = segments[i].second;
+      if (length > std::numeric_limits<size_t>::max() - total_length) {
+        return false;
+      }
+      total_length += length;
     }
+    if (!total_length) return false;
 
-    return WriteRaw(data, orig_length);
+    return WriteRawVAndChecksum(segments, count, total_length);
   }
 
   virtual bool Seek(off_t position) = 0;
@@ -168,6 +238,141 @@ class OTSStream {
 #define MSGFUNC_FMT_ATTR
 #endif
 
+// -----------------------------------------------------------------------------
+// This is an interface for an abstract executor which OTS can use to run
+// independent pieces of work (e.g. the parsing of unrelated tables)
+// concurrently. See ots-thread-pool.h for a simple implementation.
+// -----------------------------------------------------------------------------
+class OTSExecutor {
+ public:
+  virtual ~OTSExecutor() {}
+
+  // Run |task| once, on any thread. OTS never blocks waiting for a particular
+  // task to be started, so an executor with a single thread (or one that is
+  // shared with other work) is fine.
+  virtual void Run(const std::function<void()>& task) = 0;
+};
+
+// -----------------------------------------------------------------------------
+// This is an interface for an abstract allocator which OTS can use for the
+// buffers it needs while processing a font (e.g. decompressed tables). Memory
+// is never freed piece by piece: all of it is released at once, at the end of
+// OTSContext::Process().
+// -----------------------------------------------------------------------------
+class OTSAllocator {
+ public:
+  virtual ~OTSAllocator() {}
+
+  // Return |length| bytes, suitably aligned for any type, or NULL on
+  // failure. This may be called from several threads at once if the context
+  // has an executor.
+  virtual void* Allocate(size_t length) = 0;
+
+  // Called at the end of Process(), or once the plan made by Plan() is
+  // destroyed or used for another font: nothing returned by Allocate() until
+  // then is used any more.
+  virtual void Release() = 0;
+};
+
+// -----------------------------------------------------------------------------
+// This is an interface for an observer which OTS tells about each table it
+// processes, e.g. to find out which tables take most of the time. The
+// conversion of a WOFF 2.0 font to an sfnt is reported as a table too, tagged
+// 'wOF2'. A table shared by the fonts of a collection is reported once.
+// -----------------------------------------------------------------------------
+class OTSTableObserver {
+ public:
+  virtual ~OTSTableObserver() {}
+
+  // Called before a table is parsed. |input_bytes| is its length in the
+  // input, i.e. compressed in a WOFF font.
+  virtual void OnTableBegin(uint32_t tag, size_t input_bytes) = 0;
+
+  // Called once OTS is done with a table that OnTableBegin() was called for:
+  //   ok: whether the table is in the output
+  //   output_bytes: its length there
+  //   parse_ns: the time taken to decompress and parse it, in nanoseconds
+  //   serialize_ns: the time taken to serialize it
+  // Plan() reports the tables as it measures their output; Emit() does not
+  // report them again.
+  virtual void OnTableEnd(uint32_t tag, bool ok, size_t output_bytes,
+                          uint64_t parse_ns, uint64_t serialize_ns) = 0;
+
+  // Called while a table is parsed with the value of one of the counters its
+  // parser keeps of the work it did, or could skip. Those of the CFF and CFF2
+  // tables, given once their charstrings are found valid, are:
+  //   subr_calls_validated: the subroutine calls executed to validate them
+  //   subr_calls_reused: the calls that were not, as one of the same
+  //                      subroutine in the same state already had been
+  //   subr_calls_shared: those of the reused calls where that subroutine had
+  //                      another number or INDEX (e.g. the local subroutines
+  //                      of another font DICT) but the same charstring
+  // The counts depend on whether the glyphs were validated concurrently.
+  // Those of the GSUB, GPOS, GDEF and MATH tables, given once they have been
+  // parsed, are the number of their Coverage and ClassDef tables
+  // large enough to be looked up among those already found valid, and how
+  // many were found there:
+  //   coverage_lookups, coverage_hits
+  //   class_def_lookups, class_def_hits
+  virtual void OnTableCounter(uint32_t tag OTS_UNUSED,
+                              const char *name OTS_UNUSED,
+                              uint64_t value OTS_UNUSED) {}
+};
+
+// -----------------------------------------------------------------------------
+// A session keeps the memory OTS needs while processing a font (decompressed
+// tables, and the scratch buffers of the table parsers) from one
+// OTSContext::Process() call to the next, so that once it has seen a few fonts
+// sanitizing another one hardly allocates at all. It can be shared by any
+// number of contexts, as long as only one Process() call uses it at a time
+// (an OTSPlan counts as one until it is destroyed).
+// -----------------------------------------------------------------------------
+class OTSSession {
+ public:
+  OTSSession();
+  ~OTSSession();
+
+  // Frees all the memory kept so far.
+  void Reset();
+
+ private:
+  friend class OTSContext;
+
+  OTSSession(const OTSSession&);
+  void operator=(const OTSSession&);
+
+  struct State;
+  State *state_;
+};
+
+// -----------------------------------------------------------------------------
+// A font parsed and checked by OTSContext::Plan(), which knows the exact size
+// of its sanitized version, so that the caller can allocate room for it before
+// OTSContext::Emit() writes it out. It refers to the input given to Plan(),
+// which must outlive it, and keeps the memory (and session) of the context
+// until it is destroyed.
+// -----------------------------------------------------------------------------
+class OTSPlan {
+ public:
+  OTSPlan();
+  ~OTSPlan();
+
+  // The number of bytes Emit() writes, or zero if the font could not be
+  // sanitized.
+  size_t size() const;
+
+ private:
+  friend class OTSContext;
+
+  OTSPlan(const OTSPlan&);
+  void operator=(const OTSPlan&);
+
+  struct State;
+  State *state_;
+};
+
+struct FontFile;
+
 enum TableAction {
   TABLE_ACTION_DEFAULT,  // Use OTS's default action for that table
   TABLE_ACTION_SANITIZE, // Sanitize the table, potentially dropping it
@@ -177,6 +382,43 @@ enum TableAction {
                               // sanitzation even if this table fails/is dropped
 };
 
+// The outcome of OTSContext::Validate().
+struct ValidationResult {
+  ValidationResult()
+      : ok(false),
+        failed_table(0),
+        num_tables(0),
+        num_dropped_tables(0) {
+  }
+
+  // Whether Process() would sanitize the font successfully.
+  bool ok;
+  // The tag of the table that made it fail, or zero if it failed for another
+  // reason (e.g. a bad table directory) or did not fail.
+  uint32_t failed_table;
+  // The number of tables the sanitized font would have, and of tables of the
+  // input that it would not. For a collection, these are summed over all of
+  // its fonts.
+  uint32_t num_tables;
+  uint32_t num_dropped_tables;
+};
+
+// The glyphs a font sanitized by OTS is to keep, as returned by
+// OTSContext::GetGlyphSubset(). Glyph 0 is always kept, and so are the
+// components of the glyf glyphs kept; glyphs only reached through layout
+// tables (e.g. ligatures) have to be listed, as do the base and accent glyphs
+// of the CFF glyphs kept that are made with seac, which OTS warns about. The
+// glyphs keep their ids: the others are left empty, their CFF charstrings
+// reduced to the least there can be, and the cmap and post entries mapping to
+// them are removed.
+struct GlyphSubset {
+  // Glyph ids to keep. Those past the last glyph of the font are ignored.
+  std::vector<uint32_t> glyph_ids;
+  // Unicode code points whose glyphs, as the cmap of the font maps them
+  // (including its Unicode variation sequences), are to be kept.
+  std::vector<uint32_t> code_points;
+};
+
 class OTSContext {
   public:
     OTSContext() {}
@@ -193,6 +435,21 @@ class OTSContext {
     //     collection. Ignored for non-collection fonts.
     bool Process(OTSStream *output, const uint8_t *input, size_t length, uint32_t index = -1);
 
+    // Check a given OpenType file as Process() does, without writing out the
+    // sanitized version: every table is parsed, checked and serialized, but
+    // into a stream that discards it, and no checksums, padding or table
+    // directory are computed. The arguments are those of Process().
+    ValidationResult Validate(const uint8_t *input, size_t length, uint32_t index = -1);
+
+    // Sanitize a given OpenType file in two steps, for callers that want to
+    // allocate the output once: Plan() parses and checks it as Process()
+    // does, keeping the result in |plan|, and returns the exact size of the
+    // sanitized version (zero on failure); Emit() then writes it out, e.g. to
+    // a MemoryStream of that size. The output is the same as that of
+    // Process(). The other arguments of Plan() are those of Process().
+    size_t Plan(OTSPlan *plan, const uint8_t *input, size_t length, uint32_t index = -1);
+    bool Emit(OTSPlan *plan, OTSStream *output);
+
     // This function will be called when OTS is reporting an error.
     //   level: the severity of the generated message:
     //     0: error messages in case OTS fails to sanitize the font.
@@ -203,6 +460,51 @@ class OTSContext {
     // font table.
     //   tag: table tag formed with OTS_TAG() macro
     virtual TableAction GetTableAction(uint32_t tag OTS_UNUSED) { return ots::TABLE_ACTION_DEFAULT; }
+
+    // This function will be called when OTS starts processing a font, to find
+    // out whether it may do some of the work concurrently. If an executor is
+    // returned, tables that do not depend on each other are parsed in
+    // parallel, as are the fonts of a collection (tables they share are still
+    // parsed once) and ranges of the glyphs of large glyf, CFF and CFF2
+    // tables; the sanitized output is identical to that of the serial path.
+    // Note that Message() and GetTableAction() may then be called from the
+    // executor's threads (possibly at the same time), and that the order of
+    // messages is not deterministic, although those about any one table
+    // still come in order.
+    virtual OTSExecutor* GetExecutor() { return NULL; }
+
+    // This function will be called when OTS starts processing a font, to get
+    // the allocator for the memory it needs while doing so. If none is
+    // returned, OTS uses a bump allocator of its own for each Process() call,
+    // which it frees in one go when done.
+    virtual OTSAllocator* GetAllocator() { return NULL; }
+
+    // This function will be called when OTS starts processing a font, to get
+    // the session whose memory it should reuse. If an allocator is returned by
+    // GetAllocator() as well, the session only provides the scratch buffers.
+    virtual OTSSession* GetSession() { return NULL; }
+
+    // This function will be called when OTS starts processing a font, to get
+    // the observer to tell about each table. Its methods may be called from
+    // the executor's threads, if there is one. Nothing is measured if none is
+    // returned.
+    virtual OTSTableObserver* GetTableObserver() { return NULL; }
+
+    // This function will be called when OTS starts processing a font, to find
+    // out which of its glyphs to keep. If a subset is returned, the glyph
+    // data of the other glyphs is removed from the sanitized font, instead of
+    // running a subsetter on it afterwards. It is not applied to the whole of
+    // a collection, whose fonts can share their glyphs, only to a font taken
+    // out of one with |index|.
+    virtual const GlyphSubset* GetGlyphSubset() { return NULL; }
+
+  private:
+    // Where |header| gets its memory from, if not from |default_allocator|.
+    void SetUpFontFile(FontFile *header, OTSAllocator *default_allocator);
+
+    // Process() if |validation| is NULL, Validate() otherwise.
+    bool DoProcess(OTSStream *output, const uint8_t *input, size_t length,
+                   uint32_t index, ValidationResult *validation);
 };
 
 }  // namespace ots
@@ -5,8 +5,10 @@
 #ifndef OTS_MEMORY_STREAM_H_
 #define OTS_MEMORY_STREAM_H_
 
+#include <algorithm>
 #include <cstring>
 #include <limits>
+#include <vector>
 
 #include "opentype-sanitiser.h"
 
@@ -30,6 +32,45 @@ class MemoryStream : public OTSStream {
     return true;
   }
 
+  bool WriteRawV(const Segment *segments, size_t count,
+                 size_t total_length) override {
+    if ((off_ + total_length > length_) ||
+        (total_length > std::numeric_limits<size_t>::max() - off_)) {
+      return false;
+    }
+    char *dest = static_cast<char*>(ptr_) + off_;
+    for (size_t i = 0; i < count; ++i) {
+      std::memcpy(dest, segments[i].first, segments[i].second);
+      dest += segments[i].second;
+    }
+    off_ += static_cast<off_t>(total_length);
+    return true;
+  }
+
+  bool WriteRawAndChecksum(const void *data, size_t length) override {
+    if ((off_ + length > length_) ||
+        (length > std::numeric_limits<size_t>::max() - off_)) {
+      return false;
+    }
+    chksum_ += Checksum(data, length, off_, static_cast<char*>(ptr_) + off_);
+    off_ += static_cast<off_t>(length);
+    return true;
+  }
+
+  bool WriteRawVAndChecksum(const Segment *segments, size_t count,
+                            size_t total_length) override {
+    if ((off_ + total_length > length_) ||
+        (total_length > std::numeric_limits<size_t>::max() - off_)) {
+      return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      chksum_ += Checksum(segments[i].first, segments[i].second, off_,
+                          static_cast<char*>(ptr_) + off_);
+      off_ += static_cast<off_t>(segments[i].second);
+    }
+    return true;
+  }
+
   bool Seek(off_t position) override {
     if (position < 0) return false;
     if (static_cast<size_t>(position) > length_) return false;
@@ -65,8 +106,63 @@ class ExpandingMemoryStream : public OTSStream {
   size_t size() override { return limit_; }
 
   bool WriteRaw(const void *data, size_t length) override {
-    if ((off_ + length > length_) ||
-        (length > std::numeric_limits<size_t>::max() - off_)) {
+    if (!Reserve(length))
+      return false;
+    std::memcpy(static_cast<char*>(ptr_) + off_, data, length);
+    off_ += static_cast<off_t>(length);
+    return true;
+  }
+
+  bool WriteRawV(const Segment *segments, size_t count,
+                 size_t total_length) override {
+    if (!Reserve(total_length))
+      return false;
+    char *dest = static_cast<char*>(ptr_) + off_;
+    for (size_t i = 0; i < count; ++i) {
+      std::memcpy(dest, segments[i].first, segments[i].second);
+      dest += segments[i].second;
+    }
+    off_ += static_cast<off_t>(total_length);
+    return true;
+  }
+
+  bool WriteRawAndChecksum(const void *data, size_t length) override {
+    if (!Reserve(length))
+      return false;
+    chksum_ += Checksum(data, length, off_, static_cast<char*>(ptr_) + off_);
+    off_ += static_cast<off_t>(length);
+    return true;
+  }
+
+  bool WriteRawVAndChecksum(const Segment *segments, size_t count,
+                            size_t total_length) override {
+    if (!Reserve(total_length))
+      return false;
+    for (size_t i = 0; i < count; ++i) {
+      chksum_ += Checksum(segments[i].first, segments[i].second, off_,
+                          static_cast<char*>(ptr_) + off_);
+      off_ += static_cast<off_t>(segments[i].second);
+    }
+    return true;
+  }
+
+  bool Seek(off_t position) override {
+    if (position < 0) return false;
+    if (static_cast<size_t>(position) > length_) return false;
+    off_ = position;
+    return true;
+  }
+
+  off_t Tell() const override {
+    return off_;
+  }
+
+ private:
+  // Grows the buffer, up to |limit_|, until |length| more bytes fit at the
+  // current offset.
+  bool Reserve(size_t length) {
+    while ((off_ + length > length_) ||
+           (length > std::numeric_limits<size_t>::max() - off_)) {
       if (length_ == limit_)
         return false;
       size_t new_length = (length_ + 1) * 2;
@@ -79,17 +175,102 @@ class ExpandingMemoryStream : public OTSStream {
       length_ = new_length;
       delete[] static_cast<uint8_t*>(ptr_);
       ptr_ = new_buf;
-      return WriteRaw(data, length);
     }
-    std::memcpy(static_cast<char*>(ptr_) + off_, data, length);
-    off_ += static_cast<off_t>(length);
+    return true;
+  }
+
+  void* ptr_;
+  size_t length_;
+  const size_t limit_;
+  off_t off_;
+};
+
+// A stream that keeps what is written to it in chunks of a fixed size, which
+// never move once allocated: unlike ExpandingMemoryStream, it never copies
+// what was written so far to grow. Seeking back, as is done to fill in the
+// table directory and the checksums, patches the chunks in place, and seeking
+// past the end is allowed, the bytes skipped being zeros.
+class ChunkedMemoryStream : public OTSStream {
+ public:
+  static const size_t kDefaultChunkSize = 64 * 1024;
+
+  explicit ChunkedMemoryStream(size_t limit,
+                               size_t chunk_size = kDefaultChunkSize)
+      : limit_(limit),
+        chunk_size_(chunk_size ? chunk_size : 1),
+        off_(0),
+        end_(0) {
+  }
+
+  ~ChunkedMemoryStream() {
+    for (uint8_t *chunk : chunks_)
+      delete[] chunk;
+  }
+
+  // The number of bytes of output, i.e. the furthest point written or sought
+  // to.
+  size_t length() const { return end_; }
+
+  // The output, in pieces that can be handed to writev() or a socket as they
+  // are, without copying them into one buffer first.
+  std::vector<Segment> Segments() const {
+    std::vector<Segment> segments;
+    for (size_t offset = 0; offset < end_; offset += chunk_size_) {
+      segments.push_back(Segment(chunks_[offset / chunk_size_],
+                                 std::min(chunk_size_, end_ - offset)));
+    }
+    return segments;
+  }
+
+  // Copies the output to |dest|, which must have room for length() bytes.
+  void CopyTo(void *dest) const {
+    uint8_t *out = static_cast<uint8_t*>(dest);
+    for (const Segment &segment : Segments()) {
+      std::memcpy(out, segment.first, segment.second);
+      out += segment.second;
+    }
+  }
+
+  size_t size() override { return limit_; }
+
+  bool WriteRaw(const void *data, size_t length) override {
+    if (!Reserve(length))
+      return false;
+    Copy(data, length, false);
+    return true;
+  }
+
+  bool WriteRawV(const Segment *segments, size_t count,
+                 size_t total_length) override {
+    if (!Reserve(total_length))
+      return false;
+    for (size_t i = 0; i < count; ++i)
+      Copy(segments[i].first, segments[i].second, false);
+    return true;
+  }
+
+  bool WriteRawAndChecksum(const void *data, size_t length) override {
+    if (!Reserve(length))
+      return false;
+    Copy(data, length, true);
+    return true;
+  }
+
+  bool WriteRawVAndChecksum(const Segment *segments, size_t count,
+                            size_t total_length) override {
+    if (!Reserve(total_length))
+      return false;
+    for (size_t i = 0; i < count; ++i)
+      Copy(segments[i].first, segments[i].second, true);
     return true;
   }
 
   bool Seek(off_t position) override {
     if (position < 0) return false;
-    if (static_cast<size_t>(position) > length_) return false;
+    if (static_cast<size_t>(position) > limit_) return false;
     off_ = position;
+    Reserve(0);
+    end_ = std::max(end_, off_);
     return true;
   }
 
@@ -98,10 +279,43 @@ class ExpandingMemoryStream : public OTSStream {
   }
 
  private:
-  void* ptr_;
-  size_t length_;
+  // Allocates chunks, up to |limit_|, until |length| more bytes fit at the
+  // current offset.
+  bool Reserve(size_t length) {
+    if (length > limit_ || off_ > limit_ - length)
+      return false;
+    while (chunks_.size() * chunk_size_ < off_ + length)
+      chunks_.push_back(new uint8_t[chunk_size_]());
+    return true;
+  }
+
+  // Copies |length| bytes, for which there is room, to the current offset,
+  // adding them to the checksum if |checksum| is set.
+  void Copy(const void *data, size_t length, bool checksum) {
+    const uint8_t *src = static_cast<const uint8_t*>(data);
+    while (length) {
+      const size_t offset = off_ % chunk_size_;
+      const size_t n = std::min(length, chunk_size_ - offset);
+      uint8_t *dest = chunks_[off_ / chunk_size_] + offset;
+      if (checksum)
+        chksum_ += Checksum(src, n, off_, dest);
+      else
+        std::memcpy(dest, src, n);
+      src += n;
+      length -= n;
+      off_ += n;
+    }
+    end_ = std::max(end_, off_);
+  }
+
+  ChunkedMemoryStream(const ChunkedMemoryStream&);
+  void operator=(const ChunkedMemoryStream&);
+
   const size_t limit_;
-  off_t off_;
+  const size_t chunk_size_;
+  std::vector<uint8_t*> chunks_;
+  size_t off_;
+  size_t end_;
 };
 
 }  // namespace ots
@@ -0,0 +1,79 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OTS_THREAD_POOL_H_
+#define OTS_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "opentype-sanitiser.h"
+
+namespace ots {
+
+// A fixed-size pool of worker threads implementing OTSExecutor. One pool can
+// be shared by any number of OTSContext objects and threads.
+class ThreadPool : public OTSExecutor {
+ public:
+  explicit ThreadPool(unsigned num_threads)
+      : stopping_(false) {
+    if (!num_threads)
+      num_threads = 1;
+    for (unsigned i = 0; i < num_threads; ++i) {
+      threads_.push_back(std::thread(&ThreadPool::Work, this));
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cond_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Run(const std::function<void()>& task) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(task);
+    }
+    cond_.notify_one();
+  }
+
+  size_t size() const { return threads_.size(); }
+
+ private:
+  void Work() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_ && tasks_.empty())
+          cond_.wait(lock);
+        if (tasks_.empty())
+          return;
+        task = tasks_.front();
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()> > tasks_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stopping_;
+};
+
+}  // namespace ots
+
+#endif  // OTS_THREAD_POOL_H_
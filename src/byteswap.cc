@@ -0,0 +1,191 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ots.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OTS_BYTESWAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+    !defined(__ARM_BIG_ENDIAN)
+#define OTS_BYTESWAP_NEON
+#include <arm_neon.h>
+#endif
+
+// Converting arrays of big-endian values to the host's byte order, or
+// checking their order, 16 bytes at a time where the CPU can, then one value
+// at a time for the rest.
+
+namespace {
+
+#ifdef OTS_BYTESWAP_SSE2
+// Swaps the bytes of each 16-bit value of |v|.
+inline __m128i ByteSwap16(__m128i v) {
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+// Swaps the bytes of each 32-bit value of |v|: the 16-bit halves of each
+// value, then the bytes of each half.
+inline __m128i ByteSwap32(__m128i v) {
+  return ByteSwap16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1));
+}
+#endif
+
+}  // namespace
+
+namespace ots {
+
+void LoadBigEndianU16(uint16_t *dest, const uint8_t *src, size_t count) {
+  size_t i = 0;
+#if defined(OTS_BYTESWAP_SSE2)
+  for (; i + 8 <= count; i += 8) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), ByteSwap16(v));
+  }
+#elif defined(OTS_BYTESWAP_NEON)
+  for (; i + 8 <= count; i += 8) {
+    vst1q_u16(dest + i, vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + i * 2))));
+  }
+#endif
+  for (; i < count; ++i) {
+    uint16_t value;
+    std::memcpy(&value, src + i * 2, sizeof(uint16_t));
+    dest[i] = ots_ntohs(value);
+  }
+}
+
+void LoadBigEndianU16(uint32_t *dest, const uint8_t *src, size_t count) {
+  size_t i = 0;
+#if defined(OTS_BYTESWAP_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= count; i += 8) {
+    const __m128i v = ByteSwap16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_unpacklo_epi16(v, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 4),
+                     _mm_unpackhi_epi16(v, zero));
+  }
+#elif defined(OTS_BYTESWAP_NEON)
+  for (; i + 8 <= count; i += 8) {
+    const uint16x8_t v =
+        vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + i * 2)));
+    vst1q_u32(dest + i, vmovl_u16(vget_low_u16(v)));
+    vst1q_u32(dest + i + 4, vmovl_u16(vget_high_u16(v)));
+  }
+#endif
+  for (; i < count; ++i) {
+    uint16_t value;
+    std::memcpy(&value, src + i * 2, sizeof(uint16_t));
+    dest[i] = ots_ntohs(value);
+  }
+}
+
+void LoadBigEndianU32(uint32_t *dest, const uint8_t *src, size_t count) {
+  size_t i = 0;
+#if defined(OTS_BYTESWAP_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), ByteSwap32(v));
+  }
+#elif defined(OTS_BYTESWAP_NEON)
+  for (; i + 4 <= count; i += 4) {
+    vst1q_u32(dest + i, vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src + i * 4))));
+  }
+#endif
+  for (; i < count; ++i) {
+    uint32_t value;
+    std::memcpy(&value, src + i * 4, sizeof(uint32_t));
+    dest[i] = ots_ntohl(value);
+  }
+}
+
+bool IsNondecreasingBigEndianU16(const uint8_t *src, size_t count) {
+  size_t i = 0;
+#if defined(OTS_BYTESWAP_SSE2)
+  // Each value is compared with the next one, so the vectors overlap by all
+  // but one value; a value is larger than the next one if subtracting the
+  // next one from it does not saturate to zero.
+  __m128i decreasing = _mm_setzero_si128();
+  for (; i + 9 <= count; i += 8) {
+    const __m128i v = ByteSwap16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+    const __m128i next = ByteSwap16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 2)));
+    decreasing = _mm_or_si128(decreasing, _mm_subs_epu16(v, next));
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(decreasing, _mm_setzero_si128())) !=
+      0xffff) {
+    return false;
+  }
+#elif defined(OTS_BYTESWAP_NEON)
+  uint16x8_t decreasing = vdupq_n_u16(0);
+  for (; i + 9 <= count; i += 8) {
+    const uint16x8_t v =
+        vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + i * 2)));
+    const uint16x8_t next =
+        vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src + i * 2 + 2)));
+    decreasing = vorrq_u16(decreasing, vcgtq_u16(v, next));
+  }
+  const uint64x2_t lanes = vreinterpretq_u64_u16(decreasing);
+  if (vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1)) {
+    return false;
+  }
+#endif
+  for (; i + 1 < count; ++i) {
+    if ((src[i * 2] << 8 | src[i * 2 + 1]) >
+        (src[i * 2 + 2] << 8 | src[i * 2 + 3])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsNondecreasingBigEndianU32(const uint8_t *src, size_t count) {
+  size_t i = 0;
+#if defined(OTS_BYTESWAP_SSE2)
+  // SSE2 only compares signed values, so both sides are flipped by 2^31.
+  const __m128i bias = _mm_set1_epi32(static_cast<int32_t>(0x80000000u));
+  __m128i decreasing = _mm_setzero_si128();
+  for (; i + 5 <= count; i += 4) {
+    const __m128i v = _mm_xor_si128(bias, ByteSwap32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4))));
+    const __m128i next = _mm_xor_si128(bias, ByteSwap32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4 + 4))));
+    decreasing = _mm_or_si128(decreasing, _mm_cmpgt_epi32(v, next));
+  }
+  if (_mm_movemask_epi8(decreasing)) {
+    return false;
+  }
+#elif defined(OTS_BYTESWAP_NEON)
+  uint32x4_t decreasing = vdupq_n_u32(0);
+  for (; i + 5 <= count; i += 4) {
+    const uint32x4_t v =
+        vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src + i * 4)));
+    const uint32x4_t next =
+        vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src + i * 4 + 4)));
+    decreasing = vorrq_u32(decreasing, vcgtq_u32(v, next));
+  }
+  const uint64x2_t lanes = vreinterpretq_u64_u32(decreasing);
+  if (vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1)) {
+    return false;
+  }
+#endif
+  for (; i + 1 < count; ++i) {
+    uint32_t value, next;
+    std::memcpy(&value, src + i * 4, sizeof(uint32_t));
+    std::memcpy(&next, src + i * 4 + 4, sizeof(uint32_t));
+    if (ots_ntohl(value) > ots_ntohl(next)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace ots
@@ -97,9 +97,29 @@ bool ReadOffset(ots::Buffer &table, uint8_t off_size, uint32_t *offset) {
   return true;
 }
 
+// Returns whether none of the offsets of |index| is larger than the next one.
+bool OffsetsNondecreasing(const ots::CFFIndex &index) {
+  const size_t num_offsets = static_cast<size_t>(index.count) + 1;
+  // Offsets of two and four bytes, by far the most common, are checked many
+  // at a time.
+  if (index.off_size == 2) {
+    return ots::IsNondecreasingBigEndianU16(index.offset_array, num_offsets);
+  }
+  if (index.off_size == 4) {
+    return ots::IsNondecreasingBigEndianU32(index.offset_array, num_offsets);
+  }
+  for (size_t i = 1; i < num_offsets; ++i) {
+    if (index.offset(i) < index.offset(i - 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool ParseIndex(ots::Buffer &table, ots::CFFIndex &index, bool cff2 = false) {
   index.off_size = 0;
-  index.offsets.clear();
+  index.offset_array = NULL;
+  index.base_offset = 0;
 
   if (cff2) {
     if (!table.ReadU32(&(index.count))) {
@@ -126,7 +146,13 @@ bool ParseIndex(ots::Buffer &table, ots::CFFIndex &index, bool cff2 = false) {
     return OTS_FAILURE();
   }
 
-  const size_t array_size = (index.count + 1) * index.off_size;
+  // Each offset takes at least a byte, which also keeps the number of them
+  // from overflowing.
+  if (index.count >= table.length()) {
+    return OTS_FAILURE();
+  }
+  const size_t num_offsets = static_cast<size_t>(index.count) + 1;
+  const size_t array_size = num_offsets * index.off_size;
   // less than ((64k + 1) * 4), thus does not overflow.
   const size_t object_data_offset = table.offset() + array_size;
   // does not overflow too, since offset() <= 1GB.
@@ -135,40 +161,38 @@ bool ParseIndex(ots::Buffer &table, ots::CFFIndex &index, bool cff2 = false) {
     return OTS_FAILURE();
   }
 
-  for (unsigned i = 0; i <= index.count; ++i) {  // '<=' is not a typo.
-    uint32_t rel_offset = 0;
-    if (!ReadOffset(table, index.off_size, &rel_offset)) {
-      return OTS_FAILURE();
-    }
-    if (rel_offset < 1) {
-      return OTS_FAILURE();
-    }
-    if (i == 0 && rel_offset != 1) {
-      return OTS_FAILURE();
-    }
-
-    if (rel_offset > table.length()) {
-      return OTS_FAILURE();
-    }
-
-    // does not underflow.
-    if (object_data_offset > table.length() - (rel_offset - 1)) {
-      return OTS_FAILURE();
-    }
+  index.offset_array = table.buffer() + table.offset();
+  if (!table.Skip(array_size)) {
+    return OTS_FAILURE();
+  }
 
-    index.offsets.push_back(
-        object_data_offset + (rel_offset - 1));  // less than length(), 1GB.
+  // The offsets start at 1 and never decrease, so it is enough for the last
+  // one to be within the table for all of them to be.
+  uint32_t first_offset = 0;
+  uint32_t last_offset = 0;
+  ots::Buffer first(index.offset_array, index.off_size);
+  ots::Buffer last(index.offset_array + index.count * index.off_size,
+                   index.off_size);
+  if (!ReadOffset(first, index.off_size, &first_offset) ||
+      !ReadOffset(last, index.off_size, &last_offset)) {
+    return OTS_FAILURE();
+  }
+  if (first_offset != 1) {
+    return OTS_FAILURE();
+  }
+  // does not underflow.
+  if (last_offset - 1 > table.length() - object_data_offset) {
+    return OTS_FAILURE();
   }
+  index.base_offset = object_data_offset - 1;
 
-  for (unsigned i = 1; i < index.offsets.size(); ++i) {
-    // We allow consecutive identical offsets here for zero-length strings.
-    // See http://crbug.com/69341 for more details.
-    if (index.offsets[i] < index.offsets[i - 1]) {
-      return OTS_FAILURE();
-    }
+  // We allow consecutive identical offsets here for zero-length strings.
+  // See http://crbug.com/69341 for more details.
+  if (!OffsetsNondecreasing(index)) {
+    return OTS_FAILURE();
   }
 
-  index.offset_to_next = index.offsets.back();
+  index.offset_to_next = index.offset(index.count);
   return true;
 }
 
@@ -176,13 +200,13 @@ bool ParseNameData(
     ots::Buffer *table, const ots::CFFIndex &index, std::string* out_name) {
   uint8_t name[256] = {0};
 
-  const size_t length = index.offsets[1] - index.offsets[0];
+  const size_t length = index.offset(1) - index.offset(0);
   // font names should be no longer than 127 characters.
   if (length > 127) {
     return OTS_FAILURE();
   }
 
-  table->set_offset(index.offsets[0]);
+  table->set_offset(index.offset(0));
   if (!table->Read(name, length)) {
     return OTS_FAILURE();
   }
@@ -682,9 +706,9 @@ bool ParseDictData(ots::Buffer& table, ots::Buffer& dict,
 bool ParseDictData(ots::Buffer& table, const ots::CFFIndex &index,
                    uint16_t glyphs, size_t sid_max, DICT_DATA_TYPE type,
                    ots::OpenTypeCFF *out_cff) {
-  for (unsigned i = 1; i < index.offsets.size(); ++i) {
-    size_t dict_length = index.offsets[i] - index.offsets[i - 1];
-    ots::Buffer dict(table.buffer() + index.offsets[i - 1], dict_length);
+  for (unsigned i = 1; i <= index.count; ++i) {
+    size_t dict_length = index.offset(i) - index.offset(i - 1);
+    ots::Buffer dict(table.buffer() + index.offset(i - 1), dict_length);
 
     if (!ParseDictData(table, dict, glyphs, sid_max, type, out_cff)) {
       return OTS_FAILURE();
@@ -987,12 +1011,13 @@ bool ParseDictData(ots::Buffer& table, ots::Buffer& dict,
           return OTS_FAILURE();
         }
         if (format == 0) {
+          ots::BufferCursor fd_indices;
+          if (!table.Reserve(glyphs, &fd_indices)) {
+            return OTS_FAILURE();
+          }
+          out_cff->fd_select.resize(glyphs);
           for (uint16_t j = 0; j < glyphs; ++j) {
-            uint8_t fd_index = 0;
-            if (!table.ReadU8(&fd_index)) {
-              return OTS_FAILURE();
-            }
-            (out_cff->fd_select)[j] = fd_index;
+            (out_cff->fd_select)[j] = fd_indices.ReadU8();
           }
         } else if (format == 3) {
           uint16_t n_ranges = 0;
@@ -1022,14 +1047,10 @@ bool ParseDictData(ots::Buffer& table, ots::Buffer& dict,
               return OTS_FAILURE();  // invalid gid.
             }
 
-            // Copy the mapping to |out_cff->fd_select|.
+            // Copy the mapping to |out_cff->fd_select|, which has the
+            // glyphs before |last_gid| already.
             if (j != 0) {
-              for (auto k = last_gid; k < first; ++k) {
-                if (!out_cff->fd_select.insert(
-                        std::make_pair(k, fd_index)).second) {
-                  return OTS_FAILURE();
-                }
-              }
+              out_cff->fd_select.resize(first, fd_index);
             }
 
             if (!table.ReadU8(&fd_index)) {
@@ -1047,12 +1068,7 @@ bool ParseDictData(ots::Buffer& table, ots::Buffer& dict,
           if (sentinel > glyphs) {
             return OTS_FAILURE();  // invalid gid.
           }
-          for (auto k = last_gid; k < sentinel; ++k) {
-            if (!out_cff->fd_select.insert(
-                    std::make_pair(k, fd_index)).second) {
-              return OTS_FAILURE();
-            }
-          }
+          out_cff->fd_select.resize(sentinel, fd_index);
         } else if (cff2 && format == 4) {
           uint32_t n_ranges = 0;
           if (!table.ReadU32(&n_ranges)) {
@@ -1081,14 +1097,10 @@ bool ParseDictData(ots::Buffer& table, ots::Buffer& dict,
               return OTS_FAILURE();  // invalid gid.
             }
 
-            // Copy the mapping to |out_cff->fd_select|.
+            // Copy the mapping to |out_cff->fd_select|, which has the
+            // glyphs before |last_gid| already.
             if (j != 0) {
-              for (auto k = last_gid; k < first; ++k) {
-                if (!out_cff->fd_select.insert(
-                        std::make_pair(k, fd_index)).second) {
-                  return OTS_FAILURE();
-                }
-              }
+              out_cff->fd_select.resize(first, fd_index);
             }
 
             if (!table.ReadU16(&fd_index)) {
@@ -1106,12 +1118,7 @@ bool ParseDictData(ots::Buffer& table, ots::Buffer& dict,
           if (sentinel > glyphs) {
             return OTS_FAILURE();  // invalid gid.
           }
-          for (auto k = last_gid; k < sentinel; ++k) {
-            if (!out_cff->fd_select.insert(
-                    std::make_pair(k, fd_index)).second) {
-              return OTS_FAILURE();
-            }
-          }
+          out_cff->fd_select.resize(sentinel, fd_index);
         } else {
           // unknown format
           return OTS_FAILURE();
@@ -1241,19 +1248,307 @@ bool ParseDictData(ots::Buffer& table, ots::Buffer& dict,
   return true;
 }
 
+// An operand of a DICT that has been parsed already, for subsetting to find
+// the offsets it has to change.
+struct DictOperand {
+  // Where it is in the table, and how many bytes encode it.
+  size_t position;
+  size_t width;
+  bool integer;
+  int32_t value;
+};
+
+// What subsetting the CharStrings INDEX has to know of a DICT.
+struct DictOffsets {
+  DictOffsets()
+      : private_offset(0), private_length(0), fd_array(0), subrs(-1) {}
+
+  // The operands that are offsets from the start of the table.
+  std::vector<DictOperand> offsets;
+  // Where the Private DICT is, if there is one.
+  int32_t private_offset;
+  int32_t private_length;
+  // Where the Font DICT INDEX is, if there is one.
+  int32_t fd_array;
+  // For a Private DICT, where its Local Subrs INDEX is, relative to it, if
+  // it has one.
+  int32_t subrs;
+};
+
+// Finds the offsets of the DICT of |length| bytes at |offset| in |table|,
+// which has been parsed already. Returns false if there is one that is not
+// a plain integer, or that can't be found.
+bool FindDictOffsets(const ots::Buffer &table, size_t offset, size_t length,
+                     DictOffsets *out) {
+  if (offset > table.length() || length > table.length() - offset) {
+    return OTS_FAILURE();
+  }
+  const uint8_t *dict = table.buffer() + offset;
+  std::vector<DictOperand> operands;
+  bool blended = false;
+
+  size_t i = 0;
+  while (i < length) {
+    const uint8_t b0 = dict[i];
+    DictOperand operand = {offset + i, 0, true, 0};
+    if (b0 == 28 && i + 3 <= length) {
+      operand.width = 3;
+      operand.value = static_cast<int16_t>(dict[i + 1] << 8 | dict[i + 2]);
+    } else if (b0 == 29 && i + 5 <= length) {
+      operand.width = 5;
+      operand.value = static_cast<int32_t>(
+          static_cast<uint32_t>(dict[i + 1]) << 24 | dict[i + 2] << 16 |
+          dict[i + 3] << 8 | dict[i + 4]);
+    } else if (b0 == 30) {
+      // A real number, which ends with a 0xf nibble.
+      operand.integer = false;
+      do {
+        ++operand.width;
+      } while (i + operand.width < length &&
+               (dict[i + operand.width - 1] & 0xf0) != 0xf0 &&
+               (dict[i + operand.width - 1] & 0x0f) != 0x0f);
+    } else if (b0 >= 32 && b0 <= 246) {
+      operand.width = 1;
+      operand.value = b0 - 139;
+    } else if (b0 >= 247 && b0 <= 254 && i + 2 <= length) {
+      operand.width = 2;
+      if (b0 <= 250) {
+        operand.value = (b0 - 247) * 256 + dict[i + 1] + 108;
+      } else {
+        operand.value = -(b0 - 251) * 256 - dict[i + 1] - 108;
+      }
+    }
+    if (operand.width) {
+      operands.push_back(operand);
+      i += operand.width;
+      continue;
+    }
+
+    // Anything else is an operator.
+    if (b0 > 24 || (b0 == 12 && i + 2 > length)) {
+      return OTS_FAILURE();
+    }
+    const int32_t op = b0 == 12 ? (12 << 8) + dict[i + 1] : b0;
+    i += b0 == 12 ? 2 : 1;
+
+    switch (op) {
+      case 15:  // charset
+      case 16:  // Encoding
+      case 17:  // CharStrings
+      case 24:  // vstore
+      case (12 << 8) + 36:  // FDArray
+      case (12 << 8) + 37:  // FDSelect
+        if (operands.empty() || !operands.back().integer) {
+          return OTS_FAILURE();
+        }
+        out->offsets.push_back(operands.back());
+        if (op == (12 << 8) + 36) {
+          out->fd_array = operands.back().value;
+        }
+        break;
+
+      case 18:  // Private
+        if (operands.size() != 2 ||
+            !operands[0].integer || !operands[1].integer) {
+          return OTS_FAILURE();
+        }
+        out->offsets.push_back(operands[1]);
+        out->private_length = operands[0].value;
+        out->private_offset = operands[1].value;
+        break;
+
+      case 19:  // Subrs
+        if (operands.size() != 1 || !operands[0].integer || blended) {
+          return OTS_FAILURE();
+        }
+        out->subrs = operands[0].value;
+        break;
+
+      case 23:  // blend, whose results are operands of the next operator.
+        blended = true;
+        continue;
+    }
+    operands.clear();
+    blended = false;
+  }
+  return true;
+}
+
+// Encodes |value| as a DICT integer operand of |width| bytes at |p|, if it
+// can be.
+bool WriteDictInteger(uint8_t *p, size_t width, int32_t value) {
+  switch (width) {
+    case 1:
+      if (value < -107 || value > 107) {
+        return false;
+      }
+      p[0] = value + 139;
+      return true;
+    case 2: {
+      const int32_t magnitude = (value < 0 ? -value : value) - 108;
+      if (magnitude < 0 || magnitude > 1023) {
+        return false;
+      }
+      p[0] = (value < 0 ? 251 : 247) + (magnitude >> 8);
+      p[1] = magnitude & 0xff;
+      return true;
+    }
+    case 3:
+      if (value < -32768 || value > 32767) {
+        return false;
+      }
+      p[0] = 28;
+      p[1] = (value >> 8) & 0xff;
+      p[2] = value & 0xff;
+      return true;
+    case 5:
+      p[0] = 29;
+      p[1] = (value >> 24) & 0xff;
+      p[2] = (value >> 16) & 0xff;
+      p[3] = (value >> 8) & 0xff;
+      p[4] = value & 0xff;
+      return true;
+  }
+  return false;
+}
+
+// Finds the DICT operands of the table |data| of |length| bytes that point
+// past its CharStrings INDEX, from |index_start| to |index_end|, for the
+// INDEX to be made |shrink| bytes shorter. Returns false if what comes after
+// the INDEX can't be moved up: if something the Top DICT does not point to
+// (e.g. the Global Subrs INDEX) is there, if a Private DICT and its Local
+// Subrs are on both sides of it, or if an offset is too short to be changed.
+bool FindOffsetsToMove(const uint8_t *data, size_t length, bool cff2,
+                       size_t index_start, size_t index_end, size_t shrink,
+                       std::vector<DictOperand> *moved) {
+  ots::Buffer table(data, length);
+  uint8_t hdr_size = 0;
+  if (!table.Skip(2) || !table.ReadU8(&hdr_size)) {
+    return OTS_FAILURE();
+  }
+
+  // The structures found one after the other from the header, and the Top
+  // DICT.
+  std::vector<DictOffsets> dicts(1);
+  size_t fixed_end = 0;
+  if (cff2) {
+    uint16_t top_dict_size = 0;
+    ots::CFFIndex global_subrs;
+    if (!table.ReadU16(&top_dict_size) ||
+        !FindDictOffsets(table, hdr_size, top_dict_size, &dicts[0])) {
+      return OTS_FAILURE();
+    }
+    table.set_offset(hdr_size + top_dict_size);
+    if (!ParseIndex(table, global_subrs, true)) {
+      return OTS_FAILURE();
+    }
+    fixed_end = global_subrs.offset_to_next;
+  } else {
+    ots::CFFIndex name, top_dict, strings, global_subrs;
+    table.set_offset(hdr_size);
+    if (!ParseIndex(table, name)) {
+      return OTS_FAILURE();
+    }
+    table.set_offset(name.offset_to_next);
+    if (!ParseIndex(table, top_dict) || top_dict.count != 1) {
+      return OTS_FAILURE();
+    }
+    table.set_offset(top_dict.offset_to_next);
+    if (!ParseIndex(table, strings)) {
+      return OTS_FAILURE();
+    }
+    table.set_offset(strings.offset_to_next);
+    if (!ParseIndex(table, global_subrs)) {
+      return OTS_FAILURE();
+    }
+    fixed_end = global_subrs.offset_to_next;
+    if (!FindDictOffsets(table, top_dict.offset(0),
+                         top_dict.offset(1) - top_dict.offset(0),
+                         &dicts[0])) {
+      return OTS_FAILURE();
+    }
+  }
+  if (fixed_end > index_start) {
+    return false;
+  }
+
+  // The Font DICTs.
+  if (dicts[0].fd_array > 0) {
+    ots::CFFIndex fd_array;
+    table.set_offset(dicts[0].fd_array);
+    if (!ParseIndex(table, fd_array, cff2)) {
+      return OTS_FAILURE();
+    }
+    for (uint32_t i = 0; i < fd_array.count; ++i) {
+      dicts.emplace_back();
+      if (!FindDictOffsets(table, fd_array.offset(i),
+                           fd_array.offset(i + 1) - fd_array.offset(i),
+                           &dicts.back())) {
+        return OTS_FAILURE();
+      }
+    }
+  }
+
+  for (const DictOffsets &dict : dicts) {
+    for (const DictOperand &operand : dict.offsets) {
+      if (operand.position + operand.width > index_start &&
+          operand.position < index_end) {
+        return false;
+      }
+      if (operand.value > static_cast<int32_t>(index_start) &&
+          operand.value < static_cast<int32_t>(index_end)) {
+        return false;
+      }
+      if (operand.value >= static_cast<int32_t>(index_end)) {
+        DictOperand moved_operand = operand;
+        moved_operand.value -= static_cast<int32_t>(shrink);
+        uint8_t encoded[5];
+        if (!WriteDictInteger(encoded, operand.width, moved_operand.value)) {
+          return false;
+        }
+        moved->push_back(moved_operand);
+      }
+    }
+
+    if (dict.private_length > 0) {
+      if (dict.private_offset < static_cast<int32_t>(index_start) &&
+          dict.private_offset + dict.private_length >
+              static_cast<int32_t>(index_start)) {
+        return false;
+      }
+      DictOffsets private_dict;
+      if (!FindDictOffsets(table, dict.private_offset, dict.private_length,
+                           &private_dict)) {
+        return OTS_FAILURE();
+      }
+      if (private_dict.subrs >= 0) {
+        const int64_t subrs =
+            static_cast<int64_t>(dict.private_offset) + private_dict.subrs;
+        if ((subrs >= static_cast<int64_t>(index_end)) !=
+            (dict.private_offset >= static_cast<int32_t>(index_end)) ||
+            (subrs > static_cast<int64_t>(index_start) &&
+             subrs < static_cast<int64_t>(index_end))) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 namespace ots {
 
 bool OpenTypeCFF::ValidateFDSelect(uint16_t num_glyphs) {
-  for (const auto& fd_select : this->fd_select) {
-    if (fd_select.first >= num_glyphs) {
+  for (uint32_t i = 0; i < this->fd_select.size(); ++i) {
+    if (i >= num_glyphs) {
       return Error("Invalid glyph index in FDSelect: %d >= %d\n",
-                   fd_select.first, num_glyphs);
+                   i, num_glyphs);
     }
-    if (fd_select.second >= this->font_dict_length) {
+    if (this->fd_select[i] >= this->font_dict_length) {
       return Error("Invalid FD index: %d >= %d\n",
-                   fd_select.second, this->font_dict_length);
+                   this->fd_select[i], this->font_dict_length);
     }
   }
   return true;
@@ -1299,7 +1594,7 @@ bool OpenTypeCFF::Parse(const uint8_t *data, size_t length) {
   if (!ParseIndex(table, name_index)) {
     return Error("Failed to parse Name INDEX");
   }
-  if (name_index.count != 1 || name_index.offsets.size() != 2) {
+  if (name_index.count != 1) {
     return Error("Name INDEX must contain only one entry, not %d",
                  name_index.count);
   }
@@ -1372,6 +1667,104 @@ bool OpenTypeCFF::Serialize(OTSStream *out) {
   return true;
 }
 
+bool OpenTypeCFF::Subset(const std::vector<bool>& glyphs) {
+  if (!SubsetCharStrings(glyphs, this->m_data, this->m_length,
+                         &this->subset_data)) {
+    return false;
+  }
+  // What was moved is checked as any input would be.
+  OpenTypeCFF subset(GetFont(), Tag());
+  subset.report_counters = false;
+  if (!subset.Parse(this->subset_data.data(), this->subset_data.size())) {
+    return Error("Failed to subset CharStrings");
+  }
+  this->m_data = this->subset_data.data();
+  this->m_length = this->subset_data.size();
+  return true;
+}
+
+bool OpenTypeCFF::SubsetCharStrings(const std::vector<bool>& glyphs,
+                                    const uint8_t *data, size_t length,
+                                    std::vector<uint8_t> *out) {
+  const CFFIndex& char_strings_index = *(this->charstrings_index);
+  const bool cff2 = (this->major == 2);
+  if (glyphs.size() != char_strings_index.count) {
+    return Error("Subset of %u glyphs for %u CharStrings",
+                 static_cast<unsigned>(glyphs.size()),
+                 char_strings_index.count);
+  }
+
+  // The glyphs seac refers to are not kept for it, unless they are asked for.
+  for (uint16_t glyph : this->seac_glyphs) {
+    if (glyphs[glyph]) {
+      Warning("Glyph %d uses seac, whose accent and base glyphs may be "
+              "removed", glyph);
+      break;
+    }
+  }
+
+  // The charstrings of the glyphs not kept are left empty, or with just an
+  // endchar in CFF, where one is needed.
+  const uint8_t kEndChar = 14;
+  std::vector<uint8_t> char_strings;
+  std::vector<uint32_t> offsets(1, 1);
+  for (uint32_t i = 0; i < char_strings_index.count; ++i) {
+    if (glyphs[i]) {
+      char_strings.insert(char_strings.end(),
+                          data + char_strings_index.offset(i),
+                          data + char_strings_index.offset(i + 1));
+    } else if (!cff2) {
+      char_strings.push_back(kEndChar);
+    }
+    offsets.push_back(char_strings.size() + 1);
+  }
+  uint8_t off_size = 1;
+  while (off_size < 4 && offsets.back() >> (8 * off_size)) {
+    ++off_size;
+  }
+
+  std::vector<uint8_t> index;
+  for (int shift = cff2 ? 24 : 8; shift >= 0; shift -= 8) {
+    index.push_back(char_strings_index.count >> shift);
+  }
+  index.push_back(off_size);
+  for (uint32_t offset : offsets) {
+    for (int shift = 8 * (off_size - 1); shift >= 0; shift -= 8) {
+      index.push_back(offset >> shift);
+    }
+  }
+  index.insert(index.end(), char_strings.begin(), char_strings.end());
+
+  const size_t index_start =
+      char_strings_index.offset_array - data - (cff2 ? 5 : 3);
+  const size_t index_end = char_strings_index.offset_to_next;
+  if (index.size() > index_end - index_start) {
+    return Error("Subset CharStrings INDEX is longer");  // not reached.
+  }
+  const size_t shrink = index_end - index_start - index.size();
+
+  // What comes after the INDEX is moved up, with the offsets pointing to it,
+  // if that can be done; the bytes the INDEX no longer takes are left unused
+  // otherwise.
+  std::vector<DictOperand> moved;
+  const bool move = shrink &&
+      FindOffsetsToMove(data, length, cff2, index_start, index_end, shrink,
+                        &moved);
+  out->assign(data, data + index_start);
+  out->insert(out->end(), index.begin(), index.end());
+  if (!move) {
+    moved.clear();
+    out->resize(index_end, 0);
+  }
+  out->insert(out->end(), data + index_end, data + length);
+  for (const DictOperand& operand : moved) {
+    const size_t position = operand.position < index_start
+        ? operand.position : operand.position - shrink;
+    WriteDictInteger(out->data() + position, operand.width, operand.value);
+  }
+  return true;
+}
+
 OpenTypeCFF::~OpenTypeCFF() {
   for (size_t i = 0; i < this->local_subrs_per_font.size(); ++i) {
     delete (this->local_subrs_per_font)[i];
@@ -1459,6 +1852,21 @@ bool OpenTypeCFF2::Serialize(OTSStream *out) {
   return true;
 }
 
+bool OpenTypeCFF2::Subset(const std::vector<bool>& glyphs) {
+  if (!SubsetCharStrings(glyphs, this->m_data, this->m_length,
+                         &this->subset_data)) {
+    return false;
+  }
+  OpenTypeCFF2 subset(GetFont(), Tag());
+  subset.report_counters = false;
+  if (!subset.Parse(this->subset_data.data(), this->subset_data.size())) {
+    return Error("Failed to subset CharStrings");
+  }
+  this->m_data = this->subset_data.data();
+  this->m_length = this->subset_data.size();
+  return true;
+}
+
 }  // namespace ots
 
 #undef TABLE_NAME
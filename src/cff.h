@@ -15,16 +15,47 @@
 
 namespace ots {
 
+// The offsets of an INDEX are not copied out of the table: ParseIndex()
+// checks them all at once, and they are then read from the table as needed.
 struct CFFIndex {
   CFFIndex()
-      : count(0), off_size(0), offset_to_next(0) {}
+      : count(0), off_size(0), offset_to_next(0), offset_array(NULL),
+        base_offset(0) {}
+
+  // The offset in the table of the start of the |i|-th object, or of the end
+  // of the last one for |i| == |count|.
+  uint32_t offset(size_t i) const {
+    const uint8_t *p = this->offset_array + i * this->off_size;
+    uint32_t relative_offset = 0;
+    switch (this->off_size) {
+      case 1:
+        relative_offset = p[0];
+        break;
+      case 2:
+        relative_offset = p[0] << 8 | p[1];
+        break;
+      case 3:
+        relative_offset = p[0] << 16 | p[1] << 8 | p[2];
+        break;
+      default:
+        relative_offset = static_cast<uint32_t>(p[0]) << 24 |
+                          p[1] << 16 | p[2] << 8 | p[3];
+        break;
+    }
+    return this->base_offset + relative_offset;
+  }
+
   uint32_t count;
   uint8_t off_size;
-  std::vector<uint32_t> offsets;
   uint32_t offset_to_next;
+  // The |count| + 1 big-endian offsets of |off_size| bytes, which are
+  // relative to |base_offset|, the byte before the object data.
+  const uint8_t *offset_array;
+  uint32_t base_offset;
 };
 
-typedef std::map<uint32_t, uint16_t> CFFFDSelect;
+// The font # of each glyph #, up to the last one FDSelect covers.
+typedef std::vector<uint16_t> CFFFDSelect;
 
 class OpenTypeCFF : public Table {
  public:
@@ -34,6 +65,7 @@ class OpenTypeCFF : public Table {
         font_dict_length(0),
         charstrings_index(NULL),
         local_subrs(NULL),
+        report_counters(true),
         m_data(NULL),
         m_length(0) {
   }
@@ -43,6 +75,10 @@ class OpenTypeCFF : public Table {
   bool Parse(const uint8_t *data, size_t length);
   bool Serialize(OTSStream *out);
 
+  // Reduces the charstrings of the glyphs not marked in |glyphs| to the
+  // least a charstring can be.
+  bool Subset(const std::vector<bool>& glyphs);
+
   // Major version number.
   uint8_t major;
 
@@ -51,7 +87,7 @@ class OpenTypeCFF : public Table {
 
   // The number of fonts the file has.
   size_t font_dict_length;
-  // A map from glyph # to font #.
+  // The font # of each glyph #.
   CFFFDSelect fd_select;
 
   // A list of char strings.
@@ -69,9 +105,28 @@ class OpenTypeCFF : public Table {
   // explicitly set in Font's PrivateDICT.
   std::vector<int32_t> vsindex_per_font;
 
+  // The glyphs whose charstrings end with seac, making an accented glyph of
+  // two others found through the standard encoding, in order.
+  std::vector<uint16_t> seac_glyphs;
+
+  // Whether the counters of the charstring validation are given to the
+  // observer. They are not for the copy a subset table is checked with, as
+  // the table was already counted once.
+  bool report_counters;
+
  protected:
   bool ValidateFDSelect(uint16_t num_glyphs);
 
+  // Writes to |out| the table |data| of |length| bytes, with the CharStrings
+  // INDEX of the glyphs marked in |glyphs| only, and what came after it
+  // moved up if that can be done.
+  bool SubsetCharStrings(const std::vector<bool>& glyphs,
+                         const uint8_t *data, size_t length,
+                         std::vector<uint8_t> *out);
+
+  // The table once subset, if it was.
+  std::vector<uint8_t> subset_data;
+
  private:
   const uint8_t *m_data;
   size_t m_length;
@@ -88,6 +143,8 @@ class OpenTypeCFF2 : public OpenTypeCFF {
   bool Parse(const uint8_t *data, size_t length);
   bool Serialize(OTSStream *out);
 
+  bool Subset(const std::vector<bool>& glyphs);
+
  private:
   const uint8_t *m_data;
   size_t m_length;
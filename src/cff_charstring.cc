@@ -7,12 +7,17 @@
 
 #include "cff_charstring.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstdio>
 #include <cstring>
-#include <stack>
+#include <limits>
+#include <map>
 #include <string>
 #include <utility>
+#include <vector>
+
+#include "parallel.h"
 
 #define TABLE_NAME "CFF"
 
@@ -29,16 +34,244 @@ const size_t kMaxSubrNesting = 10;
 // will fail with the dummy value.
 const int32_t dummy_result = INT_MAX;
 
+// The argument stack of the charstring interpreter. While subroutines are
+// being executed, it also keeps track of which part of the stack each of them
+// has left untouched, whether they have looked at the value of any argument
+// they were called with, and whether they have called a local subroutine.
+// All of this is kept in fixed-size arrays, so
+// that validating charstrings allocates nothing: an operand is pushed before
+// the stack is checked for overflowing, hence the room for one more than the
+// largest stack, and the subroutine calls of a charstring nest no deeper than
+// kMaxSubrNesting + 1.
+class ArgumentStack {
+ public:
+  ArgumentStack() : size_(0), num_calls_(0) {}
+
+  struct SubrCall {
+    // The stack is the same as when the subroutine was called up to here.
+    size_t low_water;
+    // Whether the subroutine has used the value of any argument it was called
+    // with (as opposed to just how many there are).
+    bool reads_arguments;
+    // Whether the subroutine, or one it called, has called a local
+    // subroutine.
+    bool calls_local_subrs;
+  };
+
+  void push(int32_t value) {
+    values_[size_++] = value;
+  }
+
+  void pop() {
+    --size_;
+    if (num_calls_ && size_ < calls_[num_calls_ - 1].low_water) {
+      calls_[num_calls_ - 1].low_water = size_;
+    }
+  }
+
+  // Returns the value at the top of the stack, taking note of it for the
+  // subroutine calls that value is an argument of.
+  int32_t top() {
+    const size_t position = size_ - 1;
+    size_t low_water = size_;
+    for (size_t i = num_calls_; i > 0; --i) {
+      SubrCall& call = calls_[i - 1];
+      low_water = std::min(low_water, call.low_water);
+      if (position >= low_water) {
+        break;
+      }
+      call.reads_arguments = true;
+    }
+    return values_[position];
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Empties the stack for the next charstring.
+  void clear() {
+    size_ = 0;
+    num_calls_ = 0;
+  }
+
+  void BeginSubrCall() {
+    const SubrCall call = {size_, false, false};
+    calls_[num_calls_++] = call;
+  }
+
+  // Takes note of a local subroutine being called, for the subroutine calls
+  // being executed.
+  void NoteLocalSubrCall() {
+    if (num_calls_) {
+      calls_[num_calls_ - 1].calls_local_subrs = true;
+    }
+  }
+
+  SubrCall EndSubrCall() {
+    const SubrCall call = calls_[--num_calls_];
+    if (num_calls_) {
+      calls_[num_calls_ - 1].low_water =
+          std::min(calls_[num_calls_ - 1].low_water, call.low_water);
+      calls_[num_calls_ - 1].calls_local_subrs |= call.calls_local_subrs;
+    }
+    return call;
+  }
+
+  // Appends the values from |position| to the top of the stack to |values|.
+  void AppendValuesFrom(size_t position, std::vector<int32_t> *values) const {
+    values->insert(values->end(), values_ + position, values_ + size_);
+  }
+
+ private:
+  int32_t values_[ots::kMaxCFF2ArgumentStack + 1];
+  size_t size_;
+  SubrCall calls_[kMaxSubrNesting + 1];
+  size_t num_calls_;
+};
+
+// The effect of a subroutine call that was found valid, along with the
+// state it was called in, as that is all the outcome depends on when the
+// subroutine does not use the values of its arguments.
+struct SubrCallEffect {
+  // The state the subroutine was called in.
+  size_t call_depth;
+  size_t stack_size;
+  ots::CharStringContext cs_ctx_before;
+
+  // The arguments it left on the stack, where what it pushed on top of them
+  // starts in SubrCallCache::pushed_values and how many values that is, and
+  // the resulting context.
+  size_t kept_arguments;
+  size_t pushed_begin;
+  size_t pushed_count;
+  ots::CharStringContext cs_ctx_after;
+
+  // The offset array of the local subroutines INDEX the call was validated
+  // with, if it called a local subroutine; otherwise NULL, as the effect is
+  // then the same whichever local subroutines the glyph uses.
+  const uint8_t *local_subrs;
+  // The subroutine the call was validated for, as its INDEX and number.
+  const ots::CFFIndex *subrs_index;
+  int32_t subr_number;
+
+  // The index of the effect of the same subroutine found before this one, or
+  // kNoSubrCallEffect.
+  size_t previous;
+
+  bool CalledIn(size_t depth, size_t size,
+                const ots::CharStringContext& cs_ctx,
+                const ots::CFFIndex& local_subrs_index) const {
+    return (local_subrs == NULL ||
+            local_subrs == local_subrs_index.offset_array) &&
+           call_depth == depth &&
+           stack_size == size &&
+           cs_ctx_before.width_seen == cs_ctx.width_seen &&
+           cs_ctx_before.num_stems == cs_ctx.num_stems &&
+           cs_ctx_before.hint_state == cs_ctx.hint_state &&
+           cs_ctx_before.blend_seen == cs_ctx.blend_seen &&
+           cs_ctx_before.vsindex_seen == cs_ctx.vsindex_seen &&
+           cs_ctx_before.vsindex == cs_ctx.vsindex;
+  }
+};
+
+const size_t kNoSubrCallEffect = std::numeric_limits<size_t>::max();
+const size_t kNoSubr = std::numeric_limits<size_t>::max();
+
+// The subroutine calls that have been validated, for the glyphs of a range.
+// Subroutines are told apart by where their charstring is in the table rather
+// than by their number, so that what is found for one holds whichever INDEX
+// it is called through: the local subroutines of the font DICTs of CID-keyed
+// fonts are often the same bytes, and global and local subroutines can be
+// too. There are usually only a few different states each subroutine is
+// called in. They are all kept in a few flat vectors, rather than in a vector
+// per subroutine, so that there are few allocations.
+struct SubrCallCache {
+  SubrCallCache()
+      : global_subrs(NULL), local_subrs(NULL), num_validated_calls(0),
+        num_reused_calls(0), num_shared_calls(0) {}
+
+  // Looks up the subroutines of the INDEXes the next glyph uses.
+  void Select(const ots::CFFIndex& global_subrs_index,
+              const ots::CFFIndex& local_subrs_index) {
+    this->global_subrs = &this->subrs_per_index[global_subrs_index.offset_array];
+    this->local_subrs = &this->subrs_per_index[local_subrs_index.offset_array];
+  }
+
+  // Returns the position in |last_effects| of the subroutine whose charstring
+  // is the |length| bytes at |offset| in the table.
+  size_t FindSubr(size_t offset, size_t length) {
+    const std::pair<size_t, size_t> key(offset, length);
+    std::map<std::pair<size_t, size_t>, size_t>::const_iterator it =
+        this->subrs.find(key);
+    if (it != this->subrs.end()) {
+      return it->second;
+    }
+    this->subrs[key] = this->last_effects.size();
+    this->last_effects.push_back(kNoSubrCallEffect);
+    return this->last_effects.size() - 1;
+  }
+
+  // The position in |last_effects| of each subroutine found so far, by
+  // offset and length in the table.
+  std::map<std::pair<size_t, size_t>, size_t> subrs;
+  // For each subroutines INDEX, by its offset array, the position in
+  // |last_effects| of each of its subroutines by number, or kNoSubr if it has
+  // not been called yet; those of the INDEXes the current glyph uses.
+  std::map<const uint8_t*, std::vector<size_t> > subrs_per_index;
+  std::vector<size_t> *global_subrs;
+  std::vector<size_t> *local_subrs;
+
+  // For each subroutine, the index in |effects| of the last effect found for
+  // it, or kNoSubrCallEffect.
+  std::vector<size_t> last_effects;
+  std::vector<SubrCallEffect> effects;
+  std::vector<int32_t> pushed_values;
+
+  // The number of subroutine calls validated, of those whose effect was
+  // already known, and of those whose effect was found for another
+  // subroutine number or INDEX with the same charstring.
+  uint64_t num_validated_calls;
+  uint64_t num_reused_calls;
+  uint64_t num_shared_calls;
+};
+
+// The charstrings of a range of glyphs. Ranges are validated on their own,
+// possibly concurrently, each with its own view of the CFF table, argument
+// stack and subroutine calls, and only the first one that fails is reported,
+// as if the glyphs were validated one after the other.
+struct CharStringRange {
+  CharStringRange()
+      : begin(0), end(0), ok(true), undefined_operator_seen(false),
+        undefined_operator(0), num_validated_subr_calls(0),
+        num_reused_subr_calls(0), num_shared_subr_calls(0) {}
+
+  unsigned begin;
+  unsigned end;
+  bool ok;
+  // Whether validation failed on an undefined operator, and which, to be told
+  // once the ranges before this one are known to be valid.
+  bool undefined_operator_seen;
+  int32_t undefined_operator;
+  // As counted by the SubrCallCache of the range.
+  uint64_t num_validated_subr_calls;
+  uint64_t num_reused_subr_calls;
+  uint64_t num_shared_subr_calls;
+  // The glyphs of the range whose charstrings end with seac.
+  std::vector<uint16_t> seac_glyphs;
+};
+
 bool ExecuteCharString(ots::OpenTypeCFF& cff,
                        size_t call_depth,
                        const ots::CFFIndex& global_subrs_index,
                        const ots::CFFIndex& local_subrs_index,
                        ots::Buffer *cff_table,
                        ots::Buffer *char_string,
-                       std::stack<int32_t> *argument_stack,
-                       ots::CharStringContext& cs_ctx);
+                       ArgumentStack *argument_stack,
+                       ots::CharStringContext& cs_ctx,
+                       SubrCallCache *subr_cache,
+                       CharStringRange *range);
 
-bool ArgumentStackOverflows(std::stack<int32_t> *argument_stack, bool cff2) {
+bool ArgumentStackOverflows(ArgumentStack *argument_stack, bool cff2) {
   if ((cff2 && argument_stack->size() > ots::kMaxCFF2ArgumentStack) ||
       (!cff2 && argument_stack->size() > ots::kMaxCFF1ArgumentStack)) {
     return true;
@@ -263,8 +496,9 @@ bool ValidCFF2Operator(int32_t op) {
 
 // Executes |op| and updates |argument_stack|. Returns true if the execution
 // succeeds. If the |op| is kCallSubr or kCallGSubr, the function recursively
-// calls ExecuteCharString() function. The |cs_ctx| argument holds values that
-// need to persist through these calls (see CharStringContext for details)
+// calls ExecuteCharString() function, unless |subr_cache| already has the
+// effect of that call. The |cs_ctx| argument holds values that need to
+// persist through these calls (see CharStringContext for details)
 bool ExecuteCharStringOperator(ots::OpenTypeCFF& cff,
                                int32_t op,
                                size_t call_depth,
@@ -272,9 +506,10 @@ bool ExecuteCharStringOperator(ots::OpenTypeCFF& cff,
                                const ots::CFFIndex& local_subrs_index,
                                ots::Buffer *cff_table,
                                ots::Buffer *char_string,
-                               std::stack<int32_t> *argument_stack,
-                               ots::CharStringContext& cs_ctx) {
-  ots::Font* font = cff.GetFont();
+                               ArgumentStack *argument_stack,
+                               ots::CharStringContext& cs_ctx,
+                               SubrCallCache *subr_cache,
+                               CharStringRange *range) {
   const size_t stack_size = argument_stack->size();
 
   if (cs_ctx.cff2 && !ValidCFF2Operator(op)) {
@@ -316,31 +551,96 @@ bool ExecuteCharStringOperator(ots::OpenTypeCFF& cff,
     if (subr_number >= kMaxSubrsCount) {
       return OTS_FAILURE();
     }
-    if (subrs_index.offsets.size() <= static_cast<size_t>(subr_number + 1)) {
+    if (subrs_index.count <= static_cast<uint32_t>(subr_number)) {
       return OTS_FAILURE();  // The number is out-of-bounds.
     }
 
     // Prepare ots::Buffer where we're going to jump.
     const size_t length =
-      subrs_index.offsets[subr_number + 1] - subrs_index.offsets[subr_number];
+      subrs_index.offset(subr_number + 1) - subrs_index.offset(subr_number);
     if (length > kMaxCharStringLength) {
       return OTS_FAILURE();
     }
-    const size_t offset = subrs_index.offsets[subr_number];
+    const size_t offset = subrs_index.offset(subr_number);
     cff_table->set_offset(offset);
     if (!cff_table->Skip(length)) {
       return OTS_FAILURE();
     }
     ots::Buffer char_string_to_jump(cff_table->buffer() + offset, length);
 
-    return ExecuteCharString(cff,
-                             call_depth + 1,
-                             global_subrs_index,
-                             local_subrs_index,
-                             cff_table,
-                             &char_string_to_jump,
-                             argument_stack,
-                             cs_ctx);
+    if (op == ots::kCallSubr) {
+      argument_stack->NoteLocalSubrCall();
+    }
+    std::vector<size_t>& subrs =
+        *(op == ots::kCallSubr ? subr_cache->local_subrs
+                               : subr_cache->global_subrs);
+    if (subrs.empty()) {
+      subrs.resize(subrs_index.count, kNoSubr);
+    }
+    if (subrs[subr_number] == kNoSubr) {
+      subrs[subr_number] = subr_cache->FindSubr(offset, length);
+    }
+    const size_t subr = subrs[subr_number];
+    for (size_t i = subr_cache->last_effects[subr]; i != kNoSubrCallEffect;
+         i = subr_cache->effects[i].previous) {
+      const SubrCallEffect& effect = subr_cache->effects[i];
+      if (effect.CalledIn(call_depth, argument_stack->size(), cs_ctx,
+                          local_subrs_index)) {
+        while (argument_stack->size() > effect.kept_arguments)
+          argument_stack->pop();
+        for (size_t j = 0; j < effect.pushed_count; ++j)
+          argument_stack->push(
+              subr_cache->pushed_values[effect.pushed_begin + j]);
+        if (effect.local_subrs) {
+          argument_stack->NoteLocalSubrCall();
+        }
+        cs_ctx = effect.cs_ctx_after;
+        ++subr_cache->num_reused_calls;
+        if (effect.subrs_index != &subrs_index ||
+            effect.subr_number != subr_number) {
+          ++subr_cache->num_shared_calls;
+        }
+        return true;
+      }
+    }
+    const size_t stack_size_before = argument_stack->size();
+    const ots::CharStringContext cs_ctx_before = cs_ctx;
+
+    argument_stack->BeginSubrCall();
+    if (!ExecuteCharString(cff,
+                           call_depth + 1,
+                           global_subrs_index,
+                           local_subrs_index,
+                           cff_table,
+                           &char_string_to_jump,
+                           argument_stack,
+                           cs_ctx,
+                           subr_cache,
+                           range)) {
+      return OTS_FAILURE();
+    }
+    ++subr_cache->num_validated_calls;
+    const ArgumentStack::SubrCall call = argument_stack->EndSubrCall();
+    if (!call.reads_arguments) {
+      SubrCallEffect effect;
+      effect.call_depth = call_depth;
+      effect.stack_size = stack_size_before;
+      effect.cs_ctx_before = cs_ctx_before;
+      effect.kept_arguments = call.low_water;
+      effect.pushed_begin = subr_cache->pushed_values.size();
+      effect.pushed_count = argument_stack->size() - call.low_water;
+      argument_stack->AppendValuesFrom(call.low_water,
+                                       &subr_cache->pushed_values);
+      effect.cs_ctx_after = cs_ctx;
+      effect.local_subrs =
+          call.calls_local_subrs ? local_subrs_index.offset_array : NULL;
+      effect.subrs_index = &subrs_index;
+      effect.subr_number = subr_number;
+      effect.previous = subr_cache->last_effects[subr];
+      subr_cache->last_effects[subr] = subr_cache->effects.size();
+      subr_cache->effects.push_back(effect);
+    }
+    return true;
   }
 
   case ots::kReturn:
@@ -348,6 +648,8 @@ bool ExecuteCharStringOperator(ots::OpenTypeCFF& cff,
 
   case ots::kEndChar:
     cs_ctx.endchar_seen = true;
+    // The deprecated seac form, with an accent on a base glyph.
+    cs_ctx.seac_seen = !cs_ctx.cff2 && stack_size >= 4;
     cs_ctx.width_seen = true;  // just in case.
     return true;
 
@@ -819,7 +1121,9 @@ bool ExecuteCharStringOperator(ots::OpenTypeCFF& cff,
     return true;
   }
 
-  return OTS_FAILURE_MSG("Undefined operator: %d (0x%x)", op, op);
+  range->undefined_operator_seen = true;
+  range->undefined_operator = op;
+  return OTS_FAILURE();
 }
 
 // Executes |char_string| and updates |argument_stack|.
@@ -834,6 +1138,7 @@ bool ExecuteCharStringOperator(ots::OpenTypeCFF& cff,
 // argument_stack: The stack which an operator in |char_string| operates.
 // cs_ctx: a CharStringContext holding values to persist across subrs, etc.
 //   endchar_seen: true is set if |char_string| contains 'endchar'.
+//   seac_seen: true is set if that 'endchar' has the arguments of 'seac'.
 //   width_seen: true is set if |char_string| contains 'width' byte (which
 //               is 0 or 1 byte) or if cff2
 //   num_stems: total number of hstems and vstems processed so far.
@@ -842,14 +1147,18 @@ bool ExecuteCharStringOperator(ots::OpenTypeCFF& cff,
 //   vsindex_seen: initially false; set to true if 'vsindex' encountered.
 //   vsindex: initially = PrivateDICT's vsindex; may be changed by 'vsindex'
 //            operator in CharString
+// subr_cache: The effects of the subroutine calls validated so far.
+// range: The range of glyphs the charstring is validated for.
 bool ExecuteCharString(ots::OpenTypeCFF& cff,
                        size_t call_depth,
                        const ots::CFFIndex& global_subrs_index,
                        const ots::CFFIndex& local_subrs_index,
                        ots::Buffer *cff_table,
                        ots::Buffer *char_string,
-                       std::stack<int32_t> *argument_stack,
-                       ots::CharStringContext& cs_ctx) {
+                       ArgumentStack *argument_stack,
+                       ots::CharStringContext& cs_ctx,
+                       SubrCallCache *subr_cache,
+                       CharStringRange *range) {
   if (call_depth > kMaxSubrNesting) {
     return OTS_FAILURE();
   }
@@ -898,7 +1207,9 @@ bool ExecuteCharString(ots::OpenTypeCFF& cff,
                                    cff_table,
                                    char_string,
                                    argument_stack,
-                                   cs_ctx)) {
+                                   cs_ctx,
+                                   subr_cache,
+                                   range)) {
       return OTS_FAILURE();
     }
     if (cs_ctx.endchar_seen) {
@@ -927,11 +1238,10 @@ bool SelectLocalSubr(const ots::OpenTypeCFF& cff,
   if ((cff.fd_select.size() > 0) &&
       (!cff.local_subrs_per_font.empty())) {
     // Look up FDArray index for the glyph.
-    const auto& iter = cff.fd_select.find(glyph_index);
-    if (iter == cff.fd_select.end()) {
+    if (glyph_index >= cff.fd_select.size()) {
       return OTS_FAILURE();
     }
-    const auto fd_index = iter->second;
+    const auto fd_index = cff.fd_select[glyph_index];
     if (fd_index >= cff.local_subrs_per_font.size()) {
       return OTS_FAILURE();
     }
@@ -951,63 +1261,61 @@ bool SelectLocalSubr(const ots::OpenTypeCFF& cff,
   return true;
 }
 
-}  // namespace
-
-namespace ots {
+// Validates the charstrings of the glyphs of |range|. |cff_table| is a view of
+// the whole CFF table for this range alone.
+bool ValidateCharStrings(ots::OpenTypeCFF& cff,
+                         const ots::CFFIndex& global_subrs_index,
+                         ots::Buffer *cff_table,
+                         SubrCallCache *subr_cache,
+                         CharStringRange *range) {
+  const ots::CFFIndex& char_strings_index = *(cff.charstrings_index);
 
-bool ValidateCFFCharStrings(
-    ots::OpenTypeCFF& cff,
-    const CFFIndex& global_subrs_index,
-    Buffer* cff_table) {
-  const CFFIndex& char_strings_index = *(cff.charstrings_index);
-  if (char_strings_index.offsets.size() == 0) {
-    return OTS_FAILURE();  // no charstring.
-  }
+  ots::CFFIndex default_empty_subrs;
+  ArgumentStack argument_stack;
 
   // For each glyph, validate the corresponding charstring.
-  for (unsigned i = 1; i < char_strings_index.offsets.size(); ++i) {
+  for (unsigned i = range->begin + 1; i <= range->end; ++i) {
     // Prepare a Buffer object, |char_string|, which contains the charstring
     // for the |i|-th glyph.
     const size_t length =
-      char_strings_index.offsets[i] - char_strings_index.offsets[i - 1];
+      char_strings_index.offset(i) - char_strings_index.offset(i - 1);
     if (length > kMaxCharStringLength) {
       return OTS_FAILURE();
     }
-    const size_t offset = char_strings_index.offsets[i - 1];
+    const size_t offset = char_strings_index.offset(i - 1);
     cff_table->set_offset(offset);
     if (!cff_table->Skip(length)) {
       return OTS_FAILURE();
     }
-    Buffer char_string(cff_table->buffer() + offset, length);
+    ots::Buffer char_string(cff_table->buffer() + offset, length);
 
     // Get a local subrs for the glyph.
     const unsigned glyph_index = i - 1;  // index in the map is 0-origin.
-    const CFFIndex *local_subrs_to_use = NULL;
+    const ots::CFFIndex *local_subrs_to_use = NULL;
     if (!SelectLocalSubr(cff,
                          glyph_index,
                          &local_subrs_to_use)) {
       return OTS_FAILURE();
     }
     // If |local_subrs_to_use| is still NULL, use an empty one.
-    CFFIndex default_empty_subrs;
     if (!local_subrs_to_use){
       local_subrs_to_use = &default_empty_subrs;
     }
 
     // Check a charstring for the |i|-th glyph.
-    std::stack<int32_t> argument_stack;
+    argument_stack.clear();
+    subr_cache->Select(global_subrs_index, *local_subrs_to_use);
     // Context to store values that must persist across subrs, etc.
-    CharStringContext cs_ctx;
+    ots::CharStringContext cs_ctx;
     cs_ctx.cff2 = (cff.major == 2);
     // CFF2 CharString has no value for width, so we start with true here to
     // error out if width is found.
     cs_ctx.width_seen = cs_ctx.cff2;
     // CFF2 CharStrings' default vsindex comes from the associated PrivateDICT
     if (cs_ctx.cff2) {
-      const auto& iter = cff.fd_select.find(glyph_index);
       auto fd_index = 0;
-      if (iter != cff.fd_select.end()) {
-        fd_index = iter->second;
+      if (glyph_index < cff.fd_select.size()) {
+        fd_index = cff.fd_select[glyph_index];
       }
       if (fd_index >= (int32_t)cff.vsindex_per_font.size()) {
         // shouldn't get this far with a font in this condition, but just in case
@@ -1024,12 +1332,109 @@ bool ValidateCFFCharStrings(
                            0 /* initial call_depth is zero */,
                            global_subrs_index, *local_subrs_to_use,
                            cff_table, &char_string, &argument_stack,
-                           cs_ctx)) {
+                           cs_ctx, subr_cache, range)) {
       return OTS_FAILURE();
     }
     if (!cs_ctx.cff2 && !cs_ctx.endchar_seen) {
       return OTS_FAILURE();
     }
+    if (cs_ctx.seac_seen) {
+      range->seac_glyphs.push_back(glyph_index);
+    }
+  }
+  return true;
+}
+
+// Validates the charstrings of the glyphs of |range|, setting |range->ok| and
+// its counts of subroutine calls.
+void ValidateCharStringRange(ots::OpenTypeCFF& cff,
+                             const ots::CFFIndex& global_subrs_index,
+                             ots::Buffer cff_table,
+                             CharStringRange *range) {
+  SubrCallCache subr_cache;
+  range->ok = ValidateCharStrings(cff, global_subrs_index, &cff_table,
+                                  &subr_cache, range);
+  range->num_validated_subr_calls = subr_cache.num_validated_calls;
+  range->num_reused_subr_calls = subr_cache.num_reused_calls;
+  range->num_shared_subr_calls = subr_cache.num_shared_calls;
+}
+
+}  // namespace
+
+namespace ots {
+
+bool ValidateCFFCharStrings(
+    ots::OpenTypeCFF& cff,
+    const CFFIndex& global_subrs_index,
+    Buffer* cff_table) {
+  Font *font = cff.GetFont();
+  const CFFIndex& char_strings_index = *(cff.charstrings_index);
+  if (char_strings_index.count == 0) {
+    return OTS_FAILURE();  // no charstring.
+  }
+  const unsigned num_glyphs = char_strings_index.count;
+
+  // With an executor, large fonts are validated a range of glyphs at a time,
+  // concurrently.
+  OTSExecutor *executor = font->file->context->GetExecutor();
+  const unsigned kGlyphsPerRange = 1024;
+  const size_t num_ranges =
+      executor ? (num_glyphs + kGlyphsPerRange - 1) / kGlyphsPerRange : 1;
+  std::vector<CharStringRange> ranges(std::max<size_t>(num_ranges, 1));
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    CharStringRange& range = ranges[r];
+    range.begin = r * kGlyphsPerRange;
+    range.end = r + 1 < ranges.size() ? range.begin + kGlyphsPerRange
+                                      : num_glyphs;
+  }
+
+  const Buffer table(cff_table->buffer(), cff_table->length());
+  if (ranges.size() == 1) {
+    ValidateCharStringRange(cff, global_subrs_index, table, &ranges[0]);
+  } else {
+    TaskGroup group(executor);
+    for (size_t r = 0; r < ranges.size(); ++r) {
+      group.Run([&, r]() {
+        ValidateCharStringRange(cff, global_subrs_index, table, &ranges[r]);
+      });
+    }
+    group.Wait();
+  }
+
+  // Only the first range that failed is told about, as the glyphs after it
+  // would not have been validated one after the other.
+  for (const CharStringRange& range : ranges) {
+    if (range.ok) {
+      continue;
+    }
+    if (range.undefined_operator_seen) {
+      return OTS_FAILURE_MSG("Undefined operator: %d (0x%x)",
+                             range.undefined_operator,
+                             range.undefined_operator);
+    }
+    return OTS_FAILURE();
+  }
+
+  cff.seac_glyphs.clear();
+  for (const CharStringRange& range : ranges) {
+    cff.seac_glyphs.insert(cff.seac_glyphs.end(), range.seac_glyphs.begin(),
+                           range.seac_glyphs.end());
+  }
+
+  if (font->file->observer && cff.report_counters) {
+    uint64_t num_validated_calls = 0;
+    uint64_t num_reused_calls = 0;
+    uint64_t num_shared_calls = 0;
+    for (const CharStringRange& range : ranges) {
+      num_validated_calls += range.num_validated_subr_calls;
+      num_reused_calls += range.num_reused_subr_calls;
+      num_shared_calls += range.num_shared_subr_calls;
+    }
+    OTSTableObserver *observer = font->file->observer;
+    observer->OnTableCounter(cff.Tag(), "subr_calls_validated",
+                             num_validated_calls);
+    observer->OnTableCounter(cff.Tag(), "subr_calls_reused", num_reused_calls);
+    observer->OnTableCounter(cff.Tag(), "subr_calls_shared", num_shared_calls);
   }
   return true;
 }
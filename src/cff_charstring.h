@@ -106,6 +106,7 @@ enum HintState {
 
 struct CharStringContext {
   bool endchar_seen = false;
+  bool seac_seen = false;
   bool width_seen = false;
   size_t num_stems = 0;
   HintState hint_state = kHs;
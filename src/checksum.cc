@@ -0,0 +1,171 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "opentype-sanitiser.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OTS_CHECKSUM_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is chosen at run time, which needs the GCC/Clang target attribute.
+#if defined(OTS_CHECKSUM_SSE2) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define OTS_CHECKSUM_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OTS_CHECKSUM_NEON
+#include <arm_neon.h>
+#endif
+
+// Table checksums are sums of big-endian words modulo 2^32, so they can be
+// computed as several independent sums of byte-swapped words, added together
+// at the end.
+
+namespace {
+
+typedef uint32_t (*ChecksumFunction)(uint8_t *dest, const uint8_t *data,
+                                     size_t num_words);
+
+uint32_t ChecksumWordsScalar(uint8_t *dest, const uint8_t *data,
+                             size_t num_words) {
+  if (dest) {
+    std::memcpy(dest, data, num_words * 4);
+  }
+  uint32_t sum = 0;
+  for (size_t i = 0; i < num_words; ++i) {
+    uint32_t word;
+    std::memcpy(&word, data + i * 4, sizeof(uint32_t));
+    sum += ots_ntohl(word);
+  }
+  return sum;
+}
+
+#ifdef OTS_CHECKSUM_SSE2
+uint32_t ChecksumWordsSSE2(uint8_t *dest, const uint8_t *data,
+                           size_t num_words) {
+  __m128i sum = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= num_words; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 4));
+    if (dest) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), v);
+    }
+    // Swap the 16-bit halves of each word, then the bytes of each half.
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    sum = _mm_add_epi32(sum, v);
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(sum)) +
+      ChecksumWordsScalar(dest ? dest + i * 4 : NULL, data + i * 4,
+                          num_words - i);
+}
+#endif
+
+#ifdef OTS_CHECKSUM_AVX2
+__attribute__((target("avx2")))
+uint32_t ChecksumWordsAVX2(uint8_t *dest, const uint8_t *data,
+                           size_t num_words) {
+  const __m256i swap = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  __m256i sum = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= num_words; i += 8) {
+    __m256i v = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(data + i * 4));
+    if (dest) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * 4), v);
+    }
+    sum = _mm256_add_epi32(sum, _mm256_shuffle_epi8(v, swap));
+  }
+  __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4e));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xb1));
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(sum128)) +
+      ChecksumWordsSSE2(dest ? dest + i * 4 : NULL, data + i * 4,
+                        num_words - i);
+}
+#endif
+
+#ifdef OTS_CHECKSUM_NEON
+uint32_t ChecksumWordsNEON(uint8_t *dest, const uint8_t *data,
+                           size_t num_words) {
+  uint32x4_t sum = vdupq_n_u32(0);
+  size_t i = 0;
+  for (; i + 4 <= num_words; i += 4) {
+    const uint8x16_t v = vld1q_u8(data + i * 4);
+    if (dest) {
+      vst1q_u8(dest + i * 4, v);
+    }
+    sum = vaddq_u32(sum, vreinterpretq_u32_u8(vrev32q_u8(v)));
+  }
+  const uint32x2_t half = vadd_u32(vget_low_u32(sum), vget_high_u32(sum));
+  return vget_lane_u32(vpadd_u32(half, half), 0) +
+      ChecksumWordsScalar(dest ? dest + i * 4 : NULL, data + i * 4,
+                          num_words - i);
+}
+#endif
+
+ChecksumFunction ChooseChecksumFunction() {
+#ifdef OTS_CHECKSUM_AVX2
+  // This runs as a static initializer, possibly before the one that sets up
+  // what __builtin_cpu_supports() reads.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return ChecksumWordsAVX2;
+  }
+#endif
+#if defined(OTS_CHECKSUM_SSE2)
+  return ChecksumWordsSSE2;
+#elif defined(OTS_CHECKSUM_NEON)
+  return ChecksumWordsNEON;
+#else
+  return ChecksumWordsScalar;
+#endif
+}
+
+const ChecksumFunction g_checksum_words = ChooseChecksumFunction();
+
+}  // namespace
+
+namespace ots {
+
+uint32_t ChecksumWords(const void *data, size_t num_words) {
+  return g_checksum_words(NULL, static_cast<const uint8_t*>(data),
+                          num_words);
+}
+
+uint32_t CopyAndChecksumWords(void *dest, const void *data,
+                              size_t num_words) {
+  return g_checksum_words(static_cast<uint8_t*>(dest),
+                          static_cast<const uint8_t*>(data), num_words);
+}
+
+uint32_t ChecksumLarge(const void *data, size_t length, size_t position,
+                       void *dest) {
+  const uint8_t *src = static_cast<const uint8_t*>(data);
+  uint8_t *out = static_cast<uint8_t*>(dest);
+
+  // The bytes up to the next word boundary, and those after the last one.
+  const size_t head_length =
+      std::min(length, (static_cast<size_t>(4) - (position & 3)) & 3);
+  const size_t num_words = (length - head_length) / 4;
+  const size_t tail_offset = head_length + num_words * 4;
+
+  uint32_t sum = Checksum(src, head_length, position, out);
+  sum += g_checksum_words(out ? out + head_length : NULL, src + head_length,
+                          num_words);
+  sum += Checksum(src + tail_offset, length - tail_offset, 0,
+                  out ? out + tail_offset : NULL);
+  return sum;
+}
+
+}  // namespace ots
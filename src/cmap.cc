@@ -34,6 +34,29 @@ struct Subtable314Range {
   uint32_t id_range_offset_offset;
 };
 
+// startCharCode, endCharCode and startGlyphID of a format 12 or 13 group.
+typedef ots::Record<uint32_t, uint32_t, uint32_t> SequentialMapGroup;
+
+// Reads one of the arrays of a format 4 subtable into the |field| of each of
+// |ranges|, a block at a time.
+template <typename T>
+bool ReadSegmentArray(ots::Buffer &subtable,
+                      std::vector<Subtable314Range> &ranges,
+                      T Subtable314Range::*field) {
+  uint16_t block[256];
+  for (size_t i = 0; i < ranges.size(); ) {
+    const size_t block_length = std::min<size_t>(ranges.size() - i, 256);
+    if (!subtable.ReadU16Array(block, block_length)) {
+      return false;
+    }
+    for (size_t j = 0; j < block_length; ++j) {
+      ranges[i + j].*field = static_cast<T>(block[j]);
+    }
+    i += block_length;
+  }
+  return true;
+}
+
 // Glyph array size for the Mac Roman (format 0) table.
 const size_t kFormat0ArraySize = 256;
 
@@ -54,6 +77,143 @@ const uint32_t kIVSStart = 0xE0100;
 const uint32_t kIVSEnd = 0xE01EF;
 const uint32_t kUVSUpperLimit = 0xFFFFFF;
 
+// A code point of a format 4 subtable, and the glyph it maps to.
+typedef std::pair<uint16_t, uint16_t> Format4Mapping;
+
+// Reads the mappings of a format 4 subtable that has been parsed already, in
+// code point order, leaving out those to glyph 0.
+void DecodeFormat4(const uint8_t *data, size_t length,
+                   std::vector<Format4Mapping> *mappings) {
+  ots::Buffer subtable(data, length);
+  uint16_t segcountx2 = 0;
+  std::vector<uint16_t> end_codes, start_codes, deltas, range_offsets;
+  if (!subtable.Skip(6) ||
+      !subtable.ReadU16(&segcountx2) ||
+      !subtable.Skip(6) ||
+      !subtable.ReadU16Array(&end_codes, segcountx2 >> 1) ||
+      !subtable.Skip(2) ||
+      !subtable.ReadU16Array(&start_codes, segcountx2 >> 1) ||
+      !subtable.ReadU16Array(&deltas, segcountx2 >> 1)) {
+    return;
+  }
+  const size_t range_offsets_offset = subtable.offset();
+  if (!subtable.ReadU16Array(&range_offsets, segcountx2 >> 1)) {
+    return;
+  }
+
+  for (size_t i = 0; i < end_codes.size(); ++i) {
+    // 0xFFFF, which the last segment has, is not a character.
+    for (uint32_t cp = start_codes[i]; cp <= end_codes[i] && cp < 0xFFFF;
+         ++cp) {
+      uint16_t glyph = 0;
+      if (range_offsets[i] == 0) {
+        glyph = cp + deltas[i];
+      } else {
+        const size_t glyph_offset = range_offsets_offset + i * 2 +
+                                    range_offsets[i] +
+                                    (cp - start_codes[i]) * 2;
+        if (glyph_offset + 2 > length) {
+          break;
+        }
+        glyph = data[glyph_offset] << 8 | data[glyph_offset + 1];
+        if (glyph) {
+          glyph += deltas[i];
+        }
+      }
+      if (glyph) {
+        mappings->push_back(std::make_pair(cp, glyph));
+      }
+    }
+  }
+}
+
+void AppendU16(std::vector<uint8_t> *out, uint16_t value) {
+  out->push_back(value >> 8);
+  out->push_back(value & 0xff);
+}
+
+// Writes a format 4 subtable with |mappings|, in code point order, to |out|.
+// Returns false if it would be too long.
+bool EncodeFormat4(const std::vector<Format4Mapping> &mappings,
+                   std::vector<uint8_t> *out) {
+  // Each run of consecutive code points is a segment, mapped with a delta if
+  // its glyphs are consecutive too, or with an array of glyph ids otherwise.
+  struct Segment {
+    size_t begin;
+    size_t end;
+    bool uses_delta;
+    size_t first_glyph_id;
+  };
+  std::vector<Segment> segments;
+  size_t num_glyph_ids = 0;
+  for (size_t i = 0; i < mappings.size(); ) {
+    Segment segment = {i, i + 1, true, num_glyph_ids};
+    while (segment.end < mappings.size() &&
+           mappings[segment.end].first ==
+               mappings[segment.end - 1].first + 1) {
+      segment.uses_delta &=
+          mappings[segment.end].second ==
+              static_cast<uint16_t>(mappings[segment.end - 1].second + 1);
+      ++segment.end;
+    }
+    if (!segment.uses_delta) {
+      num_glyph_ids += segment.end - segment.begin;
+    }
+    segments.push_back(segment);
+    i = segment.end;
+  }
+
+  // And the last segment maps 0xFFFF to glyph 0.
+  const size_t segcount = segments.size() + 1;
+  const size_t length = 16 + segcount * 8 + num_glyph_ids * 2;
+  if (length > 0xFFFF) {
+    return false;
+  }
+  unsigned log2segcount = 0;
+  while (1u << (log2segcount + 1) <= segcount) {
+    log2segcount++;
+  }
+  const uint16_t search_range = 2 * 1u << log2segcount;
+
+  out->clear();
+  AppendU16(out, 4);
+  AppendU16(out, length);
+  AppendU16(out, 0);  // language
+  AppendU16(out, segcount * 2);
+  AppendU16(out, search_range);
+  AppendU16(out, log2segcount);
+  AppendU16(out, segcount * 2 - search_range);
+  for (const Segment &segment : segments) {
+    AppendU16(out, mappings[segment.end - 1].first);
+  }
+  AppendU16(out, 0xFFFF);
+  AppendU16(out, 0);  // reservedPad
+  for (const Segment &segment : segments) {
+    AppendU16(out, mappings[segment.begin].first);
+  }
+  AppendU16(out, 0xFFFF);
+  for (const Segment &segment : segments) {
+    const Format4Mapping &first = mappings[segment.begin];
+    AppendU16(out, segment.uses_delta ? first.second - first.first : 0);
+  }
+  AppendU16(out, 1);
+  for (size_t i = 0; i < segments.size(); ++i) {
+    // The offset is from where it is to the glyph id.
+    AppendU16(out, segments[i].uses_delta
+                       ? 0
+                       : (segcount - i + segments[i].first_glyph_id) * 2);
+  }
+  AppendU16(out, 0);
+  for (const Segment &segment : segments) {
+    if (!segment.uses_delta) {
+      for (size_t i = segment.begin; i < segment.end; ++i) {
+        AppendU16(out, mappings[i].second);
+      }
+    }
+  }
+  return true;
+}
+
 } // namespace
 
 namespace ots {
@@ -87,10 +247,8 @@ bool OpenTypeCMAP::ParseFormat4(int platform, int encoding,
 
   uint16_t segcountx2, search_range, entry_selector, range_shift;
   segcountx2 = search_range = entry_selector = range_shift = 0;
-  if (!subtable.ReadU16(&segcountx2) ||
-      !subtable.ReadU16(&search_range) ||
-      !subtable.ReadU16(&entry_selector) ||
-      !subtable.ReadU16(&range_shift)) {
+  if (!subtable.ReadRecord<Record<uint16_t, uint16_t, uint16_t, uint16_t> >(
+          &segcountx2, &search_range, &entry_selector, &range_shift)) {
     return Error("Failed to read subcmap structure");
   }
 
@@ -125,10 +283,8 @@ bool OpenTypeCMAP::ParseFormat4(int platform, int encoding,
 
   std::vector<Subtable314Range> ranges(segcount);
 
-  for (unsigned i = 0; i < segcount; ++i) {
-    if (!subtable.ReadU16(&ranges[i].end_range)) {
-      return Error("Failed to read segment %d", i);
-    }
+  if (!ReadSegmentArray(subtable, ranges, &Subtable314Range::end_range)) {
+    return Error("Failed to read segment end ranges");
   }
 
   uint16_t padding;
@@ -139,21 +295,19 @@ bool OpenTypeCMAP::ParseFormat4(int platform, int encoding,
     return Error("Non zero cmap subtable segment padding (%d)", padding);
   }
 
-  for (unsigned i = 0; i < segcount; ++i) {
-    if (!subtable.ReadU16(&ranges[i].start_range)) {
-      return Error("Failed to read segment start range %d", i);
-    }
+  if (!ReadSegmentArray(subtable, ranges, &Subtable314Range::start_range)) {
+    return Error("Failed to read segment start ranges");
   }
-  for (unsigned i = 0; i < segcount; ++i) {
-    if (!subtable.ReadS16(&ranges[i].id_delta)) {
-      return Error("Failed to read segment delta %d", i);
-    }
+  if (!ReadSegmentArray(subtable, ranges, &Subtable314Range::id_delta)) {
+    return Error("Failed to read segment deltas");
+  }
+  const size_t id_range_offsets = subtable.offset();
+  if (!ReadSegmentArray(subtable, ranges,
+                        &Subtable314Range::id_range_offset)) {
+    return Error("Failed to read segment range offsets");
   }
   for (unsigned i = 0; i < segcount; ++i) {
-    ranges[i].id_range_offset_offset = subtable.offset();
-    if (!subtable.ReadU16(&ranges[i].id_range_offset)) {
-      return Error("Failed to read segment range offset %d", i);
-    }
+    ranges[i].id_range_offset_offset = id_range_offsets + i * 2;
 
     if (ranges[i].id_range_offset & 1) {
       // Some font generators seem to put 65535 on id_range_offset
@@ -292,14 +446,16 @@ bool OpenTypeCMAP::Parse31012(const uint8_t *data, size_t length,
 
   std::vector<ots::OpenTypeCMAPSubtableRange> &groups
       = this->subtable_3_10_12;
+  BufferCursor records;
+  if (!subtable.ReserveRecords<SequentialMapGroup>(num_groups, &records)) {
+    return Error("can't read format 12 subtable group");
+  }
   groups.resize(num_groups);
 
   for (unsigned i = 0; i < num_groups; ++i) {
-    if (!subtable.ReadU32(&groups[i].start_range) ||
-        !subtable.ReadU32(&groups[i].end_range) ||
-        !subtable.ReadU32(&groups[i].start_glyph_id)) {
-      return Error("can't read format 12 subtable group");
-    }
+    records.Read<SequentialMapGroup>(&groups[i].start_range,
+                                     &groups[i].end_range,
+                                     &groups[i].start_glyph_id);
 
     if (groups[i].start_range > kUnicodeUpperLimit ||
         groups[i].end_range > kUnicodeUpperLimit ||
@@ -365,14 +521,16 @@ bool OpenTypeCMAP::Parse31013(const uint8_t *data, size_t length,
   }
 
   std::vector<ots::OpenTypeCMAPSubtableRange> &groups = this->subtable_3_10_13;
+  BufferCursor records;
+  if (!subtable.ReserveRecords<SequentialMapGroup>(num_groups, &records)) {
+    return Error("Can't read subrange structure in a cmap subtable");
+  }
   groups.resize(num_groups);
 
   for (unsigned i = 0; i < num_groups; ++i) {
-    if (!subtable.ReadU32(&groups[i].start_range) ||
-        !subtable.ReadU32(&groups[i].end_range) ||
-        !subtable.ReadU32(&groups[i].start_glyph_id)) {
-      return Error("Can't read subrange structure in a cmap subtable");
-    }
+    records.Read<SequentialMapGroup>(&groups[i].start_range,
+                                     &groups[i].end_range,
+                                     &groups[i].start_glyph_id);
 
     // We conservatively limit all of the values to protect some parsers from
     // overflows
@@ -422,14 +580,17 @@ bool OpenTypeCMAP::Parse0514(const uint8_t *data, size_t length) {
 
   std::vector<ots::OpenTypeCMAPSubtableVSRecord>& records
       = this->subtable_0_5_14;
+  typedef Record<Uint24, uint32_t, uint32_t> VariationSelector;
+  BufferCursor selectors;
+  if (!subtable.ReserveRecords<VariationSelector>(num_records, &selectors)) {
+    return Error("Can't read variation selector records in cmap subtable");
+  }
   records.resize(num_records);
 
   for (unsigned i = 0; i < num_records; ++i) {
-    if (!subtable.ReadU24(&records[i].var_selector) ||
-        !subtable.ReadU32(&records[i].default_offset) ||
-        !subtable.ReadU32(&records[i].non_default_offset)) {
-      return Error("Can't read record structure of record %d in cmap subtale", i);
-    }
+    selectors.Read<VariationSelector>(&records[i].var_selector,
+                                      &records[i].default_offset,
+                                      &records[i].non_default_offset);
     // Checks the value of variation selector
     if (!((records[i].var_selector >= kMongolianVSStart &&
            records[i].var_selector <= kMongolianVSEnd) ||
@@ -473,13 +634,16 @@ bool OpenTypeCMAP::Parse0514(const uint8_t *data, size_t length) {
       uint32_t last_unicode_value = 0;
       std::vector<ots::OpenTypeCMAPSubtableVSRange>& ranges
           = records[i].ranges;
+      typedef Record<Uint24, uint8_t> UnicodeRange;
+      BufferCursor range_records;
+      if (!subtable.ReserveRecords<UnicodeRange>(num_ranges, &range_records)) {
+        return Error("Can't read range info in variation selector record %d", i);
+      }
       ranges.resize(num_ranges);
 
       for (unsigned j = 0; j < num_ranges; ++j) {
-        if (!subtable.ReadU24(&ranges[j].unicode_value) ||
-            !subtable.ReadU8(&ranges[j].additional_count)) {
-          return Error("Can't read range info in variation selector record %d", i);
-        }
+        range_records.Read<UnicodeRange>(&ranges[j].unicode_value,
+                                         &ranges[j].additional_count);
         const uint32_t check_value =
             ranges[j].unicode_value + ranges[j].additional_count;
         if (ranges[j].unicode_value == 0 ||
@@ -507,13 +671,16 @@ bool OpenTypeCMAP::Parse0514(const uint8_t *data, size_t length) {
       uint32_t last_unicode_value = 0;
       std::vector<ots::OpenTypeCMAPSubtableVSMapping>& mappings
           = records[i].mappings;
+      typedef Record<Uint24, uint16_t> UVSMapping;
+      BufferCursor mapping_records;
+      if (!subtable.ReserveRecords<UVSMapping>(num_mappings, &mapping_records)) {
+        return Error("Can't read mappings in variation selector record %d", i);
+      }
       mappings.resize(num_mappings);
 
       for (unsigned j = 0; j < num_mappings; ++j) {
-        if (!subtable.ReadU24(&mappings[j].unicode_value) ||
-            !subtable.ReadU16(&mappings[j].glyph_id)) {
-          return Error("Can't read mapping %d in variation selector record %d", j, i);
-        }
+        mapping_records.Read<UVSMapping>(&mappings[j].unicode_value,
+                                         &mappings[j].glyph_id);
         if (mappings[j].glyph_id == 0 || mappings[j].unicode_value == 0) {
           return Error("Bad mapping (%04X -> %d) in mapping %d of variation selector %d", mappings[j].unicode_value, mappings[j].glyph_id, j, i);
         }
@@ -569,8 +736,7 @@ bool OpenTypeCMAP::Parse(const uint8_t *data, size_t length) {
 
   uint16_t version = 0;
   uint16_t num_tables = 0;
-  if (!table.ReadU16(&version) ||
-      !table.ReadU16(&num_tables)) {
+  if (!table.ReadRecord<Record<uint16_t, uint16_t> >(&version, &num_tables)) {
     return Error("Can't read structure of cmap");
   }
 
@@ -584,16 +750,16 @@ bool OpenTypeCMAP::Parse(const uint8_t *data, size_t length) {
   std::vector<CMAPSubtableHeader> subtable_headers;
 
   // read the subtable headers
+  typedef Record<uint16_t, uint16_t, uint32_t> EncodingRecord;
+  BufferCursor encoding_records;
+  if (!table.ReserveRecords<EncodingRecord>(num_tables, &encoding_records)) {
+    return Error("Can't read subtable information of cmap subtables");
+  }
   subtable_headers.reserve(num_tables);
   for (unsigned i = 0; i < num_tables; ++i) {
     CMAPSubtableHeader subt;
-
-    if (!table.ReadU16(&subt.platform) ||
-        !table.ReadU16(&subt.encoding) ||
-        !table.ReadU32(&subt.offset)) {
-      return Error("Can't read subtable information cmap subtable %d", i);
-    }
-
+    encoding_records.Read<EncodingRecord>(&subt.platform, &subt.encoding,
+                                          &subt.offset);
     subtable_headers.push_back(subt);
   }
 
@@ -834,6 +1000,189 @@ bool OpenTypeCMAP::Parse(const uint8_t *data, size_t length) {
     }
   }
 
+  // Some fonts don't have 3-0-4 MS Symbol nor 3-1-4 Unicode BMP tables
+  // (e.g., old fonts for Mac). We don't support them. This is checked here
+  // rather than when serializing, so that OTSContext::Validate() sees it.
+  if (!this->subtable_0_3_4_data && !this->subtable_3_0_4_data &&
+      !this->subtable_3_1_4_data && this->subtable_3_10_12.empty() &&
+      this->subtable_3_10_13.empty()) {
+    return Error("no supported subtables were found");
+  }
+
+  return true;
+}
+
+void OpenTypeCMAP::MapCodePoints(const std::vector<uint32_t>& code_points,
+                                 std::vector<bool> *glyphs) {
+  if (code_points.empty()) {
+    return;
+  }
+  std::vector<uint32_t> sorted_code_points(code_points);
+  std::sort(sorted_code_points.begin(), sorted_code_points.end());
+  const auto is_wanted = [&sorted_code_points](uint32_t code_point) {
+    return std::binary_search(sorted_code_points.begin(),
+                              sorted_code_points.end(), code_point);
+  };
+  const auto mark = [glyphs](uint32_t gid) {
+    if (gid < glyphs->size()) {
+      (*glyphs)[gid] = true;
+    }
+  };
+
+  const std::pair<const uint8_t*, size_t> format_4_subtables[] = {
+    std::make_pair(this->subtable_0_3_4_data, this->subtable_0_3_4_length),
+    std::make_pair(this->subtable_3_0_4_data, this->subtable_3_0_4_length),
+    std::make_pair(this->subtable_3_1_4_data, this->subtable_3_1_4_length),
+  };
+  std::vector<Format4Mapping> mappings;
+  for (const auto &subtable : format_4_subtables) {
+    if (!subtable.first) {
+      continue;
+    }
+    mappings.clear();
+    DecodeFormat4(subtable.first, subtable.second, &mappings);
+    for (const Format4Mapping &mapping : mappings) {
+      if (is_wanted(mapping.first)) {
+        mark(mapping.second);
+      }
+    }
+  }
+
+  // Format 12 groups map consecutive code points to consecutive glyphs, and
+  // format 13 ones to a single glyph.
+  for (int format = 12; format <= 13; ++format) {
+    const std::vector<OpenTypeCMAPSubtableRange> &groups =
+        format == 12 ? this->subtable_3_10_12 : this->subtable_3_10_13;
+    for (uint32_t code_point : sorted_code_points) {
+      auto group = std::upper_bound(
+          groups.begin(), groups.end(), code_point,
+          [](uint32_t cp, const OpenTypeCMAPSubtableRange &range) {
+            return cp < range.start_range;
+          });
+      if (group == groups.begin() || (--group)->end_range < code_point) {
+        continue;
+      }
+      mark(group->start_glyph_id +
+           (format == 12 ? code_point - group->start_range : 0));
+    }
+  }
+
+  for (const OpenTypeCMAPSubtableVSRecord &record : this->subtable_0_5_14) {
+    for (const OpenTypeCMAPSubtableVSMapping &mapping : record.mappings) {
+      if (is_wanted(mapping.unicode_value)) {
+        mark(mapping.glyph_id);
+      }
+    }
+  }
+}
+
+bool OpenTypeCMAP::SubsetFormat4(const std::vector<bool>& glyphs,
+                                 const uint8_t **data, size_t *length,
+                                 std::vector<uint8_t> *subset) {
+  if (!*data) {
+    return true;
+  }
+  std::vector<Format4Mapping> mappings;
+  DecodeFormat4(*data, *length, &mappings);
+  size_t num_kept = 0;
+  for (const Format4Mapping &mapping : mappings) {
+    if (mapping.second < glyphs.size() && glyphs[mapping.second]) {
+      mappings[num_kept++] = mapping;
+    }
+  }
+  mappings.resize(num_kept);
+
+  if (!EncodeFormat4(mappings, subset)) {
+    return Warning("Format 4 subtable too long once subset, kept as is");
+  }
+  *data = subset->data();
+  *length = subset->size();
+  return true;
+}
+
+bool OpenTypeCMAP::Subset(const std::vector<bool>& glyphs) {
+  const auto is_kept = [&glyphs](uint32_t gid) {
+    return gid < glyphs.size() && glyphs[gid];
+  };
+
+  if (!SubsetFormat4(glyphs, &this->subtable_0_3_4_data,
+                     &this->subtable_0_3_4_length, &this->subset_0_3_4) ||
+      !SubsetFormat4(glyphs, &this->subtable_3_0_4_data,
+                     &this->subtable_3_0_4_length, &this->subset_3_0_4) ||
+      !SubsetFormat4(glyphs, &this->subtable_3_1_4_data,
+                     &this->subtable_3_1_4_length, &this->subset_3_1_4)) {
+    return false;
+  }
+
+  // Format 12 groups are split where glyphs are removed, and joined where
+  // they then follow each other.
+  std::vector<OpenTypeCMAPSubtableRange> groups;
+  for (const OpenTypeCMAPSubtableRange &group : this->subtable_3_10_12) {
+    for (uint32_t cp = group.start_range; cp <= group.end_range; ++cp) {
+      const uint32_t gid = group.start_glyph_id + (cp - group.start_range);
+      if (!is_kept(gid)) {
+        continue;
+      }
+      if (!groups.empty() && groups.back().end_range + 1 == cp &&
+          groups.back().start_glyph_id +
+              (cp - groups.back().start_range) == gid) {
+        groups.back().end_range = cp;
+      } else {
+        const OpenTypeCMAPSubtableRange range = {cp, cp, gid};
+        groups.push_back(range);
+      }
+    }
+  }
+  this->subtable_3_10_12.swap(groups);
+
+  groups.clear();
+  for (const OpenTypeCMAPSubtableRange &group : this->subtable_3_10_13) {
+    if (is_kept(group.start_glyph_id)) {
+      groups.push_back(group);
+    }
+  }
+  this->subtable_3_10_13.swap(groups);
+
+  for (uint8_t &glyph : this->subtable_1_0_0) {
+    if (!is_kept(glyph)) {
+      glyph = 0;
+    }
+  }
+
+  // Variation sequences only go if they map to a removed glyph; the offsets
+  // and length of the subtable are worked out again if any did.
+  std::vector<OpenTypeCMAPSubtableVSRecord> &records = this->subtable_0_5_14;
+  bool records_changed = false;
+  size_t num_records = 0;
+  for (size_t i = 0; i < records.size(); ++i) {
+    std::vector<OpenTypeCMAPSubtableVSMapping> &mappings = records[i].mappings;
+    size_t num_mappings = 0;
+    for (const OpenTypeCMAPSubtableVSMapping &mapping : mappings) {
+      if (is_kept(mapping.glyph_id)) {
+        mappings[num_mappings++] = mapping;
+      }
+    }
+    records_changed |= num_mappings != mappings.size();
+    mappings.resize(num_mappings);
+    if (!records[i].ranges.empty() || !mappings.empty()) {
+      if (num_records != i) {
+        records[num_records] = records[i];
+      }
+      ++num_records;
+    }
+  }
+  records.resize(num_records);
+  if (records_changed) {
+    uint32_t offset = 10 + 11 * records.size();
+    for (OpenTypeCMAPSubtableVSRecord &record : records) {
+      record.default_offset = record.ranges.empty() ? 0 : offset;
+      offset += record.ranges.empty() ? 0 : 4 + 4 * record.ranges.size();
+      record.non_default_offset = record.mappings.empty() ? 0 : offset;
+      offset += record.mappings.empty() ? 0 : 4 + 5 * record.mappings.size();
+    }
+    this->subtable_0_5_14_length = offset;
+  }
+
   return true;
 }
 
@@ -856,12 +1205,6 @@ bool OpenTypeCMAP::Serialize(OTSStream *out) {
                                  static_cast<uint16_t>(have_31013);
   const off_t table_start = out->Tell();
 
-  // Some fonts don't have 3-0-4 MS Symbol nor 3-1-4 Unicode BMP tables
-  // (e.g., old fonts for Mac). We don't support them.
-  if (!have_304 && !have_314 && !have_034 && !have_31012 && !have_31013) {
-    return Error("no supported subtables were found");
-  }
-
   if (!out->WriteU16(0) ||
       !out->WriteU16(num_subtables)) {
     return OTS_FAILURE();
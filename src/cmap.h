@@ -51,6 +51,13 @@ class OpenTypeCMAP : public Table {
   bool Parse(const uint8_t *data, size_t length);
   bool Serialize(OTSStream *out);
 
+  // Marks in |glyphs| those that the Unicode subtables map |code_points| to,
+  // alone or in a variation sequence.
+  void MapCodePoints(const std::vector<uint32_t>& code_points,
+                     std::vector<bool> *glyphs);
+  // Removes the mappings to the glyphs not marked in |glyphs|.
+  bool Subset(const std::vector<bool>& glyphs);
+
  private:
   // Platform 0, Encoding 3, Format 4, Unicode BMP table.
   const uint8_t *subtable_0_3_4_data;
@@ -74,6 +81,16 @@ class OpenTypeCMAP : public Table {
   // Platform 1, Encoding 0, Format 0, Mac Roman table.
   std::vector<uint8_t> subtable_1_0_0;
 
+  // The format 4 subtables once subset, which the pointers above then point
+  // to.
+  std::vector<uint8_t> subset_0_3_4;
+  std::vector<uint8_t> subset_3_0_4;
+  std::vector<uint8_t> subset_3_1_4;
+
+  bool SubsetFormat4(const std::vector<bool>& glyphs,
+                     const uint8_t **data, size_t *length,
+                     std::vector<uint8_t> *subset);
+
   bool ParseFormat4(int platform, int encoding, const uint8_t *data,
                     size_t length, uint16_t num_glyphs);
   bool Parse31012(const uint8_t *data, size_t length, uint16_t num_glyphs);
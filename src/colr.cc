@@ -93,17 +93,22 @@ bool ParseColorLine(const ots::Font* font,
     OTS_WARNING("Unknown color-line extend mode %u", extend);
   }
 
+  // A VarColorStop is a ColorStop followed by a VarIdxBase.
+  typedef ots::Record<F2DOT14, uint16_t, F2DOT14> ColorStop;
+  const size_t stopSize = ColorStop::kSize + (var ? 4 : 0);
+  ots::BufferCursor stops;
+  if (!subtable.Reserve(numColorStops * stopSize, &stops)) {
+    return OTS_FAILURE_MSG("Failed to read [Var]ColorStop");
+  }
+
   for (auto i = 0u; i < numColorStops; ++i) {
     F2DOT14 stopOffset;
     uint16_t paletteIndex;
     F2DOT14 alpha;
-    VarIdxBase varIndexBase;
 
-    if (!subtable.ReadS16(&stopOffset) ||
-        !subtable.ReadU16(&paletteIndex) ||
-        !subtable.ReadS16(&alpha) ||
-        (var && !subtable.ReadU32(&varIndexBase))) {
-      return OTS_FAILURE_MSG("Failed to read [Var]ColorStop");
+    stops.Read<ColorStop>(&stopOffset, &paletteIndex, &alpha);
+    if (var) {
+      stops.Skip(sizeof(VarIdxBase));
     }
 
     if (paletteIndex >= state.numPaletteEntries && paletteIndex != 0xffffu) {
@@ -724,17 +729,19 @@ bool ParseBaseGlyphRecords(const ots::Font* font,
 {
   ots::Buffer subtable(data, length);
 
+  typedef ots::Record<uint16_t, uint16_t, uint16_t> BaseGlyphRecord;
+  ots::BufferCursor records;
+  if (!subtable.ReserveRecords<BaseGlyphRecord>(numBaseGlyphRecords, &records)) {
+    return OTS_FAILURE_MSG("Failed to read base glyph record");
+  }
+
   int32_t prevGlyphID = -1;
   for (auto i = 0u; i < numBaseGlyphRecords; ++i) {
     uint16_t glyphID,
              firstLayerIndex,
              numLayers;
 
-    if (!subtable.ReadU16(&glyphID) ||
-        !subtable.ReadU16(&firstLayerIndex) ||
-        !subtable.ReadU16(&numLayers)) {
-      return OTS_FAILURE_MSG("Failed to read base glyph record");
-    }
+    records.Read<BaseGlyphRecord>(&glyphID, &firstLayerIndex, &numLayers);
 
     if (glyphID >= int32_t(state.numGlyphs)) {
       return OTS_FAILURE_MSG("Base glyph record glyph ID %u out of bounds", glyphID);
@@ -761,14 +768,17 @@ bool ParseLayerRecords(const ots::Font* font,
 {
   ots::Buffer subtable(data, length);
 
+  typedef ots::Record<uint16_t, uint16_t> LayerRecord;
+  ots::BufferCursor records;
+  if (!subtable.ReserveRecords<LayerRecord>(numLayerRecords, &records)) {
+    return OTS_FAILURE_MSG("Failed to read layer record");
+  }
+
   for (auto i = 0u; i < numLayerRecords; ++i) {
     uint16_t glyphID,
              paletteIndex;
 
-    if (!subtable.ReadU16(&glyphID) ||
-        !subtable.ReadU16(&paletteIndex)) {
-      return OTS_FAILURE_MSG("Failed to read layer record");
-    }
+    records.Read<LayerRecord>(&glyphID, &paletteIndex);
 
     if (glyphID >= int32_t(state.numGlyphs)) {
       return OTS_FAILURE_MSG("Layer record glyph ID %u out of bounds", glyphID);
@@ -794,6 +804,13 @@ bool ParseBaseGlyphList(const ots::Font* font,
     return OTS_FAILURE_MSG("Failed to read base glyph list");
   }
 
+  typedef ots::Record<uint16_t, uint32_t> BaseGlyphPaintRecord;
+  ots::BufferCursor records;
+  if (!subtable.ReserveRecords<BaseGlyphPaintRecord>(numBaseGlyphPaintRecords,
+                                                     &records)) {
+    return OTS_FAILURE_MSG("Failed to read base glyph list");
+  }
+
   int32_t prevGlyphID = -1;
   // We first collect all the glyph IDs present, and their paint offsets,
   // then check they can all be parsed.
@@ -801,10 +818,7 @@ bool ParseBaseGlyphList(const ots::Font* font,
     uint16_t glyphID;
     uint32_t paintOffset;
 
-    if (!subtable.ReadU16(&glyphID) ||
-        !subtable.ReadU32(&paintOffset)) {
-      return OTS_FAILURE_MSG("Failed to read base glyph list");
-    }
+    records.Read<BaseGlyphPaintRecord>(&glyphID, &paintOffset);
 
     if (glyphID >= int32_t(state.numGlyphs)) {
       return OTS_FAILURE_MSG("Base glyph list glyph ID %u out of bounds", glyphID);
@@ -850,12 +864,14 @@ bool ParseLayerList(const ots::Font* font,
     return OTS_FAILURE_MSG("Failed to read layer list");
   }
 
-  for (auto i = 0u; i < numLayers; ++i) {
-    uint32_t paintOffset;
+  ots::BufferCursor paintOffsets;
+  if (!subtable.ReserveRecords<ots::Record<uint32_t> >(numLayers,
+                                                      &paintOffsets)) {
+    return OTS_FAILURE_MSG("Failed to read layer list");
+  }
 
-    if (!subtable.ReadU32(&paintOffset)) {
-      return OTS_FAILURE_MSG("Failed to read layer list");
-    }
+  for (auto i = 0u; i < numLayers; ++i) {
+    const uint32_t paintOffset = paintOffsets.ReadU32();
 
     if (!paintOffset || paintOffset >= length) {
       return OTS_FAILURE_MSG("Invalid paint offset in layer list");
@@ -922,17 +938,19 @@ bool ParseClipList(const ots::Font* font,
     return OTS_FAILURE_MSG("Unknown clip list format: %u", format);
   }
 
+  typedef ots::Record<uint16_t, uint16_t, ots::Uint24> ClipRecord;
+  ots::BufferCursor records;
+  if (!subtable.ReserveRecords<ClipRecord>(numClipRecords, &records)) {
+    return OTS_FAILURE_MSG("Failed to read clip list");
+  }
+
   int32_t prevEndGlyphID = -1;
   for (auto i = 0u; i < numClipRecords; ++i) {
     uint16_t startGlyphID,
              endGlyphID;
     uint32_t clipBoxOffset;
 
-    if (!subtable.ReadU16(&startGlyphID) ||
-        !subtable.ReadU16(&endGlyphID) ||
-        !subtable.ReadU24(&clipBoxOffset)) {
-      return OTS_FAILURE_MSG("Failed to read clip list");
-    }
+    records.Read<ClipRecord>(&startGlyphID, &endGlyphID, &clipBoxOffset);
 
     if (int32_t(startGlyphID) <= prevEndGlyphID ||
         endGlyphID < startGlyphID ||
@@ -971,11 +989,10 @@ bool OpenTypeCOLR::Parse(const uint8_t *data, size_t length) {
   uint32_t offsetBaseGlyphRecords = 0;
   uint32_t offsetLayerRecords = 0;
   uint16_t numLayerRecords = 0;
-  if (!table.ReadU16(&version) ||
-      !table.ReadU16(&numBaseGlyphRecords) ||
-      !table.ReadU32(&offsetBaseGlyphRecords) ||
-      !table.ReadU32(&offsetLayerRecords) ||
-      !table.ReadU16(&numLayerRecords)) {
+  if (!table.ReadRecord<Record<uint16_t, uint16_t, uint32_t, uint32_t,
+                              uint16_t> >(
+          &version, &numBaseGlyphRecords, &offsetBaseGlyphRecords,
+          &offsetLayerRecords, &numLayerRecords)) {
     return Error("Incomplete table");
   }
 
@@ -991,11 +1008,10 @@ bool OpenTypeCOLR::Parse(const uint8_t *data, size_t length) {
   uint32_t offsetItemVariationStore = 0;
 
   if (version == 1) {
-    if (!table.ReadU32(&offsetBaseGlyphList) ||
-        !table.ReadU32(&offsetLayerList) ||
-        !table.ReadU32(&offsetClipList) ||
-        !table.ReadU32(&offsetVarIdxMap) ||
-        !table.ReadU32(&offsetItemVariationStore)) {
+    if (!table.ReadRecord<Record<uint32_t, uint32_t, uint32_t, uint32_t,
+                                uint32_t> >(
+            &offsetBaseGlyphList, &offsetLayerList, &offsetClipList,
+            &offsetVarIdxMap, &offsetItemVariationStore)) {
       return Error("Incomplete v.1 table");
     }
     headerSize = sizeof(COLRv1);
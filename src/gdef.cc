@@ -228,6 +228,8 @@ bool OpenTypeGDEF::ParseMarkGlyphSetsDefTable(const uint8_t *data, size_t length
 }
 
 bool OpenTypeGDEF::Parse(const uint8_t *data, size_t length) {
+  LayoutSubtableCounter counter(this, data, length);
+
   OpenTypeMAXP *maxp = static_cast<OpenTypeMAXP*>(
       GetFont()->GetTypedTable(OTS_TAG_MAXP));
 
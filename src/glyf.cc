@@ -11,35 +11,101 @@
 #include "loca.h"
 #include "maxp.h"
 #include "name.h"
+#include "parallel.h"
 
 // glyf - Glyph Data
 // http://www.microsoft.com/typography/otspec/glyf.htm
 
 #define TABLE_NAME "glyf"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OTS_GLYF_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#ifdef OTS_GLYF_SSE2
+// Counts the bytes of each kind of coordinate of the flags at |p|, up to the
+// first of the next |max_count| (at most 16, though 16 bytes are read) that
+// repeats or has bit 6 or 7 set, which only the flag-by-flag parser knows
+// what to do with. Returns how many flags that is.
+unsigned CountCoordinateBytes(const uint8_t *p, unsigned max_count,
+                              uint32_t *x_length, uint32_t *y_length) {
+  const __m128i flags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  // Bits 7, 6 and 3 of each flag, moved to the top bit of their byte.
+  const __m128i special = _mm_or_si128(
+      flags, _mm_or_si128(_mm_slli_epi16(flags, 1), _mm_slli_epi16(flags, 4)));
+  const int special_flags = _mm_movemask_epi8(special);
+  unsigned count = 0;
+  while (count < max_count && !(special_flags & (1 << count))) {
+    ++count;
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  // A short coordinate takes 1 byte, a long one 2 and a repeated one none.
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i two = _mm_set1_epi8(2);
+  const __m128i x_short = _mm_cmpeq_epi8(
+      _mm_and_si128(flags, _mm_set1_epi8(1 << 1)), _mm_set1_epi8(1 << 1));
+  const __m128i x_same = _mm_cmpeq_epi8(
+      _mm_and_si128(flags, _mm_set1_epi8(1 << 4)), _mm_set1_epi8(1 << 4));
+  const __m128i y_short = _mm_cmpeq_epi8(
+      _mm_and_si128(flags, _mm_set1_epi8(1 << 2)), _mm_set1_epi8(1 << 2));
+  const __m128i y_same = _mm_cmpeq_epi8(
+      _mm_and_si128(flags, _mm_set1_epi8(1 << 5)), _mm_set1_epi8(1 << 5));
+  const __m128i counted = _mm_cmplt_epi8(
+      _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm_set1_epi8(static_cast<char>(count)));
+  const __m128i x_bytes = _mm_and_si128(counted, _mm_or_si128(
+      _mm_and_si128(x_short, one),
+      _mm_andnot_si128(_mm_or_si128(x_short, x_same), two)));
+  const __m128i y_bytes = _mm_and_si128(counted, _mm_or_si128(
+      _mm_and_si128(y_short, one),
+      _mm_andnot_si128(_mm_or_si128(y_short, y_same), two)));
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i x_sums = _mm_sad_epu8(x_bytes, zero);
+  const __m128i y_sums = _mm_sad_epu8(y_bytes, zero);
+  *x_length = _mm_cvtsi128_si32(x_sums) +
+              _mm_cvtsi128_si32(_mm_srli_si128(x_sums, 8));
+  *y_length = _mm_cvtsi128_si32(y_sums) +
+              _mm_cvtsi128_si32(_mm_srli_si128(y_sums, 8));
+  return count;
+}
+#endif
+
+}  // namespace
+
 namespace ots {
 
 bool OpenTypeGLYF::ParseFlagsForSimpleGlyph(Buffer &glyph,
                                             uint32_t num_flags,
                                             std::vector<uint8_t>& flags,
                                             uint32_t *flag_index,
-                                            uint32_t *coordinates_length) {
+                                            uint32_t *x_length,
+                                            uint32_t *y_length,
+                                            GlyphRange *range) {
   uint8_t flag = 0;
   if (!glyph.ReadU8(&flag)) {
-    return Error("Can't read flag");
+    return range->Error("Can't read flag");
   }
 
-  uint32_t delta = 0;
+  uint32_t x_delta = 0;
   if (flag & (1u << 1)) {  // x-Short
-    ++delta;
+    ++x_delta;
   } else if (!(flag & (1u << 4))) {
-    delta += 2;
+    x_delta += 2;
   }
 
+  uint32_t y_delta = 0;
   if (flag & (1u << 2)) {  // y-Short
-    ++delta;
+    ++y_delta;
   } else if (!(flag & (1u << 5))) {
-    delta += 2;
+    y_delta += 2;
   }
 
   /* MS and Apple specs say this bit is reserved and must be set to zero, but
@@ -48,7 +114,7 @@ bool OpenTypeGLYF::ParseFlagsForSimpleGlyph(Buffer &glyph,
    * https://developer.apple.com/fonts/TrueType-Reference-Manual/RM06/Chap6AATIntro.html
    * (“Overlapping contours” section) */
   if (flag & (1u << 6) && *flag_index != 0) {
-    return Error("Bad glyph flag (%d), "
+    return range->Error("Bad glyph flag (%d), "
                  "bit 6 must be set to zero for flag %d", flag, *flag_index);
   }
 
@@ -56,19 +122,20 @@ bool OpenTypeGLYF::ParseFlagsForSimpleGlyph(Buffer &glyph,
 
   if (flag & (1u << 3)) {  // repeat
     if (*flag_index + 1 >= num_flags) {
-      return Error("Count too high (%d + 1 >= %d)", *flag_index, num_flags);
+      return range->Error("Count too high (%d + 1 >= %d)", *flag_index, num_flags);
     }
     uint8_t repeat = 0;
     if (!glyph.ReadU8(&repeat)) {
-      return Error("Can't read repeat value");
+      return range->Error("Can't read repeat value");
     }
     if (repeat == 0) {
-      return Error("Zero repeat");
+      return range->Error("Zero repeat");
     }
-    delta += (delta * repeat);
+    x_delta += (x_delta * repeat);
+    y_delta += (y_delta * repeat);
 
     if (*flag_index + repeat >= num_flags) {
-      return Error("Count too high (%d >= %d)", *flag_index + repeat, num_flags);
+      return range->Error("Count too high (%d >= %d)", *flag_index + repeat, num_flags);
     }
 
     while (repeat--) {
@@ -77,13 +144,15 @@ bool OpenTypeGLYF::ParseFlagsForSimpleGlyph(Buffer &glyph,
   }
 
   if (flag & (1u << 7)) {  // reserved flag
-    return Error("Bad glyph flag (%d), reserved bit 7 must be set to zero", flag);
+    return range->Error("Bad glyph flag (%d), reserved bit 7 must be set to zero", flag);
   }
 
-  *coordinates_length += delta;
-  if (glyph.length() < *coordinates_length) {
-    return Error("Glyph coordinates length bigger than glyph length (%d > %d)",
-                 *coordinates_length, glyph.length());
+  *x_length += x_delta;
+  *y_length += y_delta;
+  const uint32_t coordinates_length = *x_length + *y_length;
+  if (glyph.length() < coordinates_length) {
+    return range->Error("Glyph coordinates length bigger than glyph length (%d > %d)",
+                 coordinates_length, glyph.length());
   }
 
   return true;
@@ -94,6 +163,30 @@ bool OpenTypeGLYF::ParseFlagsForSimpleGlyph(Buffer &glyph,
 #define X_IS_SAME_OR_POSITIVE_X_SHORT_VECTOR  (1u << 4)
 #define Y_IS_SAME_OR_POSITIVE_Y_SHORT_VECTOR  (1u << 5)
 
+namespace {
+
+// Returns the change in the coordinate of a point with |flag|, along the axis
+// of the flag bits |kShort| and |kSameOrPositive|, from the one or two bytes
+// of it at |*p|, and moves |*p| past them. To not branch on the flag, two
+// bytes are always read: the byte before |*p| (a flag, if nothing else) for a
+// change that takes no bytes, and the byte at |*p| twice for a short one.
+template <unsigned kShort, unsigned kSameOrPositive>
+inline int16_t ReadCoordinateDelta(const uint8_t **p, uint8_t flag) {
+  const bool is_short = flag & kShort;
+  const bool same_or_positive = flag & kSameOrPositive;
+  const bool is_long = !is_short && !same_or_positive;
+  const ptrdiff_t first = (!is_short && same_or_positive) ? -1 : 0;
+  const ptrdiff_t second = is_long ? 1 : first;
+  const int high = (*p)[first];
+  const int low = (*p)[second];
+  const int short_delta = same_or_positive ? high : -high;
+  const int long_delta = static_cast<int16_t>((high << 8) | low);
+  *p += is_short ? 1 : (is_long ? 2 : 0);
+  return is_short ? short_delta : (is_long ? long_delta : 0);
+}
+
+}  // namespace
+
 bool OpenTypeGLYF::ParseSimpleGlyph(Buffer &glyph,
                                     unsigned gid,
                                     int16_t num_contours,
@@ -101,79 +194,100 @@ bool OpenTypeGLYF::ParseSimpleGlyph(Buffer &glyph,
                                     int16_t ymin,
                                     int16_t xmax,
                                     int16_t ymax,
-                                    bool is_tricky_font) {
+                                    bool is_tricky_font,
+                                    GlyphRange *range) {
   // read the end-points array
   uint16_t num_flags = 0;
   for (int i = 0; i < num_contours; ++i) {
     uint16_t tmp_index = 0;
     if (!glyph.ReadU16(&tmp_index)) {
-      return Error("Can't read contour index %d (glyph %u)", i, gid);
+      return range->Error("Can't read contour index %d (glyph %u)", i, gid);
     }
     if (tmp_index == 0xffffu) {
-      return Error("Bad contour index %d (glyph %u)", i, gid);
+      return range->Error("Bad contour index %d (glyph %u)", i, gid);
     }
     // check if the indices are monotonically increasing
     if (i && (tmp_index + 1 <= num_flags)) {
-      return Error("Decreasing contour index %d + 1 <= %d (glyph %u)", tmp_index, num_flags, gid);
+      return range->Error("Decreasing contour index %d + 1 <= %d (glyph %u)", tmp_index, num_flags, gid);
     }
     num_flags = tmp_index + 1;
   }
 
-  if (this->maxp->version_1 &&
-      num_flags > this->maxp->max_points) {
-    Warning("Number of contour points exceeds maxp maxPoints, adjusting limit (glyph %u)", gid);
-    this->maxp->max_points = num_flags;
+  if (this->maxp->version_1 && num_flags > range->max_points) {
+    range->events.push_back(
+        GlyphRange::Event(GlyphRange::Event::kPoints, gid, num_flags));
+    range->max_points = num_flags;
   }
 
   uint16_t bytecode_length = 0;
   if (!glyph.ReadU16(&bytecode_length)) {
-    return Error("Can't read bytecode length");
+    return range->Error("Can't read bytecode length");
   }
 
-  if (this->maxp->version_1 &&
-      this->maxp->max_size_glyf_instructions < bytecode_length) {
-    Warning("Bytecode length is bigger than maxp.maxSizeOfInstructions %d: %d (glyph %u)",
-            this->maxp->max_size_glyf_instructions, bytecode_length, gid);
-    this->maxp->max_size_glyf_instructions = bytecode_length;
+  if (this->maxp->version_1 && range->max_instructions < bytecode_length) {
+    range->events.push_back(GlyphRange::Event(
+        GlyphRange::Event::kInstructions, gid, bytecode_length));
+    range->max_instructions = bytecode_length;
   }
 
   if (!glyph.Skip(bytecode_length)) {
-    return Error("Can't read bytecode of length %d (glyph %u)", bytecode_length, gid);
+    return range->Error("Can't read bytecode of length %d (glyph %u)", bytecode_length, gid);
   }
 
-  uint32_t coordinates_length = 0;
-  std::vector<uint8_t> flags(num_flags);
+  // The flags are expanded, one per point, into |flags|. Those that do not
+  // repeat are copied 16 bytes at a time, hence the room past the last one.
+  uint32_t x_length = 0;
+  uint32_t y_length = 0;
+  std::vector<uint8_t>& flags = range->point_flags;
+  flags.resize(num_flags + 16);
   for (uint32_t i = 0; i < num_flags; ++i) {
-    if (!ParseFlagsForSimpleGlyph(glyph, num_flags, flags, &i, &coordinates_length)) {
-      return Error("Failed to parse glyph flags %d (glyph %u)", i, gid);
+#ifdef OTS_GLYF_SSE2
+    while (glyph.remaining() >= 16) {
+      const uint8_t *block = glyph.buffer() + glyph.offset();
+      uint32_t block_x_length = 0;
+      uint32_t block_y_length = 0;
+      const unsigned count = CountCoordinateBytes(
+          block, std::min<uint32_t>(num_flags - i, 16),
+          &block_x_length, &block_y_length);
+      if (count == 0 ||
+          glyph.length() < x_length + y_length +
+                           block_x_length + block_y_length) {
+        break;
+      }
+      std::memcpy(&flags[i], block, 16);
+      x_length += block_x_length;
+      y_length += block_y_length;
+      glyph.Skip(count);
+      i += count;
+      if (count < 16) {
+        break;
+      }
+    }
+    if (i == num_flags) {
+      break;
     }
+#endif
+    if (!ParseFlagsForSimpleGlyph(glyph, num_flags, flags, &i,
+                                  &x_length, &y_length, range)) {
+      return range->Error("Failed to parse glyph flags %d (glyph %u)", i, gid);
+    }
+  }
+
+  // All the coordinates are known to be there, x ones and then y ones.
+  if (glyph.remaining() < x_length + y_length) {
+    return range->Error("Glyph too short %d (glyph %u)", glyph.length(), gid);
   }
+  const uint8_t *coordinates = glyph.buffer() + glyph.offset();
+  glyph.Skip(x_length + y_length);
 
   bool adjusted_bbox = false;
   int16_t x = 0, y = 0;
 
   // Read and check x-coords
   for (uint32_t i = 0; i < num_flags; ++i) {
-    uint8_t flag = flags[i];
-    if (flag & X_SHORT_VECTOR) {
-      uint8_t dx;
-      if (!glyph.ReadU8(&dx)) {
-        return Error("Glyph too short %d (glyph %u)", glyph.length(), gid);
-      }
-      if (flag & X_IS_SAME_OR_POSITIVE_X_SHORT_VECTOR) {
-        x += dx;
-      } else {
-        x -= dx;
-      }
-    } else if (flag & X_IS_SAME_OR_POSITIVE_X_SHORT_VECTOR) {
-      // x remains unchanged
-    } else {
-      int16_t dx;
-      if (!glyph.ReadS16(&dx)) {
-        return Error("Glyph too short %d (glyph %u)", glyph.length(), gid);
-      }
-      x += dx;
-    }
+    x += ReadCoordinateDelta<X_SHORT_VECTOR,
+                             X_IS_SAME_OR_POSITIVE_X_SHORT_VECTOR>(
+        &coordinates, flags[i]);
     if (x < xmin) {
       xmin = x;
       adjusted_bbox = true;
@@ -186,26 +300,9 @@ bool OpenTypeGLYF::ParseSimpleGlyph(Buffer &glyph,
 
   // Read and check y-coords
   for (uint32_t i = 0; i < num_flags; ++i) {
-    uint8_t flag = flags[i];
-    if (flag & Y_SHORT_VECTOR) {
-      uint8_t dy;
-      if (!glyph.ReadU8(&dy)) {
-        return Error("Glyph too short %d (glyph %u)", glyph.length(), gid);
-      }
-      if (flag & Y_IS_SAME_OR_POSITIVE_Y_SHORT_VECTOR) {
-        y += dy;
-      } else {
-        y -= dy;
-      }
-    } else if (flag & Y_IS_SAME_OR_POSITIVE_Y_SHORT_VECTOR) {
-      // x remains unchanged
-    } else {
-      int16_t dy;
-      if (!glyph.ReadS16(&dy)) {
-        return Error("Glyph too short %d (glyph %u)", glyph.length(), gid);
-      }
-      y += dy;
-    }
+    y += ReadCoordinateDelta<Y_SHORT_VECTOR,
+                             Y_IS_SAME_OR_POSITIVE_Y_SHORT_VECTOR>(
+        &coordinates, flags[i]);
     if (y < ymin) {
       ymin = y;
       adjusted_bbox = true;
@@ -219,19 +316,19 @@ bool OpenTypeGLYF::ParseSimpleGlyph(Buffer &glyph,
   if (glyph.remaining() > 3) {
     // We allow 0-3 bytes difference since gly_length is 4-bytes aligned,
     // zero-padded length.
-    Warning("Extra bytes at end of the glyph: %d (glyph %u)", glyph.remaining(), gid);
+    range->Warning("Extra bytes at end of the glyph: %d (glyph %u)", glyph.remaining(), gid);
   }
 
   if (adjusted_bbox) {
     if (is_tricky_font) {
-      Warning("Glyph bbox was incorrect; NOT adjusting tricky font (glyph %u)", gid);
+      range->Warning("Glyph bbox was incorrect; NOT adjusting tricky font (glyph %u)", gid);
     } else {
-      Warning("Glyph bbox was incorrect; adjusting (glyph %u)", gid);
+      range->Warning("Glyph bbox was incorrect; adjusting (glyph %u)", gid);
       // copy the numberOfContours field
-      this->iov.push_back(std::make_pair(glyph.buffer(), 2));
+      range->iov.push_back(std::make_pair(glyph.buffer(), 2));
       // output a fixed-up version of the bounding box
       uint8_t* fixed_bbox = new uint8_t[8];
-      replacements.push_back(fixed_bbox);
+      range->replacements.push_back(fixed_bbox);
       xmin = ots_htons(xmin);
       std::memcpy(fixed_bbox, &xmin, 2);
       ymin = ots_htons(ymin);
@@ -240,14 +337,14 @@ bool OpenTypeGLYF::ParseSimpleGlyph(Buffer &glyph,
       std::memcpy(fixed_bbox + 4, &xmax, 2);
       ymax = ots_htons(ymax);
       std::memcpy(fixed_bbox + 6, &ymax, 2);
-      this->iov.push_back(std::make_pair(fixed_bbox, 8));
+      range->iov.push_back(std::make_pair(fixed_bbox, 8));
       // copy the remainder of the glyph data
-      this->iov.push_back(std::make_pair(glyph.buffer() + 10, glyph.offset() - 10));
+      range->iov.push_back(std::make_pair(glyph.buffer() + 10, glyph.offset() - 10));
       return true;
     }
   }
 
-  this->iov.push_back(std::make_pair(glyph.buffer(), glyph.offset()));
+  range->iov.push_back(std::make_pair(glyph.buffer(), glyph.offset()));
 
   return true;
 }
@@ -262,8 +359,8 @@ bool OpenTypeGLYF::ParseSimpleGlyph(Buffer &glyph,
 bool OpenTypeGLYF::ParseCompositeGlyph(
     Buffer &glyph,
     unsigned glyph_id,
-    ComponentPointCount* component_point_count,
-    unsigned* skip_count) {
+    unsigned* skip_count,
+    GlyphRange *range) {
   uint16_t flags = 0;
   uint16_t gid = 0;
   enum class edit_t : uint8_t {
@@ -281,37 +378,37 @@ bool OpenTypeGLYF::ParseCompositeGlyph(
     unsigned start = glyph.offset();
 
     if (!glyph.ReadU16(&flags) || !glyph.ReadU16(&gid)) {
-      return Error("Can't read composite glyph flags or glyphIndex");
+      return range->Error("Can't read composite glyph flags or glyphIndex");
     }
 
     if (gid >= this->maxp->num_glyphs) {
-      return Error("Invalid glyph id used in composite glyph: %d", gid);
+      return range->Error("Invalid glyph id used in composite glyph: %d", gid);
     }
 
     if (flags & ARG_1_AND_2_ARE_WORDS) {
       int16_t argument1;
       int16_t argument2;
       if (!glyph.ReadS16(&argument1) || !glyph.ReadS16(&argument2)) {
-        return Error("Can't read argument1 or argument2");
+        return range->Error("Can't read argument1 or argument2");
       }
     } else {
       uint8_t argument1;
       uint8_t argument2;
       if (!glyph.ReadU8(&argument1) || !glyph.ReadU8(&argument2)) {
-        return Error("Can't read argument1 or argument2");
+        return range->Error("Can't read argument1 or argument2");
       }
     }
 
     if (flags & WE_HAVE_A_SCALE) {
       int16_t scale;
       if (!glyph.ReadS16(&scale)) {
-        return Error("Can't read scale");
+        return range->Error("Can't read scale");
       }
     } else if (flags & WE_HAVE_AN_X_AND_Y_SCALE) {
       int16_t xscale;
       int16_t yscale;
       if (!glyph.ReadS16(&xscale) || !glyph.ReadS16(&yscale)) {
-        return Error("Can't read xscale or yscale");
+        return range->Error("Can't read xscale or yscale");
       }
     } else if (flags & WE_HAVE_A_TWO_BY_TWO) {
       int16_t xscale;
@@ -322,12 +419,12 @@ bool OpenTypeGLYF::ParseCompositeGlyph(
           !glyph.ReadS16(&scale01) ||
           !glyph.ReadS16(&scale10) ||
           !glyph.ReadS16(&yscale)) {
-        return Error("Can't read transform");
+        return range->Error("Can't read transform");
       }
     }
 
     if (this->loca->offsets[gid] == this->loca->offsets[gid + 1]) {
-      Warning("empty gid %u used as component in glyph %u", gid, glyph_id);
+      range->Warning("empty gid %u used as component in glyph %u", gid, glyph_id);
       // DirectWrite chokes on composite glyphs that have a completely empty glyph
       // as a component; see https://github.com/mozilla/pdf.js/issues/18848.
       // To work around this, we attempt to drop empty components.
@@ -355,10 +452,6 @@ bool OpenTypeGLYF::ParseCompositeGlyph(
     }
 
     we_have_instructions = we_have_instructions || (flags & WE_HAVE_INSTRUCTIONS);
-
-    // Push initial components on stack at level 1
-    // to traverse them in parent function.
-    component_point_count->gid_stack.push_back({gid, 1});
   } while (flags & MORE_COMPONENTS);
 
   // Sort any required edits by offset in the glyph data.
@@ -372,19 +465,18 @@ bool OpenTypeGLYF::ParseCompositeGlyph(
   if (we_have_instructions) {
     uint16_t bytecode_length;
     if (!glyph.ReadU16(&bytecode_length)) {
-      return Error("Can't read instructions size");
+      return range->Error("Can't read instructions size");
     }
 
-    if (this->maxp->version_1 &&
-        this->maxp->max_size_glyf_instructions < bytecode_length) {
-      Warning("Bytecode length is bigger than maxp.maxSizeOfInstructions "
-              "%d: %d",
-              this->maxp->max_size_glyf_instructions, bytecode_length);
-      this->maxp->max_size_glyf_instructions = bytecode_length;
+    if (this->maxp->version_1 && range->max_instructions < bytecode_length) {
+      range->events.push_back(GlyphRange::Event(
+          GlyphRange::Event::kCompositeInstructions, glyph_id,
+          bytecode_length));
+      range->max_instructions = bytecode_length;
     }
 
     if (!glyph.Skip(bytecode_length)) {
-      return Error("Can't read bytecode of length %d", bytecode_length);
+      return range->Error("Can't read bytecode of length %d", bytecode_length);
     }
   }
 
@@ -395,7 +487,7 @@ bool OpenTypeGLYF::ParseCompositeGlyph(
     auto& edit = edits.front();
     // Handle any glyph data between current offset and the next edit position.
     if (edit.first > offset) {
-      this->iov.push_back(std::make_pair(glyph.buffer() + offset, edit.first - offset));
+      range->iov.push_back(std::make_pair(glyph.buffer() + offset, edit.first - offset));
       offset = edit.first;
     }
 
@@ -429,8 +521,8 @@ bool OpenTypeGLYF::ParseCompositeGlyph(
         flags = ots_htons(flags);
         uint8_t* flags_data = new uint8_t[2];
         std::memcpy(flags_data, &flags, 2);
-        replacements.push_back(flags_data);
-        this->iov.push_back(std::make_pair(flags_data, 2));
+        range->replacements.push_back(flags_data);
+        range->iov.push_back(std::make_pair(flags_data, 2));
         offset += 2;
         break;
       }
@@ -449,51 +541,57 @@ bool OpenTypeGLYF::ParseCompositeGlyph(
 
   // Handle any remaining glyph data after the last edit.
   if (glyph.offset() > offset) {
-    this->iov.push_back(std::make_pair(glyph.buffer() + offset, glyph.offset() - offset));
+    range->iov.push_back(std::make_pair(glyph.buffer() + offset, glyph.offset() - offset));
   }
 
   return true;
 }
 
-bool OpenTypeGLYF::Parse(const uint8_t *data, size_t length) {
-  OpenTypeMAXP *maxp = static_cast<OpenTypeMAXP*>(
-      GetFont()->GetTypedTable(OTS_TAG_MAXP));
-  OpenTypeLOCA *loca = static_cast<OpenTypeLOCA*>(
-      GetFont()->GetTypedTable(OTS_TAG_LOCA));
-  OpenTypeHEAD *head = static_cast<OpenTypeHEAD*>(
-      GetFont()->GetTypedTable(OTS_TAG_HEAD));
-  OpenTypeNAME *name = static_cast<OpenTypeNAME*>(
-      GetFont()->GetTypedTable(OTS_TAG_NAME));
-  if (!maxp || !loca || !head || !name) {
-    return Error("Missing maxp or loca or head or name table needed by glyf table");
-  }
-
-  bool is_tricky = name->IsTrickyFont();
-
-  this->loca = loca;
-  this->maxp = maxp;
+bool OpenTypeGLYF::GlyphRange::Error(const char *format, ...) {
+  va_list va;
+  va_start(va, format);
+  Message(0, format, va);
+  va_end(va);
+  return false;
+}
 
-  const unsigned num_glyphs = maxp->num_glyphs;
-  std::vector<uint32_t> &offsets = loca->offsets;
+bool OpenTypeGLYF::GlyphRange::Warning(const char *format, ...) {
+  va_list va;
+  va_start(va, format);
+  Message(1, format, va);
+  va_end(va);
+  return true;
+}
 
-  if (offsets.size() != num_glyphs + 1) {
-    return Error("Invalid glyph offsets size %ld != %d", offsets.size(), num_glyphs + 1);
-  }
+void OpenTypeGLYF::GlyphRange::Message(int level, const char *format,
+                                       va_list va) {
+  // As long as Table::Message() would make it.
+  char message[200];
+  std::vsnprintf(message, sizeof(message), format, va);
+  this->events.push_back(Event(Event::kMessage, 0, 0));
+  this->events.back().level = level;
+  this->events.back().message = message;
+}
 
-  std::vector<uint32_t> resulting_offsets(num_glyphs + 1);
-  uint32_t current_offset = 0;
+void OpenTypeGLYF::ValidateGlyphs(const uint8_t *data, size_t length,
+                                  bool is_tricky_font,
+                                  std::vector<uint32_t>& resulting_offsets,
+                                  GlyphRange *range) {
+  const std::vector<uint32_t> &offsets = this->loca->offsets;
 
-  for (unsigned i = 0; i < num_glyphs; ++i) {
+  for (unsigned i = range->begin; i < range->end; ++i) {
     // Used by ParseCompositeGlyph to return the number of bytes being skipped
     // in the glyph description, so we can adjust offsets properly.
     unsigned skip_count = 0;
 
-    Buffer glyph(GetGlyphBufferSection(data, length, offsets, i));
-    if (!glyph.buffer())
-      return false;
+    Buffer glyph(GetGlyphBufferSection(data, length, offsets, i, range));
+    if (!glyph.buffer()) {
+      range->ok = false;
+      return;
+    }
 
     if (!glyph.length()) {
-      resulting_offsets[i] = current_offset;
+      resulting_offsets[i] = range->length;
       continue;
     }
 
@@ -503,12 +601,15 @@ bool OpenTypeGLYF::Parse(const uint8_t *data, size_t length) {
         !glyph.ReadS16(&ymin) ||
         !glyph.ReadS16(&xmax) ||
         !glyph.ReadS16(&ymax)) {
-      return Error("Can't read glyph %d header", i);
+      range->ok = range->Error("Can't read glyph %d header", i);
+      return;
     }
 
     if (num_contours <= -2) {
       // -2, -3, -4, ... are reserved for future use.
-      return Error("Bad number of contours %d in glyph %d", num_contours, i);
+      range->ok = range->Error("Bad number of contours %d in glyph %d",
+                               num_contours, i);
+      return;
     }
 
     // workaround for fonts in http://www.princexml.com/fonts/
@@ -516,12 +617,13 @@ bool OpenTypeGLYF::Parse(const uint8_t *data, size_t length) {
         (xmax == -32767) &&
         (ymin == 32767) &&
         (ymax == -32767)) {
-      Warning("bad xmin/xmax/ymin/ymax values");
+      range->Warning("bad xmin/xmax/ymin/ymax values");
       xmin = xmax = ymin = ymax = 0;
     }
 
     if (xmin > xmax || ymin > ymax) {
-      return Error("Bad bounding box values bl=(%d, %d), tr=(%d, %d) in glyph %d", xmin, ymin, xmax, ymax, i);
+      range->ok = range->Error("Bad bounding box values bl=(%d, %d), tr=(%d, %d) in glyph %d", xmin, ymin, xmax, ymax, i);
+      return;
     }
 
     if (num_contours == 0) {
@@ -529,76 +631,212 @@ bool OpenTypeGLYF::Parse(const uint8_t *data, size_t length) {
       // does we will simply ignore it.
       glyph.set_offset(0);
     } else if (num_contours > 0) {
-      if (!ParseSimpleGlyph(glyph, i, num_contours, xmin, ymin, xmax, ymax, is_tricky)) {
-        return Error("Failed to parse glyph %d", i);
+      if (!ParseSimpleGlyph(glyph, i, num_contours, xmin, ymin, xmax, ymax,
+                            is_tricky_font, range)) {
+        range->ok = range->Error("Failed to parse glyph %d", i);
+        return;
       }
     } else {
-
-      ComponentPointCount component_point_count;
-      if (!ParseCompositeGlyph(glyph, i, &component_point_count, &skip_count)) {
-        return Error("Failed to parse glyph %d", i);
+      if (!ParseCompositeGlyph(glyph, i, &skip_count, range)) {
+        range->ok = range->Error("Failed to parse glyph %d", i);
+        return;
       }
+      // Its components can only be counted once all the ranges are done.
+      range->events.push_back(GlyphRange::Event(GlyphRange::Event::kComposite,
+                                                i, 0));
+    }
 
-      // Check maxComponentDepth and validate maxComponentPoints.
-      // ParseCompositeGlyph placed the first set of component glyphs on the
-      // component_point_count.gid_stack, which we start to process below. If a
-      // nested glyph is in turn a component glyph, additional glyphs are placed
-      // on the stack.
-      while (component_point_count.gid_stack.size()) {
-        GidAtLevel stack_top_gid = component_point_count.gid_stack.back();
-        component_point_count.gid_stack.pop_back();
-
-        Buffer points_count_glyph(GetGlyphBufferSection(
-            data,
-            length,
-            offsets,
-            stack_top_gid.gid));
-
-        if (!points_count_glyph.buffer())
-          return false;
-
-        if (!points_count_glyph.length())
-          continue;
-
-        if (!TraverseComponentsCountingPoints(points_count_glyph,
-                                              i,
-                                              stack_top_gid.level,
-                                              &component_point_count)) {
+    size_t new_size = glyph.offset() - skip_count;
+    resulting_offsets[i] = range->length;
+    // glyphs must be four byte aligned
+    // TODO(yusukes): investigate whether this padding is really necessary.
+    //                Which part of the spec requires this?
+    const unsigned padding = (4 - (new_size & 3)) % 4;
+    if (padding) {
+      range->iov.push_back(std::make_pair(
+          reinterpret_cast<const uint8_t*>("\x00\x00\x00\x00"),
+          static_cast<size_t>(padding)));
+      new_size += padding;
+    }
+    range->length += new_size;
+  }
+}
+
+bool OpenTypeGLYF::FinishGlyphs(const uint8_t *data, size_t length,
+                                const GlyphRange& range) {
+  for (const GlyphRange::Event& event : range.events) {
+    const unsigned i = event.gid;
+    switch (event.type) {
+      case GlyphRange::Event::kMessage:
+        if (event.level == 0) {
+          Error("%s", event.message.c_str());
+        } else {
+          Warning("%s", event.message.c_str());
+        }
+        break;
+
+      case GlyphRange::Event::kPoints:
+        if (event.value > this->maxp->max_points) {
+          Warning("Number of contour points exceeds maxp maxPoints, adjusting limit (glyph %u)", i);
+          this->maxp->max_points = event.value;
+        }
+        break;
+
+      case GlyphRange::Event::kInstructions:
+        if (this->maxp->max_size_glyf_instructions < event.value) {
+          Warning("Bytecode length is bigger than maxp.maxSizeOfInstructions %d: %d (glyph %u)",
+                  this->maxp->max_size_glyf_instructions, event.value, i);
+          this->maxp->max_size_glyf_instructions = event.value;
+        }
+        break;
+
+      case GlyphRange::Event::kCompositeInstructions:
+        if (this->maxp->max_size_glyf_instructions < event.value) {
+          Warning("Bytecode length is bigger than maxp.maxSizeOfInstructions "
+                  "%d: %d",
+                  this->maxp->max_size_glyf_instructions, event.value);
+          this->maxp->max_size_glyf_instructions = event.value;
+        }
+        break;
+
+      case GlyphRange::Event::kComposite: {
+        // Check maxComponentDepth and validate maxComponentPoints. The counts
+        // of the components are kept, so each glyph is only read once here
+        // however many composite glyphs use it.
+        if (!CountComponentPoints(data, length, this->loca->offsets, i)) {
           return Error("Error validating component points and depth.");
         }
+        const ComponentPointCount& component_point_count =
+            this->component_point_counts[i];
+
+        // FontTools counts a component level for each traversed recursion,
+        // starting at level 0. If we reach a level that's deeper than
+        // maxComponentDepth, we expand maxComponentDepth unless it's larger
+        // than the maximum possible depth.
+        if (component_point_count.depth > std::numeric_limits<uint16_t>::max()) {
+          return Error("Illegal component depth exceeding 0xFFFF in base glyph id %d.",
+                       i);
+        } else if (this->maxp->version_1 &&
+                   component_point_count.depth > this->maxp->max_c_depth) {
+          this->maxp->max_c_depth = component_point_count.depth;
+          Warning("Component depth exceeds maxp maxComponentDepth "
+                  "in glyph %d, adjust limit to %d.",
+                  i, component_point_count.depth);
+        }
 
-        if (component_point_count.accumulated_component_points >
+        if (component_point_count.points >
             std::numeric_limits<uint16_t>::max()) {
           return Error("Illegal composite points value "
                        "exceeding 0xFFFF for base glyph %d.", i);
         } else if (this->maxp->version_1 &&
-                   component_point_count.accumulated_component_points >
-                   this->maxp->max_c_points) {
+                   component_point_count.points > this->maxp->max_c_points) {
           Warning("Number of composite points in glyph %d exceeds "
                   "maxp maxCompositePoints: %d vs %d, adjusting limit.",
                   i,
-                  component_point_count.accumulated_component_points,
+                  component_point_count.points,
                   this->maxp->max_c_points
                   );
-          this->maxp->max_c_points =
-              component_point_count.accumulated_component_points;
+          this->maxp->max_c_points = component_point_count.points;
         }
+        break;
       }
     }
+  }
 
-    size_t new_size = glyph.offset() - skip_count;
-    resulting_offsets[i] = current_offset;
-    // glyphs must be four byte aligned
-    // TODO(yusukes): investigate whether this padding is really necessary.
-    //                Which part of the spec requires this?
-    const unsigned padding = (4 - (new_size & 3)) % 4;
-    if (padding) {
-      this->iov.push_back(std::make_pair(
-          reinterpret_cast<const uint8_t*>("\x00\x00\x00\x00"),
-          static_cast<size_t>(padding)));
-      new_size += padding;
+  return range.ok;
+}
+
+bool OpenTypeGLYF::Parse(const uint8_t *data, size_t length) {
+  OpenTypeMAXP *maxp = static_cast<OpenTypeMAXP*>(
+      GetFont()->GetTypedTable(OTS_TAG_MAXP));
+  OpenTypeLOCA *loca = static_cast<OpenTypeLOCA*>(
+      GetFont()->GetTypedTable(OTS_TAG_LOCA));
+  OpenTypeHEAD *head = static_cast<OpenTypeHEAD*>(
+      GetFont()->GetTypedTable(OTS_TAG_HEAD));
+  OpenTypeNAME *name = static_cast<OpenTypeNAME*>(
+      GetFont()->GetTypedTable(OTS_TAG_NAME));
+  if (!maxp || !loca || !head || !name) {
+    return Error("Missing maxp or loca or head or name table needed by glyf table");
+  }
+
+  bool is_tricky = name->IsTrickyFont();
+
+  this->loca = loca;
+  this->maxp = maxp;
+
+  const unsigned num_glyphs = maxp->num_glyphs;
+  std::vector<uint32_t> &offsets = loca->offsets;
+
+  if (offsets.size() != num_glyphs + 1) {
+    return Error("Invalid glyph offsets size %ld != %d", offsets.size(), num_glyphs + 1);
+  }
+
+  std::vector<uint32_t> resulting_offsets;
+  TakeScratch(&resulting_offsets);
+  resulting_offsets.resize(num_glyphs + 1);
+
+  TakeScratch(&this->iov);
+  TakeScratch(&this->component_point_counts);
+  TakeScratch(&this->point_flags);
+  this->component_point_counts.assign(num_glyphs, ComponentPointCount());
+
+  // With an executor, large fonts are validated a range of glyphs at a time,
+  // concurrently; the first range uses the scratch space of the table.
+  OTSExecutor *executor = GetFont()->file->context->GetExecutor();
+  const unsigned kGlyphsPerRange = 1024;
+  const size_t num_ranges =
+      executor ? (num_glyphs + kGlyphsPerRange - 1) / kGlyphsPerRange : 1;
+  std::vector<GlyphRange> ranges(std::max<size_t>(num_ranges, 1));
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    GlyphRange& range = ranges[r];
+    range.begin = r * kGlyphsPerRange;
+    range.end = r + 1 < ranges.size() ? range.begin + kGlyphsPerRange
+                                      : num_glyphs;
+    range.max_points = maxp->max_points;
+    range.max_instructions = maxp->max_size_glyf_instructions;
+  }
+  ranges[0].iov.swap(this->iov);
+  ranges[0].point_flags.swap(this->point_flags);
+
+  if (ranges.size() == 1) {
+    ValidateGlyphs(data, length, is_tricky, resulting_offsets, &ranges[0]);
+  } else {
+    TaskGroup group(executor);
+    for (size_t r = 0; r < ranges.size(); ++r) {
+      group.Run([&, r]() {
+        ValidateGlyphs(data, length, is_tricky, resulting_offsets, &ranges[r]);
+      });
+    }
+    group.Wait();
+  }
+
+  // Put the ranges together in order. The glyphs of a range that failed, and
+  // of those after it, are still there to be deleted.
+  bool ok = true;
+  uint32_t current_offset = 0;
+  this->iov.swap(ranges[0].iov);
+  this->point_flags.swap(ranges[0].point_flags);
+  for (GlyphRange& range : ranges) {
+    this->replacements.insert(this->replacements.end(),
+                              range.replacements.begin(),
+                              range.replacements.end());
+    if (ok) {
+      ok = FinishGlyphs(data, length, range);
+    }
+    if (!ok) {
+      continue;
+    }
+    for (unsigned i = range.begin; i < range.end; ++i) {
+      resulting_offsets[i] += current_offset;
     }
-    current_offset += new_size;
+    if (&range != &ranges[0]) {
+      this->iov.insert(this->iov.end(), range.iov.begin(), range.iov.end());
+    }
+    current_offset += range.length;
+  }
+  if (!ok) {
+    GiveScratch(&resulting_offsets);
+    return false;
   }
   resulting_offsets[num_glyphs] = current_offset;
 
@@ -609,7 +847,14 @@ bool OpenTypeGLYF::Parse(const uint8_t *data, size_t length) {
     head->index_to_loc_format = 1;
   }
 
-  loca->offsets = resulting_offsets;
+  loca->offsets.swap(resulting_offsets);
+  if (GetFont()->file->subset) {
+    this->source_data = data;
+    this->source_length = length;
+    TakeScratch(&this->source_offsets);
+    this->source_offsets.swap(resulting_offsets);
+  }
+  GiveScratch(&resulting_offsets);
 
   if (this->iov.empty()) {
     // As a special case when all glyph in the font are empty, add a zero byte
@@ -623,11 +868,92 @@ bool OpenTypeGLYF::Parse(const uint8_t *data, size_t length) {
   return true;
 }
 
+bool OpenTypeGLYF::CountComponentPoints(
+    const uint8_t *data,
+    size_t length,
+    const std::vector<uint32_t>& loca_offsets,
+    uint16_t glyph_id) {
+  if (this->component_point_counts[glyph_id].state ==
+      ComponentPointCount::kCounted) {
+    return true;
+  }
+
+  // The composite glyphs being counted, depth first. This is done without
+  // recursion, as there can be thousands of levels. The entries of |stack|
+  // above |depth| are only kept for the storage of their components.
+  std::vector<Composite>& stack = this->composite_stack;
+  size_t depth = 0;
+
+  uint16_t gid = glyph_id;
+  for (;;) {
+    ComponentPointCount* count = &this->component_point_counts[gid];
+    if (count->state == ComponentPointCount::kCounting) {
+      return Error("Glyph %d is a component of itself.", gid);
+    }
+
+    if (count->state == ComponentPointCount::kNotCounted) {
+      Buffer glyph(GetGlyphBufferSection(data, length, loca_offsets, gid));
+      if (!glyph.buffer()) {
+        return false;
+      }
+
+      if (depth == stack.size()) {
+        stack.emplace_back();
+      }
+      Composite& composite = stack[depth];
+      composite.components.clear();
+      if (!glyph.length()) {
+        count->state = ComponentPointCount::kCounted;
+      } else if (!TraverseComponentsCountingPoints(glyph, count,
+                                                   &composite.components)) {
+        return false;
+      }
+
+      if (count->state == ComponentPointCount::kCounting) {
+        composite.gid = gid;
+        composite.next_component = 0;
+        ++depth;
+      }
+    }
+
+    // Go down to the next component not counted yet, adding up the ones
+    // that are on the way.
+    while (depth) {
+      Composite& composite = stack[depth - 1];
+      ComponentPointCount& composite_count =
+          this->component_point_counts[composite.gid];
+      if (composite.next_component > 0) {
+        const ComponentPointCount& component_count =
+            this->component_point_counts[
+                composite.components[composite.next_component - 1]];
+        composite_count.points =
+            std::min(composite_count.points + component_count.points,
+                     std::numeric_limits<uint16_t>::max() + 1u);
+        if (component_count.has_contours) {
+          composite_count.depth = std::max(composite_count.depth,
+                                           component_count.depth + 1);
+        }
+      }
+
+      if (composite.next_component < composite.components.size()) {
+        gid = composite.components[composite.next_component++];
+        break;
+      }
+
+      composite_count.state = ComponentPointCount::kCounted;
+      --depth;
+    }
+
+    if (!depth) {
+      return true;
+    }
+  }
+}
+
 bool OpenTypeGLYF::TraverseComponentsCountingPoints(
     Buffer &glyph,
-    uint16_t base_glyph_id,
-    uint32_t level,
-    ComponentPointCount* component_point_count) {
+    ComponentPointCount* component_point_count,
+    std::vector<uint16_t>* components) {
 
   int16_t num_contours;
   if (!glyph.ReadS16(&num_contours) ||
@@ -639,24 +965,13 @@ bool OpenTypeGLYF::TraverseComponentsCountingPoints(
     return Error("Bad number of contours %d in glyph.", num_contours);
   }
 
-  if (num_contours == 0)
+  if (num_contours == 0) {
+    component_point_count->state = ComponentPointCount::kCounted;
     return true;
-
-  // FontTools counts a component level for each traversed recursion. We start
-  // counting at level 0. If we reach a level that's deeper than
-  // maxComponentDepth, we expand maxComponentDepth unless it's larger than
-  // the maximum possible depth.
-  if (level > std::numeric_limits<uint16_t>::max()) {
-    return Error("Illegal component depth exceeding 0xFFFF in base glyph id %d.",
-                 base_glyph_id);
-  } else if (this->maxp->version_1 &&
-             level > this->maxp->max_c_depth) {
-    this->maxp->max_c_depth = level;
-    Warning("Component depth exceeds maxp maxComponentDepth "
-            "in glyph %d, adjust limit to %d.",
-            base_glyph_id, level);
   }
 
+  component_point_count->has_contours = true;
+
   if (num_contours > 0) {
     uint16_t num_points = 0;
     for (int i = 0; i < num_contours; ++i) {
@@ -668,12 +983,13 @@ bool OpenTypeGLYF::TraverseComponentsCountingPoints(
       num_points = tmp_index + 1;
     }
 
-    component_point_count->accumulated_component_points += num_points;
+    component_point_count->points = num_points;
+    component_point_count->state = ComponentPointCount::kCounted;
     return true;
   } else  {
     assert(num_contours == -1);
 
-    // Composite glyph, add gid's to stack.
+    // Composite glyph, return its components to be counted in turn.
     uint16_t flags = 0;
     uint16_t gid = 0;
     do {
@@ -700,8 +1016,10 @@ bool OpenTypeGLYF::TraverseComponentsCountingPoints(
         return Error("Invalid glyph id used in composite glyph: %d", gid);
       }
 
-      component_point_count->gid_stack.push_back({gid, level + 1u});
+      components->push_back(gid);
     } while (flags & MORE_COMPONENTS);
+
+    component_point_count->state = ComponentPointCount::kCounting;
     return true;
   }
 }
@@ -710,7 +1028,8 @@ Buffer OpenTypeGLYF::GetGlyphBufferSection(
     const uint8_t *data,
     size_t length,
     const std::vector<uint32_t>& loca_offsets,
-    unsigned glyph_id) {
+    unsigned glyph_id,
+    GlyphRange *range) {
 
   Buffer null_buffer(nullptr, 0);
 
@@ -723,30 +1042,123 @@ Buffer OpenTypeGLYF::GetGlyphBufferSection(
   }
 
   if (gly_offset >= length) {
-    Error("Glyph %d offset %d too high %ld", glyph_id, gly_offset, length);
+    if (range) {
+      range->Error("Glyph %d offset %d too high %ld", glyph_id, gly_offset, length);
+    } else {
+      Error("Glyph %d offset %d too high %ld", glyph_id, gly_offset, length);
+    }
     return null_buffer;
   }
   // Since these are unsigned types, the compiler is not allowed to assume
   // that they never overflow.
   if (gly_offset + gly_length < gly_offset) {
-    Error("Glyph %d length (%d < 0)!", glyph_id, gly_length);
+    if (range) {
+      range->Error("Glyph %d length (%d < 0)!", glyph_id, gly_length);
+    } else {
+      Error("Glyph %d length (%d < 0)!", glyph_id, gly_length);
+    }
     return null_buffer;
   }
   if (gly_offset + gly_length > length) {
-    Error("Glyph %d length %d too high", glyph_id, gly_length);
+    if (range) {
+      range->Error("Glyph %d length %d too high", glyph_id, gly_length);
+    } else {
+      Error("Glyph %d length %d too high", glyph_id, gly_length);
+    }
     return null_buffer;
   }
 
   return Buffer(data + gly_offset, gly_length);
 }
 
-bool OpenTypeGLYF::Serialize(OTSStream *out) {
-  for (unsigned i = 0; i < this->iov.size(); ++i) {
-    if (!out->Write(this->iov[i].first, this->iov[i].second)) {
-      return Error("Failed to write glyph %d", i);
+bool OpenTypeGLYF::AddComponents(std::vector<bool> *glyphs) {
+  if (!this->source_data) {
+    return Error("Glyphs not kept for subsetting");
+  }
+
+  std::vector<uint16_t> pending;
+  for (size_t i = 0; i < glyphs->size(); ++i) {
+    if ((*glyphs)[i]) {
+      pending.push_back(i);
     }
   }
 
+  std::vector<uint16_t> components;
+  while (!pending.empty()) {
+    const uint16_t gid = pending.back();
+    pending.pop_back();
+    Buffer glyph(GetGlyphBufferSection(this->source_data, this->source_length,
+                                       this->source_offsets, gid));
+    if (!glyph.buffer()) {
+      return false;
+    }
+    if (!glyph.length()) {
+      continue;
+    }
+
+    ComponentPointCount count;
+    components.clear();
+    if (!TraverseComponentsCountingPoints(glyph, &count, &components)) {
+      return false;
+    }
+    for (uint16_t component : components) {
+      if (!(*glyphs)[component]) {
+        (*glyphs)[component] = true;
+        pending.push_back(component);
+      }
+    }
+  }
+  return true;
+}
+
+bool OpenTypeGLYF::Subset(const std::vector<bool>& glyphs) {
+  std::vector<uint32_t> &offsets = this->loca->offsets;
+  const unsigned num_glyphs = offsets.size() - 1;
+  if (glyphs.size() != num_glyphs) {
+    return Error("Subset of %u glyphs for %u",
+                 static_cast<unsigned>(glyphs.size()), num_glyphs);
+  }
+
+  // Each segment of the output is part of a single glyph, with the padding
+  // after it, or comes after the last one.
+  size_t num_kept_segments = 0;
+  unsigned gid = 0;
+  size_t offset = 0;
+  for (size_t i = 0; i < this->iov.size(); ++i) {
+    const OTSStream::Segment segment = this->iov[i];
+    while (gid < num_glyphs && offsets[gid + 1] <= offset) {
+      ++gid;
+    }
+    if (gid == num_glyphs || glyphs[gid]) {
+      this->iov[num_kept_segments++] = segment;
+    }
+    offset += segment.second;
+  }
+  this->iov.resize(num_kept_segments);
+
+  uint32_t kept_length = 0;
+  for (unsigned i = 0; i < num_glyphs; ++i) {
+    const uint32_t length = offsets[i + 1] - offsets[i];
+    offsets[i] = kept_length;
+    if (glyphs[i]) {
+      kept_length += length;
+    }
+  }
+  offsets[num_glyphs] = kept_length;
+
+  if (this->iov.empty()) {
+    // See Parse().
+    static const uint8_t kZero = 0;
+    this->iov.push_back(std::make_pair(&kZero, 1));
+  }
+  return true;
+}
+
+bool OpenTypeGLYF::Serialize(OTSStream *out) {
+  if (!out->WriteV(this->iov.data(), this->iov.size())) {
+    return Error("Failed to write glyphs");
+  }
+
   return true;
 }
 
@@ -5,7 +5,9 @@
 #ifndef OTS_GLYF_H_
 #define OTS_GLYF_H_
 
+#include <cstdarg>
 #include <new>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -18,34 +20,123 @@ class OpenTypeMAXP;
 class OpenTypeGLYF : public Table {
  public:
   explicit OpenTypeGLYF(Font *font, uint32_t tag)
-      : Table(font, tag, tag), maxp(NULL) { }
+      : Table(font, tag, tag), maxp(NULL), source_data(NULL),
+        source_length(0) { }
 
   ~OpenTypeGLYF() {
     for (auto* p : replacements) {
       delete[] p;
     }
+    GiveScratch(&iov);
+    GiveScratch(&component_point_counts);
+    GiveScratch(&point_flags);
+    GiveScratch(&source_offsets);
   }
 
   bool Parse(const uint8_t *data, size_t length);
   bool Serialize(OTSStream *out);
 
+  // Marks in |glyphs| the components of the composite glyphs marked there,
+  // and theirs, so that subsetting keeps them too.
+  bool AddComponents(std::vector<bool> *glyphs);
+  // Leaves the glyphs not marked in |glyphs| empty.
+  bool Subset(const std::vector<bool>& glyphs);
+
  private:
-  struct GidAtLevel {
-    uint16_t gid;
-    uint32_t level;
+  // The number of points of a glyph, counting those of all its components,
+  // and how many levels of components it has below it. Computed at most once
+  // per glyph, however many composite glyphs use it.
+  struct ComponentPointCount {
+    enum State : uint8_t {
+      kNotCounted,
+      kCounting,  // Still counting its components; seeing it again is a cycle.
+      kCounted,
+    };
+
+    ComponentPointCount()
+        : state(kNotCounted), has_contours(false), depth(0), points(0) {}
+
+    State state;
+    // Whether this glyph counts as a component level at all; it doesn't if it
+    // is empty or has no contours.
+    bool has_contours;
+    uint32_t depth;
+    // Saturates just above 0xFFFF, which is as much as is allowed anyway.
+    uint32_t points;
   };
 
-  struct ComponentPointCount {
-    ComponentPointCount() : accumulated_component_points(0) {};
-    uint32_t accumulated_component_points;
-    std::vector<GidAtLevel> gid_stack;
+  // The glyphs of the font are validated in ranges, which can be validated
+  // concurrently. Validating a range gives the output of its glyphs, and
+  // whatever else Parse() must then do in glyph order, range after range, for
+  // the maxp adjustments and the messages to be the same as if the glyphs
+  // were validated one after the other.
+  struct GlyphRange {
+    // Something to do after the range is validated.
+    struct Event {
+      enum Type : uint8_t {
+        kMessage,
+        // A simple glyph has |value| points.
+        kPoints,
+        // A simple glyph, or a composite one, has |value| bytes of
+        // instructions.
+        kInstructions,
+        kCompositeInstructions,
+        // A composite glyph is to have its components counted.
+        kComposite,
+      };
+
+      Event(Type type, unsigned gid, uint32_t value)
+          : type(type), level(0), gid(gid), value(value) {}
+
+      Type type;
+      int level;
+      unsigned gid;
+      uint32_t value;
+      std::string message;
+    };
+
+    GlyphRange()
+        : begin(0), end(0), ok(true), length(0),
+          max_points(0), max_instructions(0) {}
+
+    bool Error(const char *format, ...);
+    bool Warning(const char *format, ...);
+    void Message(int level, const char *format, va_list va);
+
+    unsigned begin;
+    unsigned end;
+    bool ok;
+    // The size of the output of the glyphs of the range.
+    uint32_t length;
+    std::vector<OTSStream::Segment> iov;
+    std::vector<uint8_t*> replacements;
+    std::vector<uint8_t> point_flags;
+    std::vector<Event> events;
+    // The largest values seen so far, starting from those of maxp: only
+    // larger ones need events.
+    uint16_t max_points;
+    uint16_t max_instructions;
   };
 
+  // Validates the glyphs of |range|, setting |resulting_offsets| of each to
+  // its offset from the start of the output of the range.
+  void ValidateGlyphs(const uint8_t *data, size_t length, bool is_tricky_font,
+                      std::vector<uint32_t>& resulting_offsets,
+                      GlyphRange *range);
+  // Does what validating |range| left to do, in order.
+  bool FinishGlyphs(const uint8_t *data, size_t length,
+                    const GlyphRange& range);
+
+  // Checks the flag at |flag_index|, and its repeats, storing them in
+  // |flags| and adding the bytes of their coordinates to |x_length| and
+  // |y_length|.
   bool ParseFlagsForSimpleGlyph(Buffer &glyph,
                                 uint32_t num_flags,
                                 std::vector<uint8_t>& flags,
                                 uint32_t *flag_index,
-                                uint32_t *coordinates_length);
+                                uint32_t *x_length,
+                                uint32_t *y_length,
+                                GlyphRange *range);
   bool ParseSimpleGlyph(Buffer &glyph,
                         unsigned gid,
                         int16_t num_contours,
@@ -53,36 +144,70 @@ class OpenTypeGLYF : public Table {
                         int16_t ymin,
                         int16_t xmax,
                         int16_t ymax,
-                        bool is_tricky_font);
+                        bool is_tricky_font,
+                        GlyphRange *range);
 
   // The skip_count outparam returns the number of bytes from the original
   // glyph description that are being skipped on output (normally zero).
   bool ParseCompositeGlyph(
       Buffer &glyph,
       unsigned glyph_id,
-      ComponentPointCount* component_point_count,
-      unsigned* skip_count);
+      unsigned* skip_count,
+      GlyphRange *range);
+
+  // Fills in component_point_counts[glyph_id], and that of every component
+  // below it that wasn't already.
+  bool CountComponentPoints(
+      const uint8_t *data,
+      size_t length,
+      const std::vector<uint32_t>& loca_offsets,
+      uint16_t glyph_id);
 
+  // Reads the header of |glyph|, then its point count if it is a simple
+  // glyph, or the ids of its components if it is a composite one.
   bool TraverseComponentsCountingPoints(
       Buffer& glyph,
-      uint16_t base_glyph_id,
-      uint32_t level,
-      ComponentPointCount* component_point_count);
+      ComponentPointCount* component_point_count,
+      std::vector<uint16_t>* components);
 
+  // Gives errors to |range|, if there is one.
   Buffer GetGlyphBufferSection(
       const uint8_t *data,
       size_t length,
       const std::vector<uint32_t>& loca_offsets,
-      unsigned glyph_id);
+      unsigned glyph_id,
+      GlyphRange *range = NULL);
+
+  // A composite glyph whose components are being counted, depth first.
+  struct Composite {
+    uint16_t gid;
+    std::vector<uint16_t> components;
+    size_t next_component;
+  };
 
   OpenTypeLOCA* loca;
   OpenTypeMAXP* maxp;
 
-  std::vector<std::pair<const uint8_t*, size_t> > iov;
+  std::vector<OTSStream::Segment> iov;
+
+  // Indexed by glyph id.
+  std::vector<ComponentPointCount> component_point_counts;
 
   // Any blocks of replacement data created during parsing are stored here
   // to be available during serialization.
   std::vector<uint8_t*> replacements;
+
+  // Scratch space, kept from one glyph to the next: the flags of the points
+  // of a simple glyph, lent to the first GlyphRange, and the composite glyphs
+  // being counted by CountComponentPoints().
+  std::vector<uint8_t> point_flags;
+  std::vector<Composite> composite_stack;
+
+  // Only kept when the font is to be subset, for AddComponents(): the input
+  // table and the offsets of its glyphs, loca having those of the output.
+  const uint8_t *source_data;
+  size_t source_length;
+  std::vector<uint32_t> source_offsets;
 };
 
 }  // namespace ots
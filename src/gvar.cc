@@ -39,20 +39,23 @@ static bool ParseGlyphVariationDataArray(const Font* font, const uint8_t* data,
   Buffer subtable(data, length);
 
   bool glyphVariationDataOffsetsAreLong = (flags & 0x0001u);
+  std::vector<uint32_t> offsets(glyphCount + 1);
+  if (glyphVariationDataOffsetsAreLong) {
+    if (!subtable.ReadU32Array(offsets.data(), offsets.size())) {
+      return OTS_FAILURE_MSG("Failed to read GlyphVariationData offsets");
+    }
+  } else {
+    if (!subtable.ReadU16Array(offsets.data(), offsets.size())) {
+      return OTS_FAILURE_MSG("Failed to read GlyphVariationData offsets");
+    }
+    for (size_t i = 0; i < offsets.size(); i++) {
+      offsets[i] *= 2;
+    }
+  }
+
   uint32_t prevOffset = 0;
   for (size_t i = 0; i < glyphCount + 1; i++) {
-    uint32_t offset;
-    if (glyphVariationDataOffsetsAreLong) {
-      if (!subtable.ReadU32(&offset)) {
-        return OTS_FAILURE_MSG("Failed to read GlyphVariationData offset");
-      }
-    } else {
-      uint16_t halfOffset;
-      if (!subtable.ReadU16(&halfOffset)) {
-        return OTS_FAILURE_MSG("Failed to read GlyphVariationData offset");
-      }
-      offset = halfOffset * 2;
-    }
+    const uint32_t offset = offsets[i];
 
     if (i > 0 && offset > prevOffset) {
       if (prevOffset > glyphVariationDataLength) {
@@ -4,6 +4,8 @@
 
 #include "kern.h"
 
+#include <algorithm>
+
 // kern - Kerning
 // http://www.microsoft.com/typography/otspec/kern.htm
 
@@ -13,8 +15,8 @@ bool OpenTypeKERN::Parse(const uint8_t *data, size_t length) {
   Buffer table(data, length);
 
   uint16_t num_tables = 0;
-  if (!table.ReadU16(&this->version) ||
-      !table.ReadU16(&num_tables)) {
+  if (!table.ReadRecord<Record<uint16_t, uint16_t> >(&this->version,
+                                                      &num_tables)) {
     return Error("Failed to read table header");
   }
 
@@ -31,8 +33,8 @@ bool OpenTypeKERN::Parse(const uint8_t *data, size_t length) {
     OpenTypeKERNFormat0 subtable;
     uint16_t sub_length = 0;
 
-    if (!table.ReadU16(&subtable.version) ||
-        !table.ReadU16(&sub_length)) {
+    if (!table.ReadRecord<Record<uint16_t, uint16_t> >(&subtable.version,
+                                                        &sub_length)) {
       return Error("Failed to read subtable %d header", i);
     }
 
@@ -67,10 +69,9 @@ bool OpenTypeKERN::Parse(const uint8_t *data, size_t length) {
 
     // Parse the format 0 field.
     uint16_t num_pairs = 0;
-    if (!table.ReadU16(&num_pairs) ||
-        !table.ReadU16(&subtable.search_range) ||
-        !table.ReadU16(&subtable.entry_selector) ||
-        !table.ReadU16(&subtable.range_shift)) {
+    if (!table.ReadRecord<Record<uint16_t, uint16_t, uint16_t, uint16_t> >(
+            &num_pairs, &subtable.search_range, &subtable.entry_selector,
+            &subtable.range_shift)) {
       return Error("Failed to read subtable %d format 0 fields", i);
     }
 
@@ -104,16 +105,24 @@ bool OpenTypeKERN::Parse(const uint8_t *data, size_t length) {
       subtable.range_shift = expected_range_shift;
     }
 
-    // Read kerning pairs.
+    // Read kerning pairs. Unsorted pairs drop the table while missing ones
+    // are an error, so the pairs that are there are checked first.
+    typedef Record<uint16_t, uint16_t, int16_t> KerningPair;
+    const unsigned num_present = std::min<size_t>(
+        num_pairs, table.remaining() / KerningPair::kSize);
+    BufferCursor pairs;
+    if (!table.ReserveRecords<KerningPair>(num_present, &pairs)) {
+      return Error("Failed to read subtable %d kerning pairs", i);
+    }
     subtable.pairs.reserve(num_pairs);
     uint32_t last_pair = 0;
     for (unsigned j = 0; j < num_pairs; ++j) {
-      OpenTypeKERNFormat0Pair kerning_pair;
-      if (!table.ReadU16(&kerning_pair.left) ||
-          !table.ReadU16(&kerning_pair.right) ||
-          !table.ReadS16(&kerning_pair.value)) {
+      if (j == num_present) {
         return Error("Failed to read subtable %d kerning pair %d", i, j);
       }
+      OpenTypeKERNFormat0Pair kerning_pair;
+      pairs.Read<KerningPair>(&kerning_pair.left, &kerning_pair.right,
+                              &kerning_pair.value);
       const uint32_t current_pair
           = (kerning_pair.left << 16) + kerning_pair.right;
       if (j != 0 && current_pair <= last_pair) {
@@ -29,6 +29,10 @@ const uint16_t kMaxDeltaFormatType = 3;
 // In variation fonts, Device Tables are replaced by VariationIndex tables,
 // indicated by this flag in the deltaFormat field.
 const uint16_t kVariationIndex = 0x8000;
+// Coverage and ClassDef tables with fewer bytes of records than this
+// are validated again each time, as that is about as fast as looking them up
+// in the font's LayoutSubtableCache.
+const size_t kMinCachedRecordsSize = 64;
 
 struct ScriptRecord {
   uint32_t tag;
@@ -45,6 +49,13 @@ struct FeatureRecord {
   uint16_t offset;
 };
 
+// The tag and offset of a ScriptRecord, LangSysRecord or FeatureRecord.
+typedef ots::Record<uint32_t, uint16_t> TagRecord;
+
+// The first and last glyphs, and the class or the start coverage index, of a
+// ClassRangeRecord or a Coverage RangeRecord.
+typedef ots::Record<uint16_t, uint16_t, uint16_t> RangeRecord;
+
 bool ParseLangSysTable(const ots::Font *font,
                        ots::Buffer *subtable, const uint32_t tag,
                        const uint16_t num_features) {
@@ -107,14 +118,16 @@ bool ParseScriptTable(const ots::Font *font,
     return OTS_FAILURE_MSG("Bad end of langsys record %d for script tag %c%c%c%c", lang_sys_record_end, OTS_UNTAG(tag));
   }
 
+  ots::BufferCursor records;
+  if (!subtable.ReserveRecords<TagRecord>(lang_sys_count, &records)) {
+    return OTS_FAILURE_MSG("Failed to read langsys records for script tag %c%c%c%c", OTS_UNTAG(tag));
+  }
   std::vector<LangSysRecord> lang_sys_records;
   lang_sys_records.resize(lang_sys_count);
   uint32_t last_tag = 0;
   for (unsigned i = 0; i < lang_sys_count; ++i) {
-    if (!subtable.ReadU32(&lang_sys_records[i].tag) ||
-        !subtable.ReadU16(&lang_sys_records[i].offset)) {
-      return OTS_FAILURE_MSG("Failed to read langsys record header %d for script tag %c%c%c%c", i, OTS_UNTAG(tag));
-    }
+    records.Read<TagRecord>(&lang_sys_records[i].tag,
+                            &lang_sys_records[i].offset);
     // The record array must store the records alphabetically by tag
     if (last_tag != 0 && last_tag > lang_sys_records[i].tag) {
       return OTS_FAILURE_MSG("Bad last tag %d for langsys record %d for script tag %c%c%c%c", last_tag, i, OTS_UNTAG(tag));
@@ -175,6 +188,21 @@ bool ParseFeatureTable(const ots::Font *font,
   return true;
 }
 
+// Whether the subtable at |data| is worth caching, going by the record count
+// at |count_offset| and the |record_size| of each. It must also fit in
+// |length|, as a cached result only vouches for the bytes it spans.
+bool IsCacheable(const uint8_t *data, size_t length,
+                 size_t count_offset, size_t record_size) {
+  ots::Buffer subtable(data, length);
+  uint16_t count = 0;
+  if (!subtable.Skip(count_offset) || !subtable.ReadU16(&count)) {
+    return false;
+  }
+  const size_t records_size = count * record_size;
+  return records_size >= kMinCachedRecordsSize &&
+         records_size <= subtable.remaining();
+}
+
 bool ParseClassDefFormat1(const ots::Font *font,
                           const uint8_t *data, size_t length,
                           const uint16_t num_glyphs,
@@ -201,11 +229,13 @@ bool ParseClassDefFormat1(const ots::Font *font,
   if (glyph_count > num_glyphs) {
     return OTS_FAILURE_MSG("bad glyph count: %u", glyph_count);
   }
+  ots::BufferCursor class_values;
+  if (!subtable.ReserveRecords<ots::Record<uint16_t> >(glyph_count,
+                                                      &class_values)) {
+    return OTS_FAILURE_MSG("Failed to read class values in class definition");
+  }
   for (unsigned i = 0; i < glyph_count; ++i) {
-    uint16_t class_value = 0;
-    if (!subtable.ReadU16(&class_value)) {
-      return OTS_FAILURE_MSG("Failed to read class value for glyph %d in class definition", i);
-    }
+    const uint16_t class_value = class_values.ReadU16();
     if (class_value > num_classes) {
       return OTS_FAILURE_MSG("Bad class value %d for glyph %d in class definition", class_value, i);
     }
@@ -233,16 +263,17 @@ bool ParseClassDefFormat2(const ots::Font *font,
     return OTS_FAILURE_MSG("classRangeCount > glyph count: %u > %u", range_count, num_glyphs);
   }
 
+  ots::BufferCursor records;
+  if (!subtable.ReserveRecords<RangeRecord>(range_count, &records)) {
+    return OTS_FAILURE_MSG("Failed to read ClassRangeRecords");
+  }
+
   uint16_t last_end = 0;
   for (unsigned i = 0; i < range_count; ++i) {
     uint16_t start = 0;
     uint16_t end = 0;
     uint16_t class_value = 0;
-    if (!subtable.ReadU16(&start) ||
-        !subtable.ReadU16(&end) ||
-        !subtable.ReadU16(&class_value)) {
-      return OTS_FAILURE_MSG("Failed to read ClassRangeRecord %d", i);
-    }
+    records.Read<RangeRecord>(&start, &end, &class_value);
     if (start > end) {
       return OTS_FAILURE_MSG("ClassRangeRecord %d, start > end: %u > %u", i, start, end);
     }
@@ -276,11 +307,12 @@ bool ParseCoverageFormat1(const ots::Font *font,
   if (glyph_count > num_glyphs) {
     return OTS_FAILURE_MSG("bad glyph count: %u", glyph_count);
   }
+  ots::BufferCursor glyphs;
+  if (!subtable.ReserveRecords<ots::Record<uint16_t> >(glyph_count, &glyphs)) {
+    return OTS_FAILURE_MSG("Failed to read glyphs in coverage");
+  }
   for (unsigned i = 0; i < glyph_count; ++i) {
-    uint16_t glyph = 0;
-    if (!subtable.ReadU16(&glyph)) {
-      return OTS_FAILURE_MSG("Failed to read glyph %d in coverage", i);
-    }
+    const uint16_t glyph = glyphs.ReadU16();
     if (glyph >= num_glyphs) {
       return OTS_FAILURE_MSG("bad glyph ID: %u", glyph);
     }
@@ -311,17 +343,17 @@ bool ParseCoverageFormat2(const ots::Font *font,
   if (range_count > num_glyphs) {
     return OTS_FAILURE_MSG("bad range count: %u", range_count);
   }
+  ots::BufferCursor records;
+  if (!subtable.ReserveRecords<RangeRecord>(range_count, &records)) {
+    return OTS_FAILURE_MSG("Failed to read ranges in coverage");
+  }
   uint16_t last_end = 0;
   uint16_t last_start_coverage_index = 0;
   for (unsigned i = 0; i < range_count; ++i) {
     uint16_t start = 0;
     uint16_t end = 0;
     uint16_t start_coverage_index = 0;
-    if (!subtable.ReadU16(&start) ||
-        !subtable.ReadU16(&end) ||
-        !subtable.ReadU16(&start_coverage_index)) {
-      return OTS_FAILURE_MSG("Failed to read range %d in coverage", i);
-    }
+    records.Read<RangeRecord>(&start, &end, &start_coverage_index);
 
     // Some of the Adobe Pro fonts have ranges that overlap by one element: the
     // start of one range is equal to the end of the previous range. Therefore
@@ -1203,15 +1235,16 @@ bool OpenTypeLayoutTable::ParseScriptListTable(const uint8_t *data, const size_t
   if (script_record_end > std::numeric_limits<uint16_t>::max()) {
     return Error("Bad end of script record %d in script list table", script_record_end);
   }
+  BufferCursor records;
+  if (!subtable.ReserveRecords<TagRecord>(script_count, &records)) {
+    return Error("Failed to read script records in script list table");
+  }
   std::vector<ScriptRecord> script_list;
   script_list.reserve(script_count);
   uint32_t last_tag = 0;
   for (unsigned i = 0; i < script_count; ++i) {
     ScriptRecord record;
-    if (!subtable.ReadU32(&record.tag) ||
-        !subtable.ReadU16(&record.offset)) {
-      return Error("Failed to read script record %d in script list table", i);
-    }
+    records.Read<TagRecord>(&record.tag, &record.offset);
     // Script tags should be arranged alphabetically by tag
     if (last_tag != 0 && last_tag > record.tag) {
       // Several fonts don't arrange tags alphabetically.
@@ -1259,12 +1292,14 @@ bool OpenTypeLayoutTable::ParseFeatureListTable(const uint8_t *data, const size_
   if (feature_record_end > std::numeric_limits<uint16_t>::max()) {
     return Error("Bad end of feature record %d", feature_record_end);
   }
+  BufferCursor records;
+  if (!subtable.ReserveRecords<TagRecord>(feature_count, &records)) {
+    return Error("Failed to read feature headers");
+  }
   uint32_t last_tag = 0;
   for (unsigned i = 0; i < feature_count; ++i) {
-    if (!subtable.ReadU32(&feature_records[i].tag) ||
-        !subtable.ReadU16(&feature_records[i].offset)) {
-      return Error("Failed to read feature header %d", i);
-    }
+    records.Read<TagRecord>(&feature_records[i].tag,
+                            &feature_records[i].offset);
     // Feature record array should be arranged alphabetically by tag
     if (last_tag != 0 && last_tag > feature_records[i].tag) {
       // Several fonts don't arrange tags alphabetically.
@@ -1309,7 +1344,8 @@ bool OpenTypeLayoutTable::ParseLookupTable(const uint8_t *data,
 
   bool use_mark_filtering_set = lookup_flag & kUseMarkFilteringSetBit;
 
-  std::vector<uint16_t> subtables;
+  std::vector<uint16_t>& subtables = m_lookup_subtables;
+  subtables.clear();
   subtables.reserve(subtable_count);
   // If the |kUseMarkFilteringSetBit| of |lookup_flag| is set,
   // extra 2 bytes will follow after subtable offset array.
@@ -1399,6 +1435,79 @@ bool OpenTypeLayoutTable::ParseLookupListTable(const uint8_t *data,
   return true;
 }
 
+bool LayoutSubtableCache::IsValid(SubtableType type, const uint8_t *data,
+                                  uint16_t num_glyphs, uint16_t limit) {
+  const Key key = { data, num_glyphs, limit, type };
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const bool valid = m_valid.find(key) != m_valid.end();
+  for (TableCounts& counts : m_counts) {
+    if (data >= counts.data && data < counts.data + counts.length) {
+      ++counts.lookups[type];
+      counts.hits[type] += valid;
+      break;
+    }
+  }
+  return valid;
+}
+
+void LayoutSubtableCache::SetValid(SubtableType type, const uint8_t *data,
+                                   uint16_t num_glyphs, uint16_t limit) {
+  const Key key = { data, num_glyphs, limit, type };
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_valid.insert(key);
+}
+
+void LayoutSubtableCache::BeginCounting(uint32_t tag, const uint8_t *data,
+                                        size_t length) {
+  const TableCounts counts = { tag, data, length, {0}, {0} };
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_counts.push_back(counts);
+}
+
+void LayoutSubtableCache::EndCounting(uint32_t tag,
+                                      OTSTableObserver *observer) {
+  static const char * const kNames[kNumSubtableTypes][2] = {
+    { "coverage_lookups", "coverage_hits" },
+    { "class_def_lookups", "class_def_hits" },
+  };
+
+  TableCounts counts;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_counts.begin();
+    while (it != m_counts.end() && it->tag != tag) {
+      ++it;
+    }
+    if (it == m_counts.end()) {
+      return;
+    }
+    counts = *it;
+    m_counts.erase(it);
+  }
+  for (unsigned type = 0; type < kNumSubtableTypes; ++type) {
+    observer->OnTableCounter(tag, kNames[type][0], counts.lookups[type]);
+    observer->OnTableCounter(tag, kNames[type][1], counts.hits[type]);
+  }
+}
+
+LayoutSubtableCounter::LayoutSubtableCounter(Table *table,
+                                             const uint8_t *data,
+                                             size_t length)
+    : m_table(table),
+      m_observer(table->GetFont()->file->observer) {
+  if (m_observer) {
+    m_table->GetFont()->layout_subtables.BeginCounting(m_table->Tag(),
+                                                       data, length);
+  }
+}
+
+LayoutSubtableCounter::~LayoutSubtableCounter() {
+  if (m_observer) {
+    m_table->GetFont()->layout_subtables.EndCounting(m_table->Tag(),
+                                                     m_observer);
+  }
+}
+
 bool ParseClassDefTable(const ots::Font *font,
                         const uint8_t *data, size_t length,
                         const uint16_t num_glyphs,
@@ -1409,13 +1518,33 @@ bool ParseClassDefTable(const ots::Font *font,
   if (!subtable.ReadU16(&format)) {
     return OTS_FAILURE_MSG("Failed to read class defn format");
   }
+  if (format != 1 && format != 2) {
+    return OTS_FAILURE_MSG("Bad class defn format %d", format);
+  }
+
+  const bool cached = format == 1 ? IsCacheable(data, length, 4, 2)
+                                  : IsCacheable(data, length, 2, 6);
+  LayoutSubtableCache& cache = font->layout_subtables;
+  if (cached && cache.IsValid(LayoutSubtableCache::kClassDef, data,
+                              num_glyphs, num_classes)) {
+    return true;
+  }
+
   if (format == 1) {
-    return ParseClassDefFormat1(font, data, length, num_glyphs, num_classes);
-  } else if (format == 2) {
-    return ParseClassDefFormat2(font, data, length, num_glyphs, num_classes);
+    if (!ParseClassDefFormat1(font, data, length, num_glyphs, num_classes)) {
+      return false;
+    }
+  } else {
+    if (!ParseClassDefFormat2(font, data, length, num_glyphs, num_classes)) {
+      return false;
+    }
   }
 
-  return OTS_FAILURE_MSG("Bad class defn format %d", format);
+  if (cached) {
+    cache.SetValid(LayoutSubtableCache::kClassDef, data,
+                   num_glyphs, num_classes);
+  }
+  return true;
 }
 
 bool ParseCoverageTable(const ots::Font *font,
@@ -1428,13 +1557,32 @@ bool ParseCoverageTable(const ots::Font *font,
   if (!subtable.ReadU16(&format)) {
     return OTS_FAILURE_MSG("Failed to read coverage table format");
   }
+  if (format != 1 && format != 2) {
+    return OTS_FAILURE_MSG("Bad coverage table format %d", format);
+  }
+
+  const bool cached = IsCacheable(data, length, 2, format == 1 ? 2 : 6);
+  LayoutSubtableCache& cache = font->layout_subtables;
+  if (cached && cache.IsValid(LayoutSubtableCache::kCoverage, data,
+                              num_glyphs, expected_num_glyphs)) {
+    return true;
+  }
+
   if (format == 1) {
-    return ParseCoverageFormat1(font, data, length, num_glyphs, expected_num_glyphs);
-  } else if (format == 2) {
-    return ParseCoverageFormat2(font, data, length, num_glyphs, expected_num_glyphs);
+    if (!ParseCoverageFormat1(font, data, length, num_glyphs, expected_num_glyphs)) {
+      return false;
+    }
+  } else {
+    if (!ParseCoverageFormat2(font, data, length, num_glyphs, expected_num_glyphs)) {
+      return false;
+    }
   }
 
-  return OTS_FAILURE_MSG("Bad coverage table format %d", format);
+  if (cached) {
+    cache.SetValid(LayoutSubtableCache::kCoverage, data,
+                   num_glyphs, expected_num_glyphs);
+  }
+  return true;
 }
 
 bool ParseDeviceTable(const ots::Font *font,
@@ -1604,13 +1752,18 @@ bool OpenTypeLayoutTable::ParseFeatureVariationsTable(const uint8_t *data, const
     2 * sizeof(uint16_t) + sizeof(uint32_t) +
     feature_variation_record_count * 2 * sizeof(uint32_t);
 
+  typedef Record<uint32_t, uint32_t> FeatureVariationRecord;
+  BufferCursor records;
+  if (!subtable.ReserveRecords<FeatureVariationRecord>(
+          feature_variation_record_count, &records)) {
+    return Error("Failed to read feature variation record");
+  }
+
   for (uint32_t i = 0; i < feature_variation_record_count; i++) {
     uint32_t condition_set_offset = 0;
     uint32_t feature_table_substitution_offset = 0;
-    if (!subtable.ReadU32(&condition_set_offset) ||
-        !subtable.ReadU32(&feature_table_substitution_offset)) {
-      return Error("Failed to read feature variation record");
-    }
+    records.Read<FeatureVariationRecord>(&condition_set_offset,
+                                         &feature_table_substitution_offset);
 
     if (condition_set_offset) {
       if (condition_set_offset < kEndOfFeatureVariationRecords ||
@@ -1647,17 +1800,18 @@ const size_t kHeaderSize_1_1 = 4 + 3 * 2 + 4;
 
 bool OpenTypeLayoutTable::Parse(const uint8_t *data, size_t length) {
   Buffer table(data, length);
+  TakeScratch(&m_lookup_subtables);
+  LayoutSubtableCounter counter(this, data, length);
 
   uint16_t version_major = 0, version_minor = 0;
   uint16_t offset_script_list = 0;
   uint16_t offset_feature_list = 0;
   uint16_t offset_lookup_list = 0;
   uint32_t offset_feature_variations = 0;
-  if (!table.ReadU16(&version_major) ||
-      !table.ReadU16(&version_minor) ||
-      !table.ReadU16(&offset_script_list) ||
-      !table.ReadU16(&offset_feature_list) ||
-      !table.ReadU16(&offset_lookup_list)) {
+  if (!table.ReadRecord<Record<uint16_t, uint16_t, uint16_t, uint16_t,
+                              uint16_t> >(
+          &version_major, &version_minor, &offset_script_list,
+          &offset_feature_list, &offset_lookup_list)) {
     return Error("Incomplete table");
   }
 
@@ -5,6 +5,8 @@
 #ifndef OTS_LAYOUT_H_
 #define OTS_LAYOUT_H_
 
+#include <vector>
+
 #include "ots.h"
 
 // Utility functions for OpenType layout common table formats.
@@ -20,6 +22,10 @@ class OpenTypeLayoutTable : public Table {
     explicit OpenTypeLayoutTable(Font *font, uint32_t tag, uint32_t type)
       : Table(font, tag, type) { }
 
+    ~OpenTypeLayoutTable() {
+      GiveScratch(&m_lookup_subtables);
+    }
+
     bool Parse(const uint8_t *data, size_t length);
     bool Serialize(OTSStream *out);
 
@@ -44,6 +50,28 @@ class OpenTypeLayoutTable : public Table {
     size_t m_length = 0;
     uint16_t m_num_features = 0;
     uint16_t m_num_lookups = 0;
+
+    // The subtable offsets of the lookup being parsed, kept from one lookup to
+    // the next.
+    std::vector<uint16_t> m_lookup_subtables;
+};
+
+// While in scope, counts the Coverage and ClassDef tables of |table|,
+// whose data is the |length| bytes at |data|, looked up in the
+// LayoutSubtableCache of its font, and how many were found there. The counts
+// are given to the observer of the font, if any, once out of scope.
+class LayoutSubtableCounter {
+ public:
+  LayoutSubtableCounter(Table *table, const uint8_t *data,
+                        size_t length);
+  ~LayoutSubtableCounter();
+
+ private:
+  LayoutSubtableCounter(const LayoutSubtableCounter&) = delete;
+  LayoutSubtableCounter& operator=(const LayoutSubtableCounter&) = delete;
+
+  Table *m_table;
+  OTSTableObserver *m_observer;
 };
 
 bool ParseClassDefTable(const ots::Font *font,
@@ -28,36 +28,31 @@ bool OpenTypeLOCA::Parse(const uint8_t *data, size_t length) {
 
   const unsigned num_glyphs = maxp->num_glyphs;
   unsigned last_offset = 0;
+  TakeScratch(&this->offsets);
   this->offsets.resize(num_glyphs + 1);
   // maxp->num_glyphs is uint16_t, thus the addition never overflows.
 
+  // Note that there is one more offset than the number of glyphs in order to
+  // give the length of the final glyph.
   if (head->index_to_loc_format == 0) {
-    // Note that the <= here (and below) is correct. There is one more offset
-    // than the number of glyphs in order to give the length of the final
-    // glyph.
-    for (unsigned i = 0; i <= num_glyphs; ++i) {
-      uint16_t offset = 0;
-      if (!table.ReadU16(&offset)) {
-        return Error("Failed to read offset for glyph %d", i);
-      }
-      if (offset < last_offset) {
-        return Error("Out of order offset %d < %d for glyph %d", offset, last_offset, i);
-      }
-      last_offset = offset;
-      this->offsets[i] = offset * 2;
+    if (!table.ReadU16Array(this->offsets.data(), num_glyphs + 1)) {
+      return Error("Failed to read offsets for %d glyphs", num_glyphs);
     }
   } else {
-    for (unsigned i = 0; i <= num_glyphs; ++i) {
-      uint32_t offset = 0;
-      if (!table.ReadU32(&offset)) {
-        return Error("Failed to read offset for glyph %d", i);
-      }
-      if (offset < last_offset) {
-        return Error("Out of order offset %d < %d for glyph %d", offset, last_offset, i);
-      }
-      last_offset = offset;
-      this->offsets[i] = offset;
+    if (!table.ReadU32Array(this->offsets.data(), num_glyphs + 1)) {
+      return Error("Failed to read offsets for %d glyphs", num_glyphs);
+    }
+  }
+
+  // Short offsets are stored divided by two.
+  const unsigned scale = head->index_to_loc_format == 0 ? 2 : 1;
+  for (unsigned i = 0; i <= num_glyphs; ++i) {
+    const uint32_t offset = this->offsets[i];
+    if (offset < last_offset) {
+      return Error("Out of order offset %d < %d for glyph %d", offset, last_offset, i);
     }
+    last_offset = offset;
+    this->offsets[i] = offset * scale;
   }
 
   return true;
@@ -16,6 +16,10 @@ class OpenTypeLOCA : public Table {
   explicit OpenTypeLOCA(Font *font, uint32_t tag)
       : Table(font, tag, tag) { }
 
+  ~OpenTypeLOCA() {
+    GiveScratch(&offsets);
+  }
+
   bool Parse(const uint8_t *data, size_t length);
   bool Serialize(OTSStream *out);
 
@@ -514,6 +514,8 @@ bool OpenTypeMATH::ParseMathVariantsTable(const uint8_t *data,
 }
 
 bool OpenTypeMATH::Parse(const uint8_t *data, size_t length) {
+  LayoutSubtableCounter counter(this, data, length);
+
   // Grab the number of glyphs in the font from the maxp table to check
   // GlyphIDs in MATH table.
   OpenTypeMAXP *maxp = static_cast<OpenTypeMAXP*>(
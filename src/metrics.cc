@@ -120,24 +120,26 @@ bool OpenTypeMetricsTable::Parse(const uint8_t *data, size_t length) {
   }
   const unsigned num_sbs = maxp->num_glyphs - num_metrics;
 
+  TakeScratch(&this->entries);
+  TakeScratch(&this->sbs);
   this->entries.reserve(num_metrics);
-  for (unsigned i = 0; i < num_metrics; ++i) {
-    uint16_t adv = 0;
-    int16_t sb = 0;
-    if (!table.ReadU16(&adv) || !table.ReadS16(&sb)) {
-      return Error("Failed to read metric %d", i);
+  // The advances and side bearings are read a block at a time.
+  uint16_t block[512];
+  for (unsigned i = 0; i < num_metrics; ) {
+    const unsigned block_metrics = std::min(num_metrics - i, 256u);
+    if (!table.ReadU16Array(block, block_metrics * 2)) {
+      return Error("Failed to read metrics %d to %d", i, i + block_metrics - 1);
     }
-    this->entries.push_back(std::make_pair(adv, sb));
+    for (unsigned j = 0; j < block_metrics; ++j) {
+      this->entries.push_back(std::make_pair(
+          block[j * 2], static_cast<int16_t>(block[j * 2 + 1])));
+    }
+    i += block_metrics;
   }
 
-  this->sbs.reserve(num_sbs);
-  for (unsigned i = 0; i < num_sbs; ++i) {
-    int16_t sb;
-    if (!table.ReadS16(&sb)) {
-      // Some Japanese fonts (e.g., mona.ttf) fail this test.
-      return Error("Failed to read side bearing %d", i + num_metrics);
-    }
-    this->sbs.push_back(sb);
+  if (!table.ReadS16Array(&this->sbs, num_sbs)) {
+    // Some Japanese fonts (e.g., mona.ttf) fail this test.
+    return Error("Failed to read %d side bearings", num_sbs);
   }
 
   return true;
@@ -41,6 +41,11 @@ struct OpenTypeMetricsTable : public Table {
                                 uint32_t header_tag)
       : Table(font, tag, type), m_header_tag(header_tag) { }
 
+  ~OpenTypeMetricsTable() {
+    GiveScratch(&entries);
+    GiveScratch(&sbs);
+  }
+
   bool Parse(const uint8_t *data, size_t length);
   bool Serialize(OTSStream *out);
 
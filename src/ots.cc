@@ -8,14 +8,23 @@
 #include <zlib.h>
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <set>
 #include <vector>
 
 #include <woff2/decode.h>
 
+#include "ots-memory-stream.h"
+
 // The OpenType Font File
 // http://www.microsoft.com/typography/otspec/otff.htm
 
@@ -48,9 +57,11 @@
 #include "name.h"
 #include "os2.h"
 #include "ots.h"
+#include "parallel.h"
 #include "post.h"
 #include "prep.h"
 #include "stat.h"
+#include "subset.h"
 #include "vdmx.h"
 #include "vhea.h"
 #include "vmtx.h"
@@ -69,22 +80,188 @@
 
 namespace ots {
 
-struct Arena {
+// The stream Validate() and Plan() give to the code shared with Process():
+// nothing is written to it, only the position is kept, so that Plan() can
+// tell the size of the output.
+class NullStream : public OTSStream {
  public:
-  ~Arena() {
-    for (auto& hunk : hunks_) {
-      delete[] hunk;
-    }
+  NullStream() : m_offset(0), m_end(0) { }
+
+  size_t size() override { return std::numeric_limits<off_t>::max(); }
+
+  bool WriteRaw(const void *, size_t length) override {
+    m_offset += length;
+    m_end = std::max(m_end, m_offset);
+    return true;
+  }
+
+  // There is no point in computing checksums that are not written out.
+  bool WriteRawAndChecksum(const void *data, size_t length) override {
+    return WriteRaw(data, length);
+  }
+
+  bool WriteRawVAndChecksum(const Segment *, size_t,
+                            size_t total_length) override {
+    return WriteRaw(NULL, total_length);
+  }
+
+  bool Seek(off_t position) override {
+    m_offset = position;
+    return true;
   }
 
-  uint8_t* Allocate(size_t length) {
-    uint8_t* p = new uint8_t[length];
-    hunks_.push_back(p);
+  off_t Tell() const override { return m_offset; }
+
+  // How far anything was written. A broken collection can make a font write
+  // more table records than it has room for, past where it ends.
+  off_t end() const { return m_end; }
+
+ private:
+  off_t m_offset;
+  off_t m_end;
+};
+
+// The allocator used when the context does not provide one: it hands out
+// pieces of large blocks, and only frees them all at once. The allocator of a
+// session keeps its blocks when released instead, to use them again for the
+// next font.
+class BumpAllocator : public OTSAllocator {
+ public:
+  explicit BumpAllocator(bool keep_blocks = false)
+      : m_keep_blocks(keep_blocks) {
+  }
+
+  ~BumpAllocator() {
+    Free();
+  }
+
+  void* Allocate(size_t length) override {
+    // Round up so that every piece stays aligned for any type.
+    const size_t kAlignment = alignof(std::max_align_t);
+    if (length > std::numeric_limits<size_t>::max() - kAlignment) {
+      return NULL;
+    }
+    length = (length + kAlignment - 1) & ~(kAlignment - 1);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Large buffers, typically a decompressed font or big table, get a block
+    // of their own rather than wasting most of the current one.
+    if (length > kBlockSize / 4) {
+      return NewBlock(length);
+    }
+    if (length > m_remaining) {
+      uint8_t *block = NewBlock(kBlockSize);
+      if (!block) {
+        return NULL;
+      }
+      m_next = block;
+      m_remaining = kBlockSize;
+    }
+    uint8_t *p = m_next;
+    m_next += length;
+    m_remaining -= length;
     return p;
   }
 
+  void Release() override {
+    if (m_keep_blocks) {
+      m_spare.insert(m_spare.end(), m_blocks.begin(), m_blocks.end());
+      m_blocks.clear();
+      m_next = NULL;
+      m_remaining = 0;
+    } else {
+      Free();
+    }
+  }
+
+  // Frees all blocks, including those kept.
+  void Free() {
+    for (auto& block : m_blocks) {
+      delete[] block.first;
+    }
+    for (auto& block : m_spare) {
+      delete[] block.first;
+    }
+    m_blocks.clear();
+    m_spare.clear();
+    m_next = NULL;
+    m_remaining = 0;
+  }
+
  private:
-  std::vector<uint8_t*> hunks_;
+  static const size_t kBlockSize = 64 * 1024;
+
+  // Returns a block of at least |length| bytes, preferably the smallest one
+  // that was kept.
+  uint8_t* NewBlock(size_t length) {
+    auto best = m_spare.end();
+    for (auto it = m_spare.begin(); it != m_spare.end(); ++it) {
+      if (it->second >= length &&
+          (best == m_spare.end() || it->second < best->second)) {
+        best = it;
+      }
+    }
+    if (best != m_spare.end()) {
+      m_blocks.push_back(*best);
+      m_spare.erase(best);
+      return m_blocks.back().first;
+    }
+    uint8_t *block = new (std::nothrow) uint8_t[length];
+    if (block) {
+      m_blocks.push_back(std::make_pair(block, length));
+    }
+    return block;
+  }
+
+  const bool m_keep_blocks;
+  // The blocks in use, and those kept for later, with their sizes.
+  std::vector<std::pair<uint8_t*, size_t> > m_blocks;
+  std::vector<std::pair<uint8_t*, size_t> > m_spare;
+  uint8_t *m_next = NULL;
+  size_t m_remaining = 0;
+  std::mutex m_mutex;
+};
+
+// Coordinates the fonts of a collection being parsed concurrently, so that a
+// table shared by several of them is only parsed by the first one, and the
+// others only look at it once that font will not modify it any more. As in
+// FontFile::tables, tables are told apart by tag: a font uses the table an
+// earlier font parsed with the same tag, whatever the offset of its own.
+class SharedTables {
+ public:
+  // |tables| lists the table directory of each font in |fonts|.
+  SharedTables(const std::vector<Font*>& fonts,
+               const std::vector<std::vector<TableEntry> >& tables);
+
+  // Blocks until every font before |font| with a table tagged as |entry| has
+  // been through Font::ParseTable() for it, and the font that ended up
+  // parsing it, unless that is |font| itself, is done modifying it.
+  void WaitForTable(const Font *font, const TableEntry& entry);
+
+  // Called when |font| is through Font::ParseTable() for |entry|. |parsed|
+  // tells whether it was |font| that parsed the table.
+  void TableDone(const Font *font, const TableEntry& entry, bool parsed);
+
+  // Called when |font| is done parsing, successfully or not.
+  void FontDone(const Font *font);
+
+ private:
+  struct FontState {
+    FontState() : finished(false) {}
+
+    std::set<uint32_t> tags;
+    std::set<uint32_t> done;
+    bool finished;
+  };
+
+  bool IsFinal(size_t index, uint32_t tag) const;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::map<const Font*, size_t> m_index;
+  std::vector<FontState> m_fonts;
+  // The index of the font that parsed each table, by tag.
+  std::map<uint32_t, size_t> m_parsed_by;
 };
 
 bool CheckTag(uint32_t tag_value) {
@@ -112,8 +289,20 @@ static inline void ots_msg_tag(int level, const ots::FontFile* otf, const char*
   }
 }
 
+// Reports the failure of a table of |font|, remembering it if it is the
+// font's first one.
+static inline bool ots_failure_tag(ots::FontFile* otf, ots::Font* font,
+                                   const char* msg, uint32_t tag) {
+  ots_msg_tag(0, otf, msg, tag);
+  if (!font->failed_table) {
+    font->failed_table = tag;
+  }
+  return false;
+}
+
 // Generate a message with or without a table tag, when 'header' is the FontFile pointer
-#define OTS_FAILURE_MSG_TAG(msg_,tag_) (ots_msg_tag(0, header, msg_, tag_), false)
+// and 'font' the Font pointer
+#define OTS_FAILURE_MSG_TAG(msg_,tag_) ots_failure_tag(header, font, msg_, tag_)
 #define OTS_FAILURE_MSG_HDR(...)       OTS_FAILURE_MSG_(header, __VA_ARGS__)
 #define OTS_WARNING_MSG_HDR(...)       OTS_WARNING_MSG_(header, __VA_ARGS__)
 
@@ -178,6 +367,91 @@ const struct {
   { 0, false },
 };
 
+#define OTS_MAX_TABLE_DEPENDENCIES 12
+
+// The tables whose parsed data a table looks at, or adjusts, in its Parse()
+// method. They all come before it in supported_tables[] above; when the
+// context provides an executor, a table is parsed as soon as these are done,
+// concurrently with the other tables.
+//
+// Variations tables can drop each other (see Table::DropVariations()), so each
+// of them, and any other table that looks at fvar, waits for all the
+// variations tables before it. Likewise for the Graphite tables. Feat may
+// also add records to the name table, so it waits for every table before it
+// that looks at names.
+const struct {
+  uint32_t tag;
+  uint32_t depends_on[OTS_MAX_TABLE_DEPENDENCIES];
+} table_dependencies[] = {
+  { OTS_TAG_OS2,  { OTS_TAG_HEAD } },
+  { OTS_TAG_CMAP, { OTS_TAG_MAXP, OTS_TAG_OS2 } },
+  { OTS_TAG_HHEA, { OTS_TAG_MAXP } },
+  { OTS_TAG_HMTX, { OTS_TAG_MAXP, OTS_TAG_HHEA } },
+  { OTS_TAG_POST, { OTS_TAG_MAXP } },
+  { OTS_TAG_LOCA, { OTS_TAG_MAXP, OTS_TAG_HEAD } },
+  { OTS_TAG_GLYF, { OTS_TAG_MAXP, OTS_TAG_HEAD, OTS_TAG_NAME, OTS_TAG_LOCA } },
+  { OTS_TAG_CFF,  { OTS_TAG_MAXP } },
+  { OTS_TAG_HDMX, { OTS_TAG_MAXP, OTS_TAG_HEAD } },
+  { OTS_TAG_LTSH, { OTS_TAG_MAXP } },
+  { OTS_TAG_AVAR, { OTS_TAG_FVAR } },
+  { OTS_TAG_CVAR, { OTS_TAG_FVAR, OTS_TAG_AVAR } },
+  { OTS_TAG_GVAR, { OTS_TAG_MAXP, OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR } },
+  { OTS_TAG_HVAR, { OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR, OTS_TAG_GVAR } },
+  { OTS_TAG_MVAR, { OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR, OTS_TAG_GVAR,
+                    OTS_TAG_HVAR } },
+  { OTS_TAG_STAT, { OTS_TAG_NAME, OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR,
+                    OTS_TAG_GVAR, OTS_TAG_HVAR, OTS_TAG_MVAR } },
+  { OTS_TAG_VVAR, { OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR, OTS_TAG_GVAR,
+                    OTS_TAG_HVAR, OTS_TAG_MVAR, OTS_TAG_STAT } },
+  { OTS_TAG_CFF2, { OTS_TAG_MAXP, OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR,
+                    OTS_TAG_GVAR, OTS_TAG_HVAR, OTS_TAG_MVAR, OTS_TAG_STAT,
+                    OTS_TAG_VVAR } },
+  { OTS_TAG_CPAL, { OTS_TAG_NAME } },
+  { OTS_TAG_COLR, { OTS_TAG_MAXP, OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR,
+                    OTS_TAG_GVAR, OTS_TAG_HVAR, OTS_TAG_MVAR, OTS_TAG_STAT,
+                    OTS_TAG_VVAR, OTS_TAG_CPAL } },
+  { OTS_TAG_GDEF, { OTS_TAG_MAXP, OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR,
+                    OTS_TAG_GVAR, OTS_TAG_HVAR, OTS_TAG_MVAR, OTS_TAG_STAT,
+                    OTS_TAG_VVAR } },
+  { OTS_TAG_GPOS, { OTS_TAG_MAXP, OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR,
+                    OTS_TAG_GVAR, OTS_TAG_HVAR, OTS_TAG_MVAR, OTS_TAG_STAT,
+                    OTS_TAG_VVAR, OTS_TAG_GDEF } },
+  { OTS_TAG_GSUB, { OTS_TAG_MAXP, OTS_TAG_FVAR, OTS_TAG_AVAR, OTS_TAG_CVAR,
+                    OTS_TAG_GVAR, OTS_TAG_HVAR, OTS_TAG_MVAR, OTS_TAG_STAT,
+                    OTS_TAG_VVAR, OTS_TAG_GDEF } },
+  { OTS_TAG_VHEA, { OTS_TAG_MAXP } },
+  { OTS_TAG_VMTX, { OTS_TAG_MAXP, OTS_TAG_VHEA } },
+  { OTS_TAG_MATH, { OTS_TAG_MAXP } },
+#ifdef OTS_GRAPHITE
+  { OTS_TAG_GLOC, { OTS_TAG_NAME } },
+  { OTS_TAG_GLAT, { OTS_TAG_GLOC } },
+  { OTS_TAG_FEAT, { OTS_TAG_NAME, OTS_TAG_GLYF, OTS_TAG_STAT, OTS_TAG_CPAL,
+                    OTS_TAG_GLOC, OTS_TAG_GLAT } },
+  { OTS_TAG_SILF, { OTS_TAG_NAME, OTS_TAG_GLOC, OTS_TAG_GLAT, OTS_TAG_FEAT } },
+  { OTS_TAG_SILE, { OTS_TAG_GLOC, OTS_TAG_GLAT, OTS_TAG_FEAT, OTS_TAG_SILF } },
+  { OTS_TAG_SILL, { OTS_TAG_GLOC, OTS_TAG_GLAT, OTS_TAG_FEAT, OTS_TAG_SILF,
+                    OTS_TAG_SILE } },
+#endif
+  { 0, { 0 } },
+};
+
+// The tables whose Parse() method also modifies the parsed data of other
+// tables, on top of what Table::DropVariations() and Table::DropGraphite() do.
+const struct {
+  uint32_t tag;
+  uint32_t modifies[3];
+} table_modifications[] = {
+  { OTS_TAG_GLYF, { OTS_TAG_MAXP, OTS_TAG_HEAD, OTS_TAG_LOCA } },
+  { OTS_TAG_OS2,  { OTS_TAG_HEAD } },
+#ifdef OTS_GRAPHITE
+  { OTS_TAG_FEAT, { OTS_TAG_NAME } },
+#endif
+  { 0, { 0 } },
+};
+
+bool IsGraphiteTag(uint32_t tag);
+bool IsVariationsTag(uint32_t tag);
+
 bool ValidateVersionTag(ots::Font *font) {
   switch (font->version) {
     case 0x000010000:
@@ -191,6 +465,39 @@ bool ValidateVersionTag(ots::Font *font) {
   }
 }
 
+// The time since |start|, for the table observer.
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Tells the table observer that OTS is done with |table|, unless it has
+// already been told.
+void ReportTableEnd(ots::FontFile *header, ots::Table *table, bool ok,
+                    size_t output_bytes, uint64_t serialize_ns) {
+  uint64_t parse_ns;
+  {
+    std::lock_guard<std::mutex> lock(header->tables_mutex);
+    const auto &it = header->observed_tables.find(table);
+    if (it == header->observed_tables.end()) {
+      return;
+    }
+    parse_ns = it->second;
+    header->observed_tables.erase(it);
+  }
+  header->observer->OnTableEnd(table->Tag(), ok, output_bytes, parse_ns,
+                               serialize_ns);
+}
+
+// Tells the table observer about the tables parsed but not written out, once
+// processing is over.
+void ReportUnserializedTables(ots::FontFile *header) {
+  for (const auto &it : header->observed_tables) {
+    header->observer->OnTableEnd(it.first->Tag(), false, 0, it.second, 0);
+  }
+  header->observed_tables.clear();
+}
+
 bool ProcessGeneric(ots::FontFile *header,
                     ots::Font *font,
                     uint32_t signature,
@@ -199,10 +506,26 @@ bool ProcessGeneric(ots::FontFile *header,
                     const std::vector<ots::TableEntry>& tables,
                     ots::Buffer& file);
 
-bool ProcessTTF(ots::FontFile *header,
-                ots::Font *font,
-                ots::OTSStream *output, const uint8_t *data, size_t length,
-                uint32_t offset = 0) {
+bool ParseGeneric(ots::FontFile *header,
+                  ots::Font *font,
+                  uint32_t signature,
+                  ots::OTSStream *output,
+                  const uint8_t *data, size_t length,
+                  const std::vector<ots::TableEntry>& tables,
+                  ots::Buffer& file,
+                  std::map<uint32_t, ots::TableEntry>& table_map);
+
+bool SerializeGeneric(ots::FontFile *header,
+                      ots::Font *font,
+                      ots::OTSStream *output,
+                      std::map<uint32_t, ots::TableEntry>& table_map);
+
+// Parses the font at |offset|, leaving it ready for SerializeGeneric().
+bool ParseTTF(ots::FontFile *header,
+              ots::Font *font,
+              ots::OTSStream *output, const uint8_t *data, size_t length,
+              uint32_t offset,
+              std::map<uint32_t, ots::TableEntry>& table_map) {
   ots::Buffer file(data + offset, length - offset);
 
   if (offset > length) {
@@ -279,8 +602,174 @@ bool ProcessTTF(ots::FontFile *header,
     tables.push_back(table);
   }
 
-  return ProcessGeneric(header, font, font->version, output, data, length,
-                        tables, file);
+  return ParseGeneric(header, font, font->version, output, data, length,
+                      tables, file, table_map);
+}
+
+bool ProcessTTF(ots::FontFile *header,
+                ots::Font *font,
+                ots::OTSStream *output, const uint8_t *data, size_t length,
+                uint32_t offset = 0) {
+  std::map<uint32_t, ots::TableEntry> table_map;
+  return ParseTTF(header, font, output, data, length, offset, table_map) &&
+         SerializeGeneric(header, font, output, table_map);
+}
+
+// Reads the tags and offsets of the tables of the font at |offset|, without
+// checking or reporting anything; ParseTTF() does that.
+bool ReadTableEntries(const uint8_t *data, size_t length, uint32_t offset,
+                      std::vector<ots::TableEntry> *tables) {
+  if (offset > length) {
+    return false;
+  }
+  ots::Buffer file(data + offset, length - offset);
+
+  uint16_t num_tables;
+  if (!file.Skip(4) ||
+      !file.ReadU16(&num_tables) ||
+      !file.Skip(6)) {
+    return false;
+  }
+  for (unsigned i = 0; i < num_tables; ++i) {
+    ots::TableEntry table;
+    if (!file.ReadU32(&table.tag) ||
+        !file.ReadU32(&table.chksum) ||
+        !file.ReadU32(&table.offset) ||
+        !file.ReadU32(&table.length)) {
+      return false;
+    }
+    table.uncompressed_length = table.length;
+    tables->push_back(table);
+  }
+  return true;
+}
+
+// Whether the fonts of a collection can be parsed concurrently with the same
+// result as one after the other. That is not the case when a font would
+// modify a table it shares with an earlier font, which has to be serialized
+// before that happens.
+bool CanParseCollectionConcurrently(
+    const std::vector<std::vector<ots::TableEntry> >& tables) {
+  std::set<uint32_t> seen;
+  for (const auto &font_tables : tables) {
+    std::set<uint32_t> tags, shared_tags;
+    bool shares_variations = false, shares_graphite = false;
+    for (const auto &entry : font_tables) {
+      if (!tags.insert(entry.tag).second) {
+        // Only one of them is used, but which one is not decided here.
+        return false;
+      }
+      if (seen.count(entry.tag)) {
+        shared_tags.insert(entry.tag);
+        shares_variations |= IsVariationsTag(entry.tag);
+        shares_graphite |= IsGraphiteTag(entry.tag);
+      }
+    }
+
+    for (const auto &entry : font_tables) {
+      if (shared_tags.count(entry.tag)) continue;
+      // This font parses this table itself.
+      if ((shares_variations && IsVariationsTag(entry.tag)) ||
+          (shares_graphite && IsGraphiteTag(entry.tag))) {
+        return false;
+      }
+      for (unsigned i = 0; table_modifications[i].tag; ++i) {
+        if (table_modifications[i].tag != entry.tag) continue;
+        for (uint32_t tag : table_modifications[i].modifies) {
+          if (tag && shared_tags.count(tag)) {
+            return false;
+          }
+        }
+      }
+    }
+
+    for (const auto &entry : font_tables) {
+      seen.insert(entry.tag);
+    }
+  }
+  return true;
+}
+
+// Writes the header of a collection of |num_fonts| fonts, leaving room for
+// their offsets, which WriteCollectionOffset() fills in.
+bool WriteCollectionHeader(ots::FontFile *header,
+                           ots::OTSStream *output,
+                           uint32_t num_fonts) {
+  if (!output->WriteU32(OTS_TAG('t','t','c','f')) ||
+      !output->WriteU32(0x00010000) ||
+      !output->WriteU32(num_fonts) ||
+      !output->Seek((3 + num_fonts) * 4)) {
+    return OTS_FAILURE_MSG_HDR("Error writing output");
+  }
+  return true;
+}
+
+// Writes the offset of the |index|-th font of a collection, which starts at
+// the current position.
+bool WriteCollectionOffset(ots::FontFile *header,
+                           ots::OTSStream *output,
+                           uint32_t index) {
+  uint32_t out_offset = output->Tell();
+  if (!output->Seek((3 + index) * 4) ||
+      !output->WriteU32(out_offset) ||
+      !output->Seek(out_offset)) {
+    return OTS_FAILURE_MSG_HDR("Error writing output");
+  }
+  return true;
+}
+
+// Parses all the fonts of a collection on |executor|, each table shared
+// between them only once, then serializes them one after the other. Without
+// an executor, they are parsed one after the other instead.
+bool ProcessTTCConcurrently(
+    ots::FontFile *header,
+    ots::OTSStream *output,
+    const uint8_t *data,
+    size_t length,
+    const std::vector<uint32_t>& offsets,
+    const std::vector<std::vector<ots::TableEntry> >& tables,
+    ots::OTSExecutor *executor) {
+  const size_t num_fonts = offsets.size();
+  std::vector<ots::Font*> fonts;
+  for (size_t i = 0; i < num_fonts; i++) {
+    fonts.push_back(header->NewFont());
+  }
+  std::vector<std::map<uint32_t, ots::TableEntry> > table_maps(num_fonts);
+  // Not std::vector<bool>, as the fonts are written to concurrently.
+  std::unique_ptr<bool[]> parsed(new bool[num_fonts]());
+
+  ots::SharedTables shared_tables(fonts, tables);
+  header->shared_tables = &shared_tables;
+  {
+    ots::TaskGroup group(executor);
+    for (size_t i = 0; i < num_fonts; i++) {
+      group.Run([&, i]() {
+        parsed[i] = ParseTTF(header, fonts[i], output, data, length,
+                             offsets[i], table_maps[i]);
+        shared_tables.FontDone(fonts[i]);
+      });
+    }
+    group.Wait();
+  }
+  header->shared_tables = NULL;
+
+  for (size_t i = 0; i < num_fonts; i++) {
+    if (!parsed[i]) {
+      // A serial run would not have got to the fonts after this one.
+      for (size_t j = i + 1; j < num_fonts; j++) {
+        fonts[j]->failed_table = 0;
+      }
+      return false;
+    }
+    if (!WriteCollectionOffset(header, output, i)) {
+      return false;
+    }
+    if (!SerializeGeneric(header, fonts[i], output, table_maps[i])) {
+      return false;
+    }
+  }
+
+  return true;
 }
 
 bool ProcessTTC(ots::FontFile *header,
@@ -336,25 +825,45 @@ bool ProcessTTC(ots::FontFile *header,
   }
 
   if (index == static_cast<uint32_t>(-1)) {
-    if (!output->WriteU32(ttc_tag) ||
-        !output->WriteU32(0x00010000) ||
-        !output->WriteU32(num_fonts) ||
-        !output->Seek((3 + num_fonts) * 4)) {
-      return OTS_FAILURE_MSG_HDR("Error writing output");
+    if (header->subset) {
+      // The fonts can share their glyph tables, with different cmaps.
+      OTS_WARNING_MSG_HDR("Glyph subset not applied to a whole collection");
+      header->subset = NULL;
+    }
+    if (!WriteCollectionHeader(header, output, num_fonts)) {
+      return false;
+    }
+    if (header->plan) {
+      header->plan->collection = true;
     }
 
-    // Keep references to the fonts processed in the loop below, as we need
-    // them for reused tables.
-    std::vector<ots::Font> fonts(num_fonts, ots::Font(header));
+    // Plan() parses all the fonts before serializing any, when it can, so
+    // that Emit() only has to serialize them again.
+    ots::OTSExecutor *executor = header->context->GetExecutor();
+    if ((executor || header->plan) && num_fonts > 1) {
+      std::vector<std::vector<ots::TableEntry> > tables(num_fonts);
+      bool ok = true;
+      for (unsigned i = 0; ok && i < num_fonts; i++) {
+        ok = ReadTableEntries(data, length, offsets[i], &tables[i]);
+      }
+      if (ok && CanParseCollectionConcurrently(tables)) {
+        return ProcessTTCConcurrently(header, output, data, length, offsets,
+                                      tables, executor);
+      }
+    }
 
+    if (header->plan && num_fonts > 1) {
+      header->plan->deferrable = false;
+    }
+
+    // The fonts processed in the loop below are kept by |header|, as we need
+    // them for reused tables.
     for (unsigned i = 0; i < num_fonts; i++) {
-      uint32_t out_offset = output->Tell();
-      if (!output->Seek((3 + i) * 4) ||
-          !output->WriteU32(out_offset) ||
-          !output->Seek(out_offset)) {
-        return OTS_FAILURE_MSG_HDR("Error writing output");
+      if (!WriteCollectionOffset(header, output, i)) {
+        return false;
       }
-      if (!ProcessTTF(header, &fonts[i], output, data, length, offsets[i])) {
+      if (!ProcessTTF(header, header->NewFont(), output, data, length,
+                      offsets[i])) {
         return false;
       }
     }
@@ -365,8 +874,8 @@ bool ProcessTTC(ots::FontFile *header,
       return OTS_FAILURE_MSG_HDR("Requested font index is bigger than the number of fonts in the TTC file");
     }
 
-    ots::Font font(header);
-    return ProcessTTF(header, &font, output, data, length, offsets[index]);
+    return ProcessTTF(header, header->NewFont(), output, data, length,
+                      offsets[index]);
   }
 }
 
@@ -549,19 +1058,34 @@ bool ProcessWOFF2(ots::FontFile *header,
     return OTS_FAILURE_MSG_HDR("Size of decompressed WOFF 2.0 font exceeds output size (%gMB)", output->size() / (1024.0 * 1024.0));
   }
 
-  std::string buf(decompressed_size, 0);
-  woff2::WOFF2StringOut out(&buf);
-  out.SetMaxSize(decompressed_size);
-  if (!woff2::ConvertWOFF2ToTTF(data, length, &out)) {
+  uint8_t *decompressed = static_cast<uint8_t*>(
+      header->allocator->Allocate(decompressed_size));
+  if (!decompressed) {
+    return OTS_FAILURE_MSG_HDR("Failed to allocate memory for decompressed WOFF 2.0 font");
+  }
+  // The converter does not write the padding between tables.
+  std::memset(decompressed, 0, decompressed_size);
+  woff2::WOFF2MemoryOut out(decompressed, decompressed_size);
+  std::chrono::steady_clock::time_point start;
+  if (header->observer) {
+    header->observer->OnTableBegin(OTS_TAG('w','O','F','2'), length);
+    start = std::chrono::steady_clock::now();
+  }
+  const bool converted = woff2::ConvertWOFF2ToTTF(data, length, &out);
+  if (header->observer) {
+    header->observer->OnTableEnd(OTS_TAG('w','O','F','2'), converted,
+                                 converted ? out.Size() : 0,
+                                 ElapsedNs(start), 0);
+  }
+  if (!converted) {
     return OTS_FAILURE_MSG_HDR("Failed to convert WOFF 2.0 font to SFNT");
   }
-  const uint8_t *decompressed = reinterpret_cast<const uint8_t*>(buf.data());
 
   if (data[4] == 't' && data[5] == 't' && data[6] == 'c' && data[7] == 'f') {
     return ProcessTTC(header, output, decompressed, out.Size(), index);
   } else {
-    ots::Font font(header);
-    return ProcessTTF(header, &font, output, decompressed, out.Size());
+    return ProcessTTF(header, header->NewFont(), output, decompressed,
+                      out.Size());
   }
 }
 
@@ -587,13 +1111,18 @@ ots::TableAction GetTableAction(const ots::FontFile *header, uint32_t tag) {
 
 bool GetTableData(const uint8_t *data,
                   const ots::TableEntry& table,
-                  ots::Arena &arena,
+                  ots::OTSAllocator *allocator,
                   size_t *table_length,
                   const uint8_t **table_data) {
   if (table.uncompressed_length != table.length) {
     // Compressed table. Need to uncompress into memory first.
     *table_length = table.uncompressed_length;
-    *table_data = arena.Allocate(*table_length);
+    uint8_t *buffer = static_cast<uint8_t*>(
+        allocator->Allocate(*table_length));
+    if (!buffer) {
+      return false;
+    }
+    *table_data = buffer;
     uLongf dest_len = *table_length;
     int r = uncompress((Bytef*) *table_data, &dest_len,
                        data + table.offset, table.length);
@@ -609,6 +1138,133 @@ bool GetTableData(const uint8_t *data,
   return true;
 }
 
+// Parses the known tables, one after the other in supported_tables[] order.
+bool ParseSupportedTables(ots::FontFile *header,
+                          ots::Font *font,
+                          const std::map<uint32_t, ots::TableEntry>& table_map,
+                          const uint8_t *data) {
+  for (unsigned i = 0; ; ++i) {
+    if (supported_tables[i].tag == 0) break;
+
+    uint32_t tag = supported_tables[i].tag;
+    const auto &it = table_map.find(tag);
+    if (it == table_map.cend()) {
+      if (supported_tables[i].required) {
+        return OTS_FAILURE_MSG_TAG("missing required table", tag);
+      }
+    } else {
+      if (!font->ParseTable(it->second, data)) {
+        return OTS_FAILURE_MSG_TAG("Failed to parse table", tag);
+      }
+    }
+  }
+
+  return true;
+}
+
+// Parses the known tables on |executor|, each one as soon as the tables it
+// depends on (see table_dependencies[]) are done. The result, and the failure
+// reported if any, is the same as that of ParseSupportedTables().
+bool ParseSupportedTablesConcurrently(
+    ots::FontFile *header,
+    ots::Font *font,
+    const std::map<uint32_t, ots::TableEntry>& table_map,
+    const uint8_t *data,
+    ots::OTSExecutor *executor) {
+  struct Job {
+    const ots::TableEntry *entry;
+    std::vector<size_t> dependents;
+    size_t num_pending_dependencies;
+    bool failed;
+  };
+
+  // The serial path stops at the first missing required table, so we don't
+  // parse anything that comes after it either.
+  uint32_t missing_required_tag = 0;
+  std::vector<Job> jobs;
+  std::map<uint32_t, size_t> job_index;
+  std::vector<uint32_t> tags;
+  for (unsigned i = 0; supported_tables[i].tag; ++i) {
+    const uint32_t tag = supported_tables[i].tag;
+    const auto &it = table_map.find(tag);
+    if (it == table_map.cend()) {
+      if (supported_tables[i].required) {
+        missing_required_tag = tag;
+        break;
+      }
+      continue;
+    }
+    Job job = { &it->second, std::vector<size_t>(), 0, false };
+    job_index[tag] = jobs.size();
+    jobs.push_back(job);
+    tags.push_back(tag);
+  }
+
+  for (unsigned i = 0; table_dependencies[i].tag; ++i) {
+    const auto &job = job_index.find(table_dependencies[i].tag);
+    if (job == job_index.end()) continue;
+    for (unsigned j = 0; j < OTS_MAX_TABLE_DEPENDENCIES; ++j) {
+      const uint32_t tag = table_dependencies[i].depends_on[j];
+      if (tag == 0) break;
+      const auto &dependency = job_index.find(tag);
+      if (dependency == job_index.end()) continue;
+      assert(dependency->second < job->second);
+      jobs[dependency->second].dependents.push_back(job->second);
+      jobs[job->second].num_pending_dependencies++;
+    }
+  }
+
+  // Tables are added to |font| while other tables look theirs up.
+  font->ReserveTables(tags);
+
+  ots::TaskGroup group(executor);
+  std::mutex mutex;
+  std::function<void(size_t)> parse = [&](size_t index) {
+    Job &job = jobs[index];
+    if (font->ParseTable(*job.entry, data)) {
+      std::vector<size_t> ready;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t dependent : job.dependents) {
+          if (--jobs[dependent].num_pending_dependencies == 0) {
+            ready.push_back(dependent);
+          }
+        }
+      }
+      for (size_t dependent : ready) {
+        group.Run([&parse, dependent]() { parse(dependent); });
+      }
+    } else {
+      // Whatever depends on this table would not have been parsed at all.
+      job.failed = true;
+    }
+  };
+  // Collect these first, as the counts change as soon as anything runs.
+  std::vector<size_t> ready;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (jobs[i].num_pending_dependencies == 0) {
+      ready.push_back(i);
+    }
+  }
+  for (size_t i : ready) {
+    group.Run([&parse, i]() { parse(i); });
+  }
+  group.Wait();
+
+  // Any table left unparsed depends on one that failed and comes before it,
+  // so this finds the failure the serial path would have stopped at.
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (jobs[i].failed) {
+      return OTS_FAILURE_MSG_TAG("Failed to parse table", tags[i]);
+    }
+  }
+  if (missing_required_tag) {
+    return OTS_FAILURE_MSG_TAG("missing required table", missing_required_tag);
+  }
+
+  return true;
+}
+
 bool ProcessGeneric(ots::FontFile *header,
                     ots::Font *font,
                     uint32_t signature,
@@ -616,6 +1272,20 @@ bool ProcessGeneric(ots::FontFile *header,
                     const uint8_t *data, size_t length,
                     const std::vector<ots::TableEntry>& tables,
                     ots::Buffer& file) {
+  std::map<uint32_t, ots::TableEntry> table_map;
+  return ParseGeneric(header, font, signature, output, data, length, tables,
+                      file, table_map) &&
+         SerializeGeneric(header, font, output, table_map);
+}
+
+bool ParseGeneric(ots::FontFile *header,
+                  ots::Font *font,
+                  uint32_t signature,
+                  ots::OTSStream *output,
+                  const uint8_t *data, size_t length,
+                  const std::vector<ots::TableEntry>& tables,
+                  ots::Buffer& file,
+                  std::map<uint32_t, ots::TableEntry>& table_map) {
   const size_t data_offset = file.offset();
 
   uint32_t uncompressed_sum = 0;
@@ -713,38 +1383,51 @@ bool ProcessGeneric(ots::FontFile *header,
     }
   }
 
-  std::map<uint32_t, ots::TableEntry> table_map;
   for (unsigned i = 0; i < font->num_tables; ++i) {
     table_map[tables[i].tag] = tables[i];
   }
 
-  ots::Arena arena;
   // Parse known tables first as we need to parse them in specific order.
-  for (unsigned i = 0; ; ++i) {
-    if (supported_tables[i].tag == 0) break;
-
-    uint32_t tag = supported_tables[i].tag;
-    const auto &it = table_map.find(tag);
-    if (it == table_map.cend()) {
-      if (supported_tables[i].required) {
-        return OTS_FAILURE_MSG_TAG("missing required table", tag);
-      }
-    } else {
-      if (!font->ParseTable(it->second, data, arena)) {
-        return OTS_FAILURE_MSG_TAG("Failed to parse table", tag);
-      }
+  ots::OTSExecutor *executor = header->context->GetExecutor();
+  if (executor) {
+    if (!ParseSupportedTablesConcurrently(header, font, table_map, data,
+                                          executor)) {
+      return false;
+    }
+  } else {
+    if (!ParseSupportedTables(header, font, table_map, data)) {
+      return false;
     }
   }
 
   // Then parse any tables left.
   for (const auto &table_entry : tables) {
+    // Parsing a table again only links it to the font again, and a table
+    // shared with a font of the collection that is still being parsed can't
+    // tell yet whether it should be serialized.
+    if (header->shared_tables && font->HasTable(table_entry.tag)) {
+      continue;
+    }
     if (!font->GetTable(table_entry.tag)) {
-      if (!font->ParseTable(table_entry, data, arena)) {
+      if (!font->ParseTable(table_entry, data)) {
         return OTS_FAILURE_MSG_TAG("Failed to parse table", table_entry.tag);
       }
     }
   }
 
+  // Now that the glyphs are all known to be valid, remove those that are not
+  // wanted.
+  if (header->subset && !ots::SubsetFont(font, *header->subset)) {
+    return OTS_FAILURE_MSG_HDR("Failed to subset glyphs");
+  }
+
+  return true;
+}
+
+bool SerializeGeneric(ots::FontFile *header,
+                      ots::Font *font,
+                      ots::OTSStream *output,
+                      std::map<uint32_t, ots::TableEntry>& table_map) {
 #ifdef OTS_SYNTHESIZE_MISSING_GVAR
   // If there was an fvar table but no gvar, synthesize an empty gvar to avoid
   // issues with rasterizers (e.g. Core Text) that assume it must be present.
@@ -824,6 +1507,36 @@ bool ProcessGeneric(ots::FontFile *header,
       num_output_tables++;
   }
 
+  if (header->validation) {
+    // Nothing is written out, but the tables are still serialized, into the
+    // NullStream, as some checks are only made then.
+    for (const auto &it : table_map) {
+      const uint32_t input_offset = it.second.offset;
+      ots::Table *table = font->GetTable(it.first);
+      if (!table || header->table_entries.count(input_offset)) {
+        continue;
+      }
+      std::chrono::steady_clock::time_point start;
+      if (header->observer) {
+        start = std::chrono::steady_clock::now();
+      }
+      ots::TableEntry out = it.second;
+      out.offset = output->Tell();
+      if (!table->Serialize(output)) {
+        return OTS_FAILURE_MSG_TAG("Failed to serialize table", it.first);
+      }
+      out.length = output->Tell() - out.offset;
+      header->table_entries[input_offset] = out;
+      if (header->observer) {
+        ReportTableEnd(header, table, true, out.length, ElapsedNs(start));
+      }
+    }
+    header->validation->num_tables += num_output_tables;
+    header->validation->num_dropped_tables +=
+        table_map.size() - num_output_tables;
+    return true;
+  }
+
   uint16_t max_pow2 = 0;
   while (1u << (max_pow2 + 1) <= num_output_tables) {
     max_pow2++;
@@ -870,6 +1583,10 @@ bool ProcessGeneric(ots::FontFile *header,
 
       ots::Table *table = font->GetTable(out.tag);
       if (table) {
+        std::chrono::steady_clock::time_point start;
+        if (header->observer) {
+          start = std::chrono::steady_clock::now();
+        }
         output->ResetChecksum();
         if (!table->Serialize(output)) {
           return OTS_FAILURE_MSG_TAG("Failed to serialize table", out.tag);
@@ -890,6 +1607,9 @@ bool ProcessGeneric(ots::FontFile *header,
         out.chksum = output->chksum();
         out_tables.push_back(out);
         header->table_entries[input_offset] = out;
+        if (header->observer) {
+          ReportTableEnd(header, table, true, out.length, ElapsedNs(start));
+        }
       }
     }
   }
@@ -935,9 +1655,30 @@ bool ProcessGeneric(ots::FontFile *header,
     return OTS_FAILURE_MSG_HDR("error writing output");
   }
 
+  if (header->plan) {
+    header->plan->fonts.push_back(std::make_pair(font, table_map));
+  }
+
   return true;
 }
 
+// Sanitizes the font file |data|, whatever its format.
+bool ProcessFile(ots::FontFile *header,
+                 ots::OTSStream *output,
+                 const uint8_t *data,
+                 size_t length,
+                 uint32_t index) {
+  if (data[0] == 'w' && data[1] == 'O' && data[2] == 'F' && data[3] == 'F') {
+    return ProcessWOFF(header, header->NewFont(), output, data, length);
+  } else if (data[0] == 'w' && data[1] == 'O' && data[2] == 'F' && data[3] == '2') {
+    return ProcessWOFF2(header, output, data, length, index);
+  } else if (data[0] == 't' && data[1] == 't' && data[2] == 'c' && data[3] == 'f') {
+    return ProcessTTC(header, output, data, length, index);
+  } else {
+    return ProcessTTF(header, header->NewFont(), output, data, length);
+  }
+}
+
 bool IsGraphiteTag(uint32_t tag) {
   if (tag == OTS_TAG_FEAT ||
       tag == OTS_TAG_GLAT ||
@@ -975,18 +1716,110 @@ FontFile::~FontFile() {
   tables.clear();
 }
 
-bool Font::ParseTable(const TableEntry& table_entry, const uint8_t* data,
-                      Arena &arena) {
+SharedTables::SharedTables(const std::vector<Font*>& fonts,
+                           const std::vector<std::vector<TableEntry> >& tables)
+    : m_fonts(fonts.size()) {
+  for (size_t i = 0; i < fonts.size(); i++) {
+    m_index[fonts[i]] = i;
+    for (const auto &entry : tables[i]) {
+      m_fonts[i].tags.insert(entry.tag);
+    }
+  }
+}
+
+void SharedTables::WaitForTable(const Font *font, const TableEntry& entry) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  const size_t index = m_index[font];
+  for (;;) {
+    bool ready = true;
+    for (size_t i = 0; i < index && ready; i++) {
+      const FontState &state = m_fonts[i];
+      if (state.tags.count(entry.tag) && !state.finished && !state.done.count(entry.tag)) {
+        ready = false;
+      }
+    }
+    if (ready) {
+      const auto &parsed_by = m_parsed_by.find(entry.tag);
+      if (parsed_by == m_parsed_by.end() ||
+          parsed_by->second == index ||
+          IsFinal(parsed_by->second, entry.tag)) {
+        return;
+      }
+    }
+    m_cond.wait(lock);
+  }
+}
+
+void SharedTables::TableDone(const Font *font, const TableEntry& entry,
+                             bool parsed) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const size_t index = m_index[font];
+    m_fonts[index].done.insert(entry.tag);
+    if (parsed) {
+      m_parsed_by[entry.tag] = index;
+    }
+  }
+  m_cond.notify_all();
+}
+
+void SharedTables::FontDone(const Font *font) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fonts[m_index[font]].finished = true;
+  }
+  m_cond.notify_all();
+}
+
+bool SharedTables::IsFinal(size_t index, uint32_t tag) const {
+  const FontState &state = m_fonts[index];
+  if (state.finished) {
+    return true;
+  }
+  // Any of these tables can drop the others.
+  if (IsVariationsTag(tag) || IsGraphiteTag(tag)) {
+    return false;
+  }
+  for (unsigned i = 0; table_modifications[i].tag; ++i) {
+    const uint32_t modifier = table_modifications[i].tag;
+    for (uint32_t modified : table_modifications[i].modifies) {
+      if (modified == tag && state.tags.count(modifier) &&
+          !state.done.count(modifier)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Font::ParseTable(const TableEntry& table_entry, const uint8_t* data) {
+  if (!file->shared_tables) {
+    return DoParseTable(table_entry, data);
+  }
+
+  file->shared_tables->WaitForTable(this, table_entry);
+  const bool ret = DoParseTable(table_entry, data);
+  const auto &it = m_tables.find(table_entry.tag);
+  file->shared_tables->TableDone(
+      this, table_entry,
+      it != m_tables.end() && it->second && it->second->GetFont() == this);
+  return ret;
+}
+
+bool Font::DoParseTable(const TableEntry& table_entry, const uint8_t* data) {
   uint32_t tag = table_entry.tag;
   TableAction action = GetTableAction(file, tag);
   if (action == TABLE_ACTION_DROP) {
     return true;
   }
 
-  const auto &it = file->tables.find(table_entry);
-  if (it != file->tables.end()) {
-    m_tables[tag] = it->second;
-    return true;
+  {
+    std::lock_guard<std::mutex> lock(file->tables_mutex);
+    const auto &it = file->tables.find(table_entry);
+    if (it != file->tables.end()) {
+      m_tables[tag] = it->second;
+      return true;
+    }
   }
 
   Table *table = NULL;
@@ -1049,19 +1882,39 @@ bool Font::ParseTable(const TableEntry& table_entry, const uint8_t* data,
   if (table) {
     const uint8_t* table_data;
     size_t table_length;
+    bool added = false;
+
+    std::chrono::steady_clock::time_point start;
+    if (file->observer) {
+      file->observer->OnTableBegin(tag, table_entry.length);
+      start = std::chrono::steady_clock::now();
+    }
 
-    ret = GetTableData(data, table_entry, arena, &table_length, &table_data);
+    ret = GetTableData(data, table_entry, file->allocator, &table_length,
+                       &table_data);
     if (ret) {
       ret = table->Parse(table_data, table_length);
-      if (ret)
+      if (ret) {
         AddTable(table_entry, table);
-      else if (action == TABLE_ACTION_SANITIZE_SOFT) {
+        added = true;
+      } else if (action == TABLE_ACTION_SANITIZE_SOFT) {
         // We're dropping the table (having reported whatever errors we found),
         // but do not return failure, so that processing continues.
         delete table;
         ret = true;
       }
     }
+
+    if (file->observer) {
+      // The end is reported once the table is serialized, or not.
+      const uint64_t parse_ns = ElapsedNs(start);
+      if (added) {
+        std::lock_guard<std::mutex> lock(file->tables_mutex);
+        file->observed_tables[table] = parse_ns;
+      } else {
+        file->observer->OnTableEnd(tag, false, 0, parse_ns, 0);
+      }
+    }
   }
 
   if (!ret)
@@ -1077,6 +1930,11 @@ Table* Font::GetTable(uint32_t tag) const {
   return NULL;
 }
 
+bool Font::HasTable(uint32_t tag) const {
+  const auto &it = m_tables.find(tag);
+  return it != m_tables.end() && it->second;
+}
+
 Table* Font::GetTypedTable(uint32_t tag) const {
   Table* t = GetTable(tag);
   if (t && t->Type() == tag)
@@ -1086,16 +1944,27 @@ Table* Font::GetTypedTable(uint32_t tag) const {
 
 void Font::AddTable(TableEntry entry, Table* table) {
   // Attempting to add a duplicate table would be an error; this should only
-  // be used to add a table that does not already exist.
-  assert(m_tables.find(table->Tag()) == m_tables.end());
+  // be used to add a table that does not already exist (or whose slot was
+  // created by ReserveTables()).
+  assert(m_tables.find(table->Tag()) == m_tables.end() ||
+         !m_tables[table->Tag()]);
   m_tables[table->Tag()] = table;
+  std::lock_guard<std::mutex> lock(file->tables_mutex);
   file->tables[entry] = table;
 }
 
+void Font::ReserveTables(const std::vector<uint32_t>& tags) {
+  for (uint32_t tag : tags) {
+    m_tables.insert(std::make_pair(tag, static_cast<Table*>(NULL)));
+  }
+}
+
+// Note that these only look at the slots of the tables being dropped, which
+// other tables being parsed concurrently never touch.
 void Font::DropGraphite() {
   file->context->Message(0, "Dropping all Graphite tables");
-  for (const std::pair<uint32_t, Table*> entry : m_tables) {
-    if (IsGraphiteTag(entry.first)) {
+  for (const auto& entry : m_tables) {
+    if (IsGraphiteTag(entry.first) && entry.second) {
       entry.second->Drop("Discarding Graphite table");
     }
   }
@@ -1103,8 +1972,8 @@ void Font::DropGraphite() {
 
 void Font::DropVariations() {
   file->context->Message(0, "Dropping all Variation tables");
-  for (const std::pair<uint32_t, Table*> entry : m_tables) {
-    if (IsVariationsTag(entry.first)) {
+  for (const auto& entry : m_tables) {
+    if (IsVariationsTag(entry.first) && entry.second) {
       entry.second->Drop("Discarding Variations table");
     }
   }
@@ -1190,29 +2059,213 @@ bool TablePassthru::Serialize(OTSStream *out) {
   return true;
 }
 
+struct OTSSession::State {
+  State() : allocator(true) { }
+
+  BumpAllocator allocator;
+  ScratchPool scratch;
+};
+
+OTSSession::OTSSession() : state_(new State) {
+}
+
+OTSSession::~OTSSession() {
+  delete state_;
+}
+
+void OTSSession::Reset() {
+  state_->allocator.Free();
+  state_->scratch.Clear();
+}
+
+struct OTSPlan::State {
+  State() : data(NULL), length(0), index(0), size(0) { }
+
+  ~State() {
+    if (header.allocator) {
+      header.allocator->Release();
+    }
+  }
+
+  FontFile header;
+  BumpAllocator default_allocator;
+  PlannedOutput output;
+  // The input, for fonts that have to be sanitized again by Emit().
+  const uint8_t *data;
+  size_t length;
+  uint32_t index;
+  size_t size;
+  // The sanitized font, if it could not be planned; see
+  // PlannedOutput::deferrable.
+  std::vector<uint8_t> buffer;
+};
+
+OTSPlan::OTSPlan() : state_(new State) {
+}
+
+OTSPlan::~OTSPlan() {
+  delete state_;
+}
+
+size_t OTSPlan::size() const {
+  return state_->size;
+}
+
 bool OTSContext::Process(OTSStream *output,
                          const uint8_t *data,
                          size_t length,
                          uint32_t index) {
+  return DoProcess(output, data, length, index, NULL);
+}
+
+ValidationResult OTSContext::Validate(const uint8_t *data,
+                                      size_t length,
+                                      uint32_t index) {
+  ValidationResult result;
+  NullStream output;
+  result.ok = DoProcess(&output, data, length, index, &result);
+  return result;
+}
+
+size_t OTSContext::Plan(OTSPlan *plan,
+                        const uint8_t *data,
+                        size_t length,
+                        uint32_t index) {
+  // Start over, releasing what an earlier call kept.
+  delete plan->state_;
+  plan->state_ = new OTSPlan::State;
+  OTSPlan::State *state = plan->state_;
+  FontFile *header = &state->header;
+  header->context = this;
+
+  if (length < 4) {
+    OTS_FAILURE_MSG_(header, "file less than 4 bytes");
+    return 0;
+  }
+
+  SetUpFontFile(header, &state->default_allocator);
+  header->plan = &state->output;
+  state->data = data;
+  state->length = length;
+  state->index = index;
+
+  NullStream output;
+  const bool result = ProcessFile(header, &output, data, length, index);
+  if (header->observer) {
+    ReportUnserializedTables(header);
+  }
+  if (!result) {
+    delete plan->state_;
+    plan->state_ = new OTSPlan::State;
+    return 0;
+  }
+  // Like a file, the output holds everything written, even past the end.
+  state->size = output.end();
+
+  // Serializing again would then end short of it, so keep a copy instead.
+  if (output.end() > output.Tell()) {
+    state->output.deferrable = false;
+  }
+
+  if (!state->output.deferrable) {
+    // Sanitize it again, now that we know how much room it needs.
+    delete plan->state_;
+    plan->state_ = new OTSPlan::State;
+    state = plan->state_;
+    state->buffer.resize(output.end());
+    MemoryStream buffer(state->buffer.data(), state->buffer.size());
+    if (!Process(&buffer, data, length, index)) {
+      state->buffer.clear();
+      return 0;
+    }
+    state->size = state->buffer.size();
+  }
+  return state->size;
+}
+
+bool OTSContext::Emit(OTSPlan *plan, OTSStream *output) {
+  OTSPlan::State *state = plan->state_;
+  if (!state->size) {
+    return false;
+  }
+  if (!state->buffer.empty()) {
+    return output->Write(state->buffer.data(), state->buffer.size());
+  }
+
+  FontFile *header = &state->header;
+  header->context = this;
+  // Nothing is recorded or reported this time, and the tables shared between
+  // fonts are written out again.
+  header->plan = NULL;
+  header->observer = NULL;
+  header->table_entries.clear();
+
+  auto &fonts = state->output.fonts;
+  if (state->output.collection &&
+      !WriteCollectionHeader(header, output, fonts.size())) {
+    return false;
+  }
+  for (size_t i = 0; i < fonts.size(); i++) {
+    if (state->output.collection &&
+        !WriteCollectionOffset(header, output, i)) {
+      return false;
+    }
+    if (!SerializeGeneric(header, fonts[i].first, output, fonts[i].second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void OTSContext::SetUpFontFile(FontFile *header,
+                               OTSAllocator *default_allocator) {
+  OTSSession *session = GetSession();
+  header->allocator = GetAllocator();
+  if (!header->allocator) {
+    header->allocator =
+        session ? &session->state_->allocator : default_allocator;
+  }
+  if (session) {
+    header->scratch = &session->state_->scratch;
+  }
+  header->observer = GetTableObserver();
+  header->subset = GetGlyphSubset();
+}
+
+bool OTSContext::DoProcess(OTSStream *output,
+                           const uint8_t *data,
+                           size_t length,
+                           uint32_t index,
+                           ValidationResult *validation) {
   FontFile header;
-  Font font(&header);
   header.context = this;
+  header.validation = validation;
 
   if (length < 4) {
     return OTS_FAILURE_MSG_(&header, "file less than 4 bytes");
   }
 
-  bool result;
-  if (data[0] == 'w' && data[1] == 'O' && data[2] == 'F' && data[3] == 'F') {
-    result = ProcessWOFF(&header, &font, output, data, length);
-  } else if (data[0] == 'w' && data[1] == 'O' && data[2] == 'F' && data[3] == '2') {
-    result = ProcessWOFF2(&header, output, data, length, index);
-  } else if (data[0] == 't' && data[1] == 't' && data[2] == 'c' && data[3] == 'f') {
-    result = ProcessTTC(&header, output, data, length, index);
-  } else {
-    result = ProcessTTF(&header, &font, output, data, length);
+  BumpAllocator default_allocator;
+  SetUpFontFile(&header, &default_allocator);
+  const bool result = ProcessFile(&header, output, data, length, index);
+  if (header.observer) {
+    ReportUnserializedTables(&header);
   }
 
+  header.allocator->Release();
+  if (validation && !result) {
+    // Only the font that failed has a failed table, as the ones after it
+    // are not processed (or, if processed concurrently, are forgotten), so
+    // this reports the same table with or without an executor.
+    for (const Font& font : header.fonts) {
+      if (font.failed_table) {
+        validation->failed_table = font.failed_table;
+        break;
+      }
+    }
+    validation->num_tables = 0;
+    validation->num_dropped_tables = 0;
+  }
   return result;
 }
 
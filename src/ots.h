@@ -15,8 +15,15 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
 
 #include "opentype-sanitiser.h"
 
@@ -65,6 +72,145 @@ namespace ots {
 
 #define OTS_WARNING(...) OTS_WARNING_MSG_(font->file, TABLE_NAME ": " __VA_ARGS__)
 
+// Copy |count| big-endian values from |src| to |dest|, in the host's byte
+// order, with SIMD instructions when the CPU has them. The second one widens
+// 16-bit values to 32 bits.
+void LoadBigEndianU16(uint16_t *dest, const uint8_t *src, size_t count);
+void LoadBigEndianU16(uint32_t *dest, const uint8_t *src, size_t count);
+void LoadBigEndianU32(uint32_t *dest, const uint8_t *src, size_t count);
+
+// Returns whether none of the |count| big-endian values at |src| is larger
+// than the one after it.
+bool IsNondecreasingBigEndianU16(const uint8_t *src, size_t count);
+bool IsNondecreasingBigEndianU32(const uint8_t *src, size_t count);
+
+// -----------------------------------------------------------------------------
+// Fixed-layout records
+//
+// Record<Fields...> describes a record of big-endian fields of the given types,
+// e.g. Record<uint16_t, uint16_t, int16_t> for a kerning pair, and decodes one
+// in a single step from bytes whose bounds have already been checked. Uint24
+// stands for a 24-bit field, which is decoded into a uint32_t.
+// -----------------------------------------------------------------------------
+
+struct Uint24 {};
+
+template <typename T> struct RecordField;
+
+template <> struct RecordField<uint8_t> {
+  typedef uint8_t Value;
+  static const size_t kSize = 1;
+  static Value Load(const uint8_t *p) { return p[0]; }
+};
+
+template <> struct RecordField<uint16_t> {
+  typedef uint16_t Value;
+  static const size_t kSize = 2;
+  static Value Load(const uint8_t *p) {
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(uint16_t));
+    return ots_ntohs(value);
+  }
+};
+
+template <> struct RecordField<int16_t> {
+  typedef int16_t Value;
+  static const size_t kSize = 2;
+  static Value Load(const uint8_t *p) {
+    return static_cast<int16_t>(RecordField<uint16_t>::Load(p));
+  }
+};
+
+template <> struct RecordField<Uint24> {
+  typedef uint32_t Value;
+  static const size_t kSize = 3;
+  static Value Load(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) << 16 |
+        static_cast<uint32_t>(p[1]) << 8 |
+        static_cast<uint32_t>(p[2]);
+  }
+};
+
+template <> struct RecordField<uint32_t> {
+  typedef uint32_t Value;
+  static const size_t kSize = 4;
+  static Value Load(const uint8_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(uint32_t));
+    return ots_ntohl(value);
+  }
+};
+
+template <> struct RecordField<int32_t> {
+  typedef int32_t Value;
+  static const size_t kSize = 4;
+  static Value Load(const uint8_t *p) {
+    return static_cast<int32_t>(RecordField<uint32_t>::Load(p));
+  }
+};
+
+template <typename... Fields> struct Record;
+
+template <> struct Record<> {
+  static const size_t kSize = 0;
+  static void Decode(const uint8_t *) {}
+};
+
+template <typename Field, typename... Rest>
+struct Record<Field, Rest...> {
+  static const size_t kSize =
+      RecordField<Field>::kSize + Record<Rest...>::kSize;
+
+  static void Decode(const uint8_t *p,
+                     typename RecordField<Field>::Value *value,
+                     typename RecordField<Rest>::Value *... rest) {
+    *value = RecordField<Field>::Load(p);
+    Record<Rest...>::Decode(p + RecordField<Field>::kSize, rest...);
+  }
+};
+
+template <typename Field, typename... Rest>
+const size_t Record<Field, Rest...>::kSize;
+
+// A cursor over bytes that Buffer::Reserve() has already checked are there,
+// which reads them without checking anything again. Reading past what was
+// reserved is a bug in the caller.
+class BufferCursor {
+ public:
+  BufferCursor() : data_(NULL) { }
+
+  // Decodes the next record, of type Record<...>, into |values|.
+  template <typename R, typename... Values>
+  void Read(Values *... values) {
+    R::Decode(data_, values...);
+    data_ += R::kSize;
+  }
+
+  uint8_t ReadU8() { return *data_++; }
+
+  uint16_t ReadU16() {
+    const uint16_t value = RecordField<uint16_t>::Load(data_);
+    data_ += 2;
+    return value;
+  }
+
+  int16_t ReadS16() { return static_cast<int16_t>(ReadU16()); }
+
+  uint32_t ReadU32() {
+    const uint32_t value = RecordField<uint32_t>::Load(data_);
+    data_ += 4;
+    return value;
+  }
+
+  void Skip(size_t n_bytes) { data_ += n_bytes; }
+
+ private:
+  friend class Buffer;
+  explicit BufferCursor(const uint8_t *data) : data_(data) { }
+
+  const uint8_t *data_;
+};
+
 // -----------------------------------------------------------------------------
 // Buffer helper class
 //
@@ -154,6 +300,98 @@ class Buffer {
     return true;
   }
 
+  // Read |count| values at once, checking the bounds only once. The vector
+  // versions resize |values| to |count| first, and leave it alone on failure.
+  bool ReadU16Array(uint16_t *values, size_t count) {
+    if (!HasArray(count, 2)) {
+      return OTS_FAILURE();
+    }
+    LoadBigEndianU16(values, buffer_ + offset_, count);
+    offset_ += count * 2;
+    return true;
+  }
+
+  bool ReadU16Array(std::vector<uint16_t> *values, size_t count) {
+    if (!HasArray(count, 2)) {
+      return OTS_FAILURE();
+    }
+    values->resize(count);
+    return ReadU16Array(values->data(), count);
+  }
+
+  // Same, widening each value to 32 bits.
+  bool ReadU16Array(uint32_t *values, size_t count) {
+    if (!HasArray(count, 2)) {
+      return OTS_FAILURE();
+    }
+    LoadBigEndianU16(values, buffer_ + offset_, count);
+    offset_ += count * 2;
+    return true;
+  }
+
+  bool ReadS16Array(int16_t *values, size_t count) {
+    return ReadU16Array(reinterpret_cast<uint16_t*>(values), count);
+  }
+
+  bool ReadS16Array(std::vector<int16_t> *values, size_t count) {
+    if (!HasArray(count, 2)) {
+      return OTS_FAILURE();
+    }
+    values->resize(count);
+    return ReadS16Array(values->data(), count);
+  }
+
+  bool ReadU32Array(uint32_t *values, size_t count) {
+    if (!HasArray(count, 4)) {
+      return OTS_FAILURE();
+    }
+    LoadBigEndianU32(values, buffer_ + offset_, count);
+    offset_ += count * 4;
+    return true;
+  }
+
+  bool ReadU32Array(std::vector<uint32_t> *values, size_t count) {
+    if (!HasArray(count, 4)) {
+      return OTS_FAILURE();
+    }
+    values->resize(count);
+    return ReadU32Array(values->data(), count);
+  }
+
+  // Checks once that |n_bytes| are left and moves past them, handing them to
+  // |cursor| to read without further checks.
+  bool Reserve(size_t n_bytes, BufferCursor *cursor) {
+    if (length_ < n_bytes || offset_ > length_ - n_bytes) {
+      return OTS_FAILURE();
+    }
+    *cursor = BufferCursor(buffer_ + offset_);
+    offset_ += n_bytes;
+    return true;
+  }
+
+  // Same for |count| records of type Record<...>.
+  template <typename R>
+  bool ReserveRecords(size_t count, BufferCursor *cursor) {
+    if (!HasArray(count, R::kSize)) {
+      return OTS_FAILURE();
+    }
+    *cursor = BufferCursor(buffer_ + offset_);
+    offset_ += count * R::kSize;
+    return true;
+  }
+
+  // Reads one record of type Record<...> into |values|, e.g.
+  //   table.ReadRecord<Record<uint16_t, uint32_t> >(&glyph, &offset)
+  template <typename R, typename... Values>
+  bool ReadRecord(Values *... values) {
+    if (length_ < R::kSize || offset_ > length_ - R::kSize) {
+      return OTS_FAILURE();
+    }
+    R::Decode(buffer_ + offset_, values...);
+    offset_ += R::kSize;
+    return true;
+  }
+
   const uint8_t *buffer() const { return buffer_; }
   size_t offset() const { return offset_; }
   size_t length() const { return length_; }
@@ -162,6 +400,11 @@ class Buffer {
   void set_offset(size_t newoffset) { offset_ = newoffset; }
 
  private:
+  // Whether |count| values of |size| bytes are left to read.
+  bool HasArray(size_t count, size_t size) const {
+    return offset_ <= length_ && count <= (length_ - offset_) / size;
+  }
+
   const uint8_t * const buffer_;
   const size_t length_;
   size_t offset_;
@@ -238,7 +481,66 @@ bool CheckTag(uint32_t tag_value);
 struct Font;
 struct FontFile;
 struct TableEntry;
-struct Arena;
+class SharedTables;
+
+// Vectors whose storage an OTSSession keeps from one font to the next, so
+// that the table parsers do not have to allocate it again. Tables take the
+// vectors they fill while parsing and give them back when they are destroyed;
+// as tables can be parsed concurrently, this is guarded by a mutex.
+class ScratchPool {
+ public:
+  // Swaps |v| for an empty vector that has kept the storage of one given
+  // back earlier, if there is one.
+  template <typename T>
+  void Take(std::vector<T> *v) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::vector<T> > &spare = Spare<T>();
+    if (!spare.empty()) {
+      v->swap(spare.back());
+      spare.pop_back();
+      v->clear();
+    }
+  }
+
+  // Keeps the storage of |v|, which is left empty.
+  template <typename T>
+  void Give(std::vector<T> *v) {
+    if (!v->capacity()) {
+      return;
+    }
+    v->clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Spare<T>().push_back(std::move(*v));
+    v->clear();
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spare.clear();
+  }
+
+ private:
+  struct SpareBase {
+    virtual ~SpareBase() { }
+  };
+
+  template <typename T>
+  struct SpareVectors : public SpareBase {
+    std::vector<std::vector<T> > vectors;
+  };
+
+  template <typename T>
+  std::vector<std::vector<T> > &Spare() {
+    std::unique_ptr<SpareBase> &spare = m_spare[std::type_index(typeid(T))];
+    if (!spare) {
+      spare.reset(new SpareVectors<T>);
+    }
+    return static_cast<SpareVectors<T>*>(spare.get())->vectors;
+  }
+
+  std::mutex m_mutex;
+  std::map<std::type_index, std::unique_ptr<SpareBase> > m_spare;
+};
 
 class Table {
  public:
@@ -246,6 +548,7 @@ class Table {
       : m_tag(tag),
         m_type(type),
         m_font(font),
+        m_scratch(NULL),
         m_shouldSerialize(true) {
   }
 
@@ -273,12 +576,27 @@ class Table {
   bool DropGraphite(const char *format, ...);
   bool DropVariations(const char *format, ...);
 
+  // Swaps |v| for an empty vector from the session's scratch pool, if the
+  // context has a session, so that filling it may not need to allocate.
+  template <typename T>
+  void TakeScratch(std::vector<T> *v);
+  // Gives the storage of |v| back to the pool; called by destructors.
+  template <typename T>
+  void GiveScratch(std::vector<T> *v) {
+    if (m_scratch) {
+      m_scratch->Give(v);
+    }
+  }
+
  private:
   void Message(int level, const char *format, va_list va);
 
   uint32_t m_tag;
   uint32_t m_type;
   Font *m_font;
+  // Set by TakeScratch(), as the font may be gone by the time the table is
+  // destroyed.
+  ScratchPool *m_scratch;
   bool m_shouldSerialize;
 };
 
@@ -298,6 +616,70 @@ class TablePassthru : public Table {
   size_t m_length;
 };
 
+// Remembers the OpenType layout subtables (Coverage and ClassDef tables)
+// already found to be valid, as many lookups usually point at the
+// same few of them. A subtable is identified by its address and the limits it
+// was checked against. GSUB, GPOS and MATH can be parsed concurrently, so this
+// is guarded by a mutex.
+class LayoutSubtableCache {
+ public:
+  enum SubtableType {
+    kCoverage,
+    kClassDef,
+    kNumSubtableTypes,
+  };
+
+  LayoutSubtableCache() { }
+
+  LayoutSubtableCache(const LayoutSubtableCache&) = delete;
+  LayoutSubtableCache& operator=(const LayoutSubtableCache&) = delete;
+
+  // Whether the subtable at |data| has already been validated as |type|
+  // against |num_glyphs| and |limit| (the expected glyph count of a Coverage
+  // table, or the number of classes of a ClassDef table).
+  bool IsValid(SubtableType type, const uint8_t *data,
+               uint16_t num_glyphs, uint16_t limit);
+  void SetValid(SubtableType type, const uint8_t *data,
+                uint16_t num_glyphs, uint16_t limit);
+
+  // Counts from now on the IsValid() calls for subtables of the table |tag|,
+  // whose data is the |length| bytes at |data|, and how many returned true.
+  void BeginCounting(uint32_t tag, const uint8_t *data, size_t length);
+  // Gives the counts of the table |tag| to |observer| and stops counting.
+  void EndCounting(uint32_t tag, OTSTableObserver *observer);
+
+ private:
+  struct Key {
+    const uint8_t *data;
+    uint16_t num_glyphs;
+    uint16_t limit;
+    SubtableType type;
+
+    bool operator<(const Key& other) const {
+      if (data != other.data)
+        return data < other.data;
+      if (num_glyphs != other.num_glyphs)
+        return num_glyphs < other.num_glyphs;
+      if (limit != other.limit)
+        return limit < other.limit;
+      return type < other.type;
+    }
+  };
+
+  // The IsValid() calls for the subtables of a table being counted.
+  struct TableCounts {
+    uint32_t tag;
+    const uint8_t *data;
+    size_t length;
+    size_t lookups[kNumSubtableTypes];
+    size_t hits[kNumSubtableTypes];
+  };
+
+  std::mutex m_mutex;
+  std::set<Key> m_valid;
+  std::vector<TableCounts> m_counts;
+};
+
 struct Font {
   explicit Font(FontFile *f)
       : file(f),
@@ -305,13 +687,17 @@ struct Font {
         num_tables(0),
         search_range(0),
         entry_selector(0),
-        range_shift(0) {
+        range_shift(0),
+        failed_table(0) {
   }
 
-  bool ParseTable(const TableEntry& tableinfo, const uint8_t* data,
-                  Arena &arena);
+  bool ParseTable(const TableEntry& tableinfo, const uint8_t* data);
   Table* GetTable(uint32_t tag) const;
 
+  // Whether a table has been parsed for |tag|, without asking it whether it
+  // should be serialized, which can depend on the other tables of its font.
+  bool HasTable(uint32_t tag) const;
+
   // This checks that the returned Table is actually of the correct subclass
   // for |tag|, so it can safely be downcast to the corresponding OpenTypeXXXX;
   // if not (i.e. if the table was treated as Passthru), it will return NULL.
@@ -320,6 +706,10 @@ struct Font {
   // Insert a new table. Asserts if a table with the same tag already exists.
   void AddTable(TableEntry entry, Table* table);
 
+  // Create empty slots for the given tags, so that tables can then be added
+  // from several threads while others are being looked up.
+  void ReserveTables(const std::vector<uint32_t>& tags);
+
   // Drop all Graphite tables and don't parse new ones.
   void DropGraphite();
 
@@ -334,7 +724,15 @@ struct Font {
   uint16_t entry_selector;
   uint16_t range_shift;
 
+  // The tag of the first table found to make this font fail, if any.
+  uint32_t failed_table;
+
+  // Layout subtables already validated while parsing this font's tables.
+  mutable LayoutSubtableCache layout_subtables;
+
  private:
+  bool DoParseTable(const TableEntry& tableinfo, const uint8_t* data);
+
   std::map<uint32_t, Table*> m_tables;
 };
 
@@ -350,14 +748,77 @@ struct TableEntry {
   }
 };
 
+// What OTSContext::Plan() keeps of the fonts it has serialized, so that
+// OTSContext::Emit() can serialize them again.
+struct PlannedOutput {
+  PlannedOutput() : collection(false), deferrable(true) {
+  }
+
+  // Whether the output is a whole collection rather than a single font.
+  bool collection;
+  // Whether all the fonts were parsed before any was serialized. If not, a
+  // font may have modified a table after an earlier font serialized it, so
+  // serializing them again would not give the same result.
+  bool deferrable;
+  // The fonts in the order they are written out, with their table maps.
+  std::vector<std::pair<Font*, std::map<uint32_t, TableEntry> > > fonts;
+};
+
 struct FontFile {
+  FontFile()
+      : context(NULL),
+        allocator(NULL),
+        scratch(NULL),
+        validation(NULL),
+        plan(NULL),
+        observer(NULL),
+        subset(NULL),
+        shared_tables(NULL) {
+  }
   ~FontFile();
 
+  // Adds a font, which lives as long as the file does.
+  Font *NewFont() {
+    fonts.emplace_back(this);
+    return &fonts.back();
+  }
+
   OTSContext *context;
+  // Where decompressed fonts and tables are stored.
+  OTSAllocator *allocator;
+  // The scratch buffers of the context's session, if it has one.
+  ScratchPool *scratch;
+  // Set by OTSContext::Validate(): the tables are then checked but not
+  // serialized, and what would have been written out is counted here.
+  ValidationResult *validation;
+  // Set by OTSContext::Plan(): the fonts serialized are recorded there.
+  PlannedOutput *plan;
+  // The context's table observer, if any, and the tables it has been told
+  // about but not yet the end of, with the time their parsing took. Guarded
+  // by |tables_mutex|.
+  OTSTableObserver *observer;
+  std::map<Table*, uint64_t> observed_tables;
+  // The glyphs the context asks the fonts to keep, if not all of them.
+  const GlyphSubset *subset;
   std::map<TableEntry, Table*> tables;
   std::map<uint32_t, TableEntry> table_entries;
+  // Guards |tables| when tables are parsed concurrently.
+  std::mutex tables_mutex;
+  // Set while the fonts of a collection are being parsed concurrently.
+  SharedTables *shared_tables;
+  // The fonts of the file. A deque, so that adding one does not move the
+  // others, which their tables point to.
+  std::deque<Font> fonts;
 };
 
+template <typename T>
+void Table::TakeScratch(std::vector<T> *v) {
+  m_scratch = m_font->file->scratch;
+  if (m_scratch) {
+    m_scratch->Take(v);
+  }
+}
+
 }  // namespace ots
 
 #endif  // OTS_H_
@@ -0,0 +1,71 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "parallel.h"
+
+namespace ots {
+
+bool TaskGroup::State::RunOne() {
+  std::function<void()> task;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty())
+      return false;
+    task = queue.front();
+    queue.pop_front();
+  }
+
+  task();
+
+  bool finished;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = (--pending == 0);
+  }
+  if (finished)
+    done.notify_all();
+  return true;
+}
+
+TaskGroup::TaskGroup(OTSExecutor *executor)
+    : m_executor(executor),
+      m_state(std::make_shared<State>()) {
+}
+
+TaskGroup::~TaskGroup() {
+  Wait();
+}
+
+void TaskGroup::Run(const std::function<void()>& task) {
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->queue.push_back(task);
+    ++m_state->pending;
+  }
+  // Wake up Wait(), in case the executor is too busy to get to it soon.
+  m_state->done.notify_all();
+  if (m_executor) {
+    std::shared_ptr<State> state = m_state;
+    m_executor->Run([state]() { state->RunOne(); });
+  }
+}
+
+void TaskGroup::Wait() {
+  while (m_state->RunOne()) {
+  }
+
+  std::unique_lock<std::mutex> lock(m_state->mutex);
+  while (m_state->pending) {
+    if (!m_state->queue.empty()) {
+      // A running task added more work; help with it.
+      lock.unlock();
+      m_state->RunOne();
+      lock.lock();
+      continue;
+    }
+    m_state->done.wait(lock);
+  }
+}
+
+}  // namespace ots
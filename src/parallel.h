@@ -0,0 +1,57 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OTS_PARALLEL_H_
+#define OTS_PARALLEL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "ots.h"
+
+namespace ots {
+
+// -----------------------------------------------------------------------------
+// TaskGroup helper class
+//
+// Runs a set of tasks on an OTSExecutor and waits for all of them. Tasks may
+// add more tasks to the group while it runs. The thread calling Wait() takes
+// part in running queued tasks, so groups can be nested and still make
+// progress when the executor has no idle thread; without an executor, every
+// task simply runs on the thread calling Wait().
+// -----------------------------------------------------------------------------
+class TaskGroup {
+ public:
+  explicit TaskGroup(OTSExecutor *executor);
+  ~TaskGroup();
+
+  void Run(const std::function<void()>& task);
+  void Wait();
+
+ private:
+  struct State {
+    State() : pending(0) {}
+
+    // Runs one queued task, if there is any left. Returns false otherwise.
+    bool RunOne();
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::deque<std::function<void()> > queue;
+    // Number of tasks queued or running.
+    size_t pending;
+  };
+
+  OTSExecutor *m_executor;
+  // Shared with the jobs handed to |m_executor|, which may only get to run
+  // after Wait() has already drained the queue and returned.
+  std::shared_ptr<State> m_state;
+};
+
+}  // namespace ots
+
+#endif  // OTS_PARALLEL_H_
@@ -72,14 +72,11 @@ bool OpenTypePOST::Parse(const uint8_t *data, size_t length) {
     return Error("Bad number of glyphs: %d", num_glyphs);
   }
 
-  this->glyph_name_index.resize(num_glyphs);
-  for (unsigned i = 0; i < num_glyphs; ++i) {
-    if (!table.ReadU16(&this->glyph_name_index[i])) {
-      return Error("Failed to read glyph name %d", i);
-    }
-    // Note: A strict interpretation of the specification requires name indexes
-    // are less than 32768. This, however, excludes fonts like unifont.ttf
-    // which cover all of unicode.
+  // Note: A strict interpretation of the specification requires name indexes
+  // are less than 32768. This, however, excludes fonts like unifont.ttf
+  // which cover all of unicode.
+  if (!table.ReadU16Array(&this->glyph_name_index, num_glyphs)) {
+    return Error("Failed to read %d glyph names", num_glyphs);
   }
 
   // Now we have an array of Pascal strings. We have to check that they are all
@@ -119,6 +116,35 @@ bool OpenTypePOST::Parse(const uint8_t *data, size_t length) {
   return true;
 }
 
+void OpenTypePOST::Subset(const std::vector<bool>& glyphs) {
+  std::vector<uint16_t> &name_index = this->glyph_name_index;
+  // The new index of each of |names|, if it is still used.
+  std::vector<uint16_t> new_index(this->names.size());
+  std::vector<bool> used(this->names.size());
+  for (size_t i = 0; i < name_index.size(); ++i) {
+    if (i < glyphs.size() && !glyphs[i]) {
+      name_index[i] = 0;
+    } else if (name_index[i] >= 258) {
+      used[name_index[i] - 258] = true;
+    }
+  }
+
+  size_t num_names = 0;
+  for (size_t i = 0; i < this->names.size(); ++i) {
+    if (used[i]) {
+      new_index[i] = 258 + num_names;
+      this->names[num_names++].swap(this->names[i]);
+    }
+  }
+  this->names.resize(num_names);
+
+  for (uint16_t &index : name_index) {
+    if (index >= 258) {
+      index = new_index[index - 258];
+    }
+  }
+}
+
 bool OpenTypePOST::Serialize(OTSStream *out) {
   // OpenType with CFF glyphs must have v3 post table.
   if (GetFont()->GetTable(OTS_TAG_CFF) && this->version != 0x00030000) {
@@ -21,6 +21,10 @@ class OpenTypePOST : public Table {
   bool Parse(const uint8_t *data, size_t length);
   bool Serialize(OTSStream *out);
 
+  // Gives the glyphs not marked in |glyphs| the name .notdef, dropping the
+  // names no other glyph has.
+  void Subset(const std::vector<bool>& glyphs);
+
 private:
   uint32_t version;
   uint32_t italic_angle;
@@ -7,7 +7,6 @@
 #include "name.h"
 #include "lz4.h"
 #include <cmath>
-#include <memory>
 
 namespace ots {
 
@@ -49,17 +48,23 @@ bool OpenTypeSILF::Parse(const uint8_t* data, size_t length,
                               OTS_MAX_DECOMPRESSED_TABLE_SIZE / (1024.0 * 1024.0),
                               decompressed_size / (1024.0 * 1024.0));
         }
-        std::unique_ptr<uint8_t[]> decompressed(new uint8_t[decompressed_size]());
+        // The decompressed table is kept until the end of processing, like
+        // the decompressed tables of a WOFF font.
+        uint8_t *decompressed = static_cast<uint8_t*>(
+            GetFont()->file->allocator->Allocate(decompressed_size));
+        if (!decompressed) {
+          return DropGraphite("Failed to allocate decompressed table");
+        }
         int ret = LZ4_decompress_safe_partial(
             reinterpret_cast<const char*>(data + table.offset()),
-            reinterpret_cast<char*>(decompressed.get()),
+            reinterpret_cast<char*>(decompressed),
             table.remaining(),  // input buffer size (input size + padding)
             decompressed_size,  // target output size
             decompressed_size);  // output buffer size
         if (ret < 0 || unsigned(ret) != decompressed_size) {
           return DropGraphite("Decompression failed with error code %d", ret);
         }
-        return this->Parse(decompressed.get(), decompressed_size, true);
+        return this->Parse(decompressed, decompressed_size, true);
       }
       default:
         return DropGraphite("Unknown compression scheme");
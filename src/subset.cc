@@ -0,0 +1,72 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "subset.h"
+
+#include <vector>
+
+#include "cff.h"
+#include "cmap.h"
+#include "glyf.h"
+#include "maxp.h"
+#include "post.h"
+
+namespace ots {
+
+bool SubsetFont(Font *font, const GlyphSubset& subset) {
+  OpenTypeMAXP *maxp = static_cast<OpenTypeMAXP*>(
+      font->GetTypedTable(OTS_TAG_MAXP));
+  if (!maxp) {
+    return OTS_FAILURE();
+  }
+  const unsigned num_glyphs = maxp->num_glyphs;
+
+  // The glyphs to keep, by glyph id.
+  std::vector<bool> glyphs(num_glyphs);
+  if (num_glyphs) {
+    glyphs[0] = true;
+  }
+  for (uint32_t gid : subset.glyph_ids) {
+    if (gid < num_glyphs) {
+      glyphs[gid] = true;
+    }
+  }
+
+  OpenTypeCMAP *cmap = static_cast<OpenTypeCMAP*>(
+      font->GetTypedTable(OTS_TAG_CMAP));
+  if (cmap) {
+    cmap->MapCodePoints(subset.code_points, &glyphs);
+  }
+
+  OpenTypeGLYF *glyf = static_cast<OpenTypeGLYF*>(
+      font->GetTypedTable(OTS_TAG_GLYF));
+  if (glyf && (!glyf->AddComponents(&glyphs) || !glyf->Subset(glyphs))) {
+    return OTS_FAILURE();
+  }
+
+  OpenTypeCFF *cff = static_cast<OpenTypeCFF*>(
+      font->GetTypedTable(OTS_TAG_CFF));
+  if (cff && !cff->Subset(glyphs)) {
+    return OTS_FAILURE();
+  }
+  OpenTypeCFF2 *cff2 = static_cast<OpenTypeCFF2*>(
+      font->GetTypedTable(OTS_TAG_CFF2));
+  if (cff2 && !cff2->Subset(glyphs)) {
+    return OTS_FAILURE();
+  }
+
+  if (cmap && !cmap->Subset(glyphs)) {
+    return OTS_FAILURE();
+  }
+
+  OpenTypePOST *post = static_cast<OpenTypePOST*>(
+      font->GetTypedTable(OTS_TAG_POST));
+  if (post) {
+    post->Subset(glyphs);
+  }
+
+  return true;
+}
+
+}  // namespace ots
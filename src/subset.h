@@ -0,0 +1,19 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OTS_SUBSET_H_
+#define OTS_SUBSET_H_
+
+#include "ots.h"
+
+namespace ots {
+
+// Removes from the parsed tables of |font| the glyphs |subset| does not ask
+// for, keeping the ids of the others: glyf/loca, CFF and CFF2 charstrings,
+// cmap and post. Returns false if one of them could not be subset.
+bool SubsetFont(Font *font, const GlyphSubset& subset);
+
+}  // namespace ots
+
+#endif  // OTS_SUBSET_H_
@@ -17,9 +17,8 @@ bool OpenTypeVDMX::Parse(const uint8_t *data, size_t length) {
   Buffer table(data, length);
   ots::Font* font = this->GetFont();
 
-  if (!table.ReadU16(&this->version) ||
-      !table.ReadU16(&this->num_recs) ||
-      !table.ReadU16(&this->num_ratios)) {
+  if (!table.ReadRecord<Record<uint16_t, uint16_t, uint16_t> >(
+          &this->version, &this->num_recs, &this->num_ratios)) {
     return Drop("Failed to read table header");
   }
 
@@ -27,16 +26,16 @@ bool OpenTypeVDMX::Parse(const uint8_t *data, size_t length) {
     return Drop("Unsupported table version: %u", this->version);
   }
 
+  typedef Record<uint8_t, uint8_t, uint8_t, uint8_t> RatioRange;
+  BufferCursor ratios;
+  if (!table.ReserveRecords<RatioRange>(this->num_ratios, &ratios)) {
+    return Drop("Failed to read RatioRange records");
+  }
   this->rat_ranges.reserve(this->num_ratios);
   for (unsigned i = 0; i < this->num_ratios; ++i) {
     OpenTypeVDMXRatioRecord rec;
-
-    if (!table.ReadU8(&rec.charset) ||
-        !table.ReadU8(&rec.x_ratio) ||
-        !table.ReadU8(&rec.y_start_ratio) ||
-        !table.ReadU8(&rec.y_end_ratio)) {
-      return Drop("Failed to read RatioRange record %d", i);
-    }
+    ratios.Read<RatioRange>(&rec.charset, &rec.x_ratio, &rec.y_start_ratio,
+                            &rec.y_end_ratio);
 
     if (rec.charset > 1) {
       return Drop("Unsupported character set: %u", rec.charset);
@@ -61,13 +60,15 @@ bool OpenTypeVDMX::Parse(const uint8_t *data, size_t length) {
 
   this->offsets.reserve(this->num_ratios);
   const size_t current_offset = table.offset();
+  BufferCursor ratio_offsets;
+  if (!table.ReserveRecords<Record<uint16_t> >(this->num_ratios,
+                                               &ratio_offsets)) {
+    return Drop("Failed to read ratio offsets");
+  }
   std::set<uint16_t> unique_offsets;
   // current_offset is less than (2 bytes * 3) + (4 bytes * USHRT_MAX) = 256k.
   for (unsigned i = 0; i < this->num_ratios; ++i) {
-    uint16_t offset;
-    if (!table.ReadU16(&offset)) {
-      return Drop("Failed to read ratio offset %d", i);
-    }
+    const uint16_t offset = ratio_offsets.ReadU16();
     if (current_offset + offset >= length) {  // thus doesn't overflow.
       return Drop("Bad ratio offset %d for ration %d", offset, i);
     }
@@ -88,19 +89,19 @@ bool OpenTypeVDMX::Parse(const uint8_t *data, size_t length) {
   this->groups.reserve(this->num_recs);
   for (unsigned i = 0; i < this->num_recs; ++i) {
     OpenTypeVDMXGroup group;
-    if (!table.ReadU16(&group.recs) ||
-        !table.ReadU8(&group.startsz) ||
-        !table.ReadU8(&group.endsz)) {
+    if (!table.ReadRecord<Record<uint16_t, uint8_t, uint8_t> >(
+            &group.recs, &group.startsz, &group.endsz)) {
       return Drop("Failed to read record header %d", i);
     }
+    typedef Record<uint16_t, int16_t, int16_t> VTable;
+    BufferCursor vtables;
+    if (!table.ReserveRecords<VTable>(group.recs, &vtables)) {
+      return Drop("Failed to read records of group %d", i);
+    }
     group.entries.reserve(group.recs);
     for (unsigned j = 0; j < group.recs; ++j) {
       OpenTypeVDMXVTable vt;
-      if (!table.ReadU16(&vt.y_pel_height) ||
-          !table.ReadS16(&vt.y_max) ||
-          !table.ReadS16(&vt.y_min)) {
-        return Drop("Failed to read record %d group %d", i, j);
-      }
+      vtables.Read<VTable>(&vt.y_pel_height, &vt.y_max, &vt.y_min);
       if (vt.y_max < vt.y_min) {
         return Drop("bad y min/max");
       }
@@ -0,0 +1,172 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that the allocator returned by OTSContext::GetAllocator() is used
+// for decompressed tables, and released once processing is done, and that a
+// session reusing memory between fonts does not change the output.
+
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+#include "test_util.h"
+
+namespace {
+
+using ots_test::ReadTestFont;
+
+// A WOFF 1.0 font with zlib compressed tables.
+const char kWOFFFont[] = "good/1232d0423fe3bb731faa3da008281ca030d3fe0a.woff";
+
+// Fonts of each kind, for the session to go back and forth between.
+const char* const kSessionFonts[] = {
+  kWOFFFont,
+  "good/171ec9ef597e59a0f33cdeae1d4cf43af1d255ce.otf",
+  "good/db4b768546934de921667761967706f4f527a75a.ttf",
+  "good/6c26e8ccc29afe595364bf649455d10dc0e39861.ttf",
+};
+
+class CountingAllocator : public ots::OTSAllocator {
+ public:
+  explicit CountingAllocator(bool fail = false) : fail_(fail) {}
+  ~CountingAllocator() { Release(); }
+
+  void* Allocate(size_t length) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_allocations_;
+    if (fail_)
+      return NULL;
+    void* p = std::malloc(length);
+    live_.push_back(p);
+    return p;
+  }
+
+  void Release() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_releases_;
+    for (void* p : live_)
+      std::free(p);
+    live_.clear();
+  }
+
+  size_t num_allocations() const { return num_allocations_; }
+  size_t num_releases() const { return num_releases_; }
+  size_t num_live() const { return live_.size(); }
+
+ private:
+  const bool fail_;
+  std::mutex mutex_;
+  std::vector<void*> live_;
+  size_t num_allocations_ = 0;
+  size_t num_releases_ = 0;
+};
+
+class AllocatorContext : public ots::OTSContext {
+ public:
+  explicit AllocatorContext(ots::OTSAllocator* allocator,
+                            ots::OTSSession* session = NULL)
+      : allocator_(allocator), session_(session) {}
+  void Message(int, const char*, ...) override {}
+  ots::OTSAllocator* GetAllocator() override { return allocator_; }
+  ots::OTSSession* GetSession() override { return session_; }
+
+ private:
+  ots::OTSAllocator* allocator_;
+  ots::OTSSession* session_;
+};
+
+bool Sanitize(ots::OTSContext& context, const std::string& font_data,
+              std::string* output) {
+  ots::ExpandingMemoryStream stream(font_data.size() + 1,
+                                    font_data.size() * 8 + 1);
+  const bool ok = context.Process(
+      &stream, reinterpret_cast<const uint8_t*>(font_data.data()),
+      font_data.size());
+  output->assign(static_cast<const char*>(stream.get()), stream.Tell());
+  return ok;
+}
+
+}  // namespace
+
+TEST(AllocatorTest, CustomAllocatorIsUsedAndReleased) {
+  const std::string font_data = ReadTestFont(kWOFFFont);
+  ASSERT_FALSE(font_data.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  AllocatorContext default_context(NULL);
+  std::string expected;
+  ASSERT_TRUE(Sanitize(default_context, font_data, &expected));
+
+  CountingAllocator allocator;
+  AllocatorContext context(&allocator);
+  std::string output;
+  ASSERT_TRUE(Sanitize(context, font_data, &output));
+  EXPECT_EQ(expected, output);
+  EXPECT_GT(allocator.num_allocations(), 0u);
+  EXPECT_EQ(1u, allocator.num_releases());
+  EXPECT_EQ(0u, allocator.num_live());
+}
+
+TEST(AllocatorTest, AllocationFailure) {
+  const std::string font_data = ReadTestFont(kWOFFFont);
+  ASSERT_FALSE(font_data.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  CountingAllocator allocator(true);
+  AllocatorContext context(&allocator);
+  std::string output;
+  EXPECT_FALSE(Sanitize(context, font_data, &output));
+  EXPECT_GT(allocator.num_allocations(), 0u);
+  EXPECT_EQ(1u, allocator.num_releases());
+}
+
+TEST(SessionTest, SameOutput) {
+  std::vector<std::string> fonts;
+  std::vector<std::string> expected;
+  for (const char* name : kSessionFonts) {
+    fonts.push_back(ReadTestFont(name));
+    ASSERT_FALSE(fonts.back().empty()) << "OTS_TEST_FONTS environment variable not set";
+    AllocatorContext context(NULL);
+    expected.push_back("");
+    ASSERT_TRUE(Sanitize(context, fonts.back(), &expected.back())) << name;
+  }
+
+  ots::OTSSession session;
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < fonts.size(); ++i) {
+      AllocatorContext context(NULL, &session);
+      std::string output;
+      ASSERT_TRUE(Sanitize(context, fonts[i], &output)) << kSessionFonts[i];
+      EXPECT_EQ(expected[i], output) << kSessionFonts[i];
+    }
+    if (round == 1) {
+      session.Reset();
+    }
+  }
+}
+
+TEST(SessionTest, WithAllocator) {
+  const std::string font_data = ReadTestFont(kWOFFFont);
+  ASSERT_FALSE(font_data.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  AllocatorContext default_context(NULL);
+  std::string expected;
+  ASSERT_TRUE(Sanitize(default_context, font_data, &expected));
+
+  // The context's allocator is still used for the decompressed tables.
+  CountingAllocator allocator;
+  ots::OTSSession session;
+  for (int i = 0; i < 2; ++i) {
+    AllocatorContext context(&allocator, &session);
+    std::string output;
+    ASSERT_TRUE(Sanitize(context, font_data, &output));
+    EXPECT_EQ(expected, output);
+  }
+  EXPECT_GT(allocator.num_allocations(), 0u);
+  EXPECT_EQ(2u, allocator.num_releases());
+  EXPECT_EQ(0u, allocator.num_live());
+}
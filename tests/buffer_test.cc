@@ -0,0 +1,150 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks the readers of ots::Buffer that check the bounds of many values at
+// once: the array readers, Reserve(), the records and the order checks.
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ots.h"
+
+namespace {
+
+const uint8_t kData[] = {
+  0x01, 0x02, 0x83, 0x04, 0x05, 0x06, 0x07, 0x08,
+  0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10,
+  0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+};
+
+}  // namespace
+
+TEST(BufferTest, ReadU16Array) {
+  ots::Buffer buffer(kData, sizeof(kData));
+  std::vector<uint16_t> values;
+  ASSERT_TRUE(buffer.ReadU16Array(&values, 11));
+  ASSERT_EQ(11u, values.size());
+  EXPECT_EQ(0x0102, values[0]);
+  EXPECT_EQ(0x8304, values[1]);
+  EXPECT_EQ(0x1516, values[10]);
+  EXPECT_EQ(22u, buffer.offset());
+
+  EXPECT_FALSE(buffer.ReadU16Array(&values, 2));
+  EXPECT_EQ(11u, values.size());
+  EXPECT_EQ(22u, buffer.offset());
+}
+
+TEST(BufferTest, ReadWideningU16Array) {
+  ots::Buffer buffer(kData, sizeof(kData));
+  uint32_t values[12];
+  ASSERT_TRUE(buffer.ReadU16Array(values, 12));
+  EXPECT_EQ(0x8304u, values[1]);
+  EXPECT_EQ(0x1718u, values[11]);
+  EXPECT_FALSE(buffer.ReadU16Array(values, 1));
+}
+
+TEST(BufferTest, ReadU32Array) {
+  ots::Buffer buffer(kData, sizeof(kData));
+  ASSERT_TRUE(buffer.Skip(4));
+  std::vector<uint32_t> values;
+  ASSERT_TRUE(buffer.ReadU32Array(&values, 5));
+  EXPECT_EQ(0x05060708u, values[0]);
+  EXPECT_EQ(0x15161718u, values[4]);
+
+  ots::Buffer huge(kData, sizeof(kData));
+  EXPECT_FALSE(huge.ReadU32Array(&values, static_cast<size_t>(-1) / 2));
+  EXPECT_EQ(0u, huge.offset());
+}
+
+TEST(BufferTest, ReadRecord) {
+  ots::Buffer buffer(kData, sizeof(kData));
+  uint16_t a = 0;
+  int16_t b = 0;
+  uint32_t c = 0;
+  uint8_t d = 0;
+  ASSERT_TRUE((buffer.ReadRecord<ots::Record<uint16_t, int16_t, ots::Uint24,
+                                             uint8_t> >(&a, &b, &c, &d)));
+  EXPECT_EQ(0x0102, a);
+  EXPECT_EQ(static_cast<int16_t>(0x8304), b);
+  EXPECT_EQ(0x050607u, c);
+  EXPECT_EQ(0x08, d);
+  EXPECT_EQ(8u, buffer.offset());
+
+  typedef ots::Record<uint32_t, uint32_t, uint32_t, uint32_t, uint32_t>
+      TwentyBytes;
+  EXPECT_EQ(20u, TwentyBytes::kSize);
+  EXPECT_FALSE(buffer.ReadRecord<TwentyBytes>(&c, &c, &c, &c, &c));
+  EXPECT_EQ(8u, buffer.offset());
+}
+
+TEST(BufferTest, ReserveRecords) {
+  ots::Buffer buffer(kData, sizeof(kData));
+  typedef ots::Record<uint16_t, uint16_t, int16_t> Pair;
+
+  ots::BufferCursor cursor;
+  EXPECT_FALSE(buffer.ReserveRecords<Pair>(5, &cursor));
+  EXPECT_EQ(0u, buffer.offset());
+  ASSERT_TRUE(buffer.ReserveRecords<Pair>(4, &cursor));
+  EXPECT_EQ(24u, buffer.offset());
+
+  uint16_t left = 0, right = 0;
+  int16_t value = 0;
+  cursor.Read<Pair>(&left, &right, &value);
+  EXPECT_EQ(0x0102, left);
+  EXPECT_EQ(0x8304, right);
+  EXPECT_EQ(0x0506, value);
+  cursor.Skip(2 * Pair::kSize);
+  EXPECT_EQ(0x1314, cursor.ReadU16());
+  EXPECT_EQ(0x15161718u, cursor.ReadU32());
+}
+
+TEST(BufferTest, Reserve) {
+  ots::Buffer buffer(kData, sizeof(kData));
+  ots::BufferCursor cursor;
+  ASSERT_TRUE(buffer.Skip(20));
+  EXPECT_FALSE(buffer.Reserve(5, &cursor));
+  EXPECT_FALSE(buffer.Reserve(static_cast<size_t>(-1), &cursor));
+  ASSERT_TRUE(buffer.Reserve(4, &cursor));
+  EXPECT_EQ(0x15, cursor.ReadU8());
+  EXPECT_EQ(0x16, cursor.ReadU8());
+  EXPECT_EQ(0x1718, cursor.ReadS16());
+  EXPECT_TRUE(buffer.Reserve(0, &cursor));
+}
+
+TEST(BufferTest, IsNondecreasingBigEndian) {
+  // Long enough for several vectors and a tail, with equal values, a carry
+  // into the high byte and, for the 32-bit values, one above 2^31.
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 37; ++i)
+    values.push_back(i < 20 ? i / 2 * 0x7f : 0x80000000u + i);
+  std::vector<uint8_t> u16, u32;
+  for (uint32_t value : values) {
+    u16.push_back(value >> 8);
+    u16.push_back(value);
+    for (int shift = 24; shift >= 0; shift -= 8)
+      u32.push_back(value >> shift);
+  }
+  const size_t num_u16 = 20;
+  EXPECT_TRUE(ots::IsNondecreasingBigEndianU16(u16.data(), num_u16));
+  EXPECT_TRUE(ots::IsNondecreasingBigEndianU32(u32.data(), values.size()));
+  EXPECT_TRUE(ots::IsNondecreasingBigEndianU16(u16.data(), 0));
+  EXPECT_TRUE(ots::IsNondecreasingBigEndianU32(u32.data(), 1));
+
+  // A value larger than the next one is found wherever it is.
+  for (size_t i = 0; i + 1 < values.size(); ++i) {
+    std::vector<uint8_t> bad = u32;
+    bad[i * 4 + 3] = 0xff;
+    bad[i * 4 + 2] = 0xff;
+    bad[i * 4] |= 0x80;
+    if (i + 1 < num_u16) {
+      std::vector<uint8_t> bad16 = u16;
+      bad16[i * 2] = 0xff;
+      EXPECT_FALSE(ots::IsNondecreasingBigEndianU16(bad16.data(), num_u16))
+          << i;
+    }
+    EXPECT_FALSE(ots::IsNondecreasingBigEndianU32(bad.data(), values.size()))
+        << i;
+  }
+}
@@ -7,9 +7,15 @@
 #include <gtest/gtest.h>
 
 #include <climits>
+#include <cstdarg>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include "cff.h"
+#include "ots-thread-pool.h"
 
 // Returns a biased number for callsubr and callgsubr operators.
 #define GET_SUBR_NUMBER(n) ((n) - 107)
@@ -88,11 +94,20 @@ bool EncodeNumber(int num, std::vector<uint8_t> *out_bytes) {
   return false;
 }
 
+// Appends |offset| to the offset array |out_offsets| of an INDEX.
+void AddOffset(size_t offset, std::vector<uint8_t>* out_offsets) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out_offsets->push_back(static_cast<uint8_t>(offset >> shift));
+  }
+}
+
 // Adds a subroutine |subr| to |out_buffer| and |out_subr|. The contents of the
 // subroutine is copied to |out_buffer|, and then the position of the subroutine
-// in |out_buffer| is written to |out_subr|. Returns true on success.
+// in |out_buffer| is written to |out_offsets|, the offset array of |out_subr|.
+// Returns true on success.
 bool AddSubr(const int *subr, size_t subr_len,
-             std::vector<uint8_t>* out_buffer, ots::CFFIndex *out_subr) {
+             std::vector<uint8_t>* out_buffer,
+             std::vector<uint8_t>* out_offsets, ots::CFFIndex *out_subr) {
   size_t pre_offset = out_buffer->size();
   for (size_t i = 0; i < subr_len; ++i) {
     if (subr[i] != kOpPrefix) {
@@ -110,12 +125,14 @@ bool AddSubr(const int *subr, size_t subr_len,
     }
   }
 
-  ++(out_subr->count);
-  out_subr->off_size = 1;
-  if (out_subr->offsets.empty()) {
-    out_subr->offsets.push_back(pre_offset);
+  if (out_offsets->empty()) {
+    AddOffset(pre_offset, out_offsets);
   }
-  out_subr->offsets.push_back(out_buffer->size());
+  AddOffset(out_buffer->size(), out_offsets);
+  ++(out_subr->count);
+  out_subr->off_size = 4;
+  out_subr->offset_array = out_offsets->data();
+  out_subr->base_offset = 0;
   return true;
 }
 
@@ -124,25 +141,28 @@ bool Validate(const int *char_string, size_t char_string_len,
               const int *global_subrs, size_t global_subrs_len,
               const int *local_subrs, size_t local_subrs_len) {
   std::vector<uint8_t> buffer;
+  std::vector<uint8_t> char_strings_offsets;
+  std::vector<uint8_t> global_subrs_offsets;
+  std::vector<uint8_t> local_subrs_offsets;
   ots::CFFIndex* char_strings_index = new ots::CFFIndex;
   ots::CFFIndex global_subrs_index;
   ots::CFFIndex* local_subrs_index = new ots::CFFIndex;
 
   if (char_string) {
     if (!AddSubr(char_string, char_string_len,
-                 &buffer, char_strings_index)) {
+                 &buffer, &char_strings_offsets, char_strings_index)) {
       return false;
     }
   }
   if (global_subrs) {
     if (!AddSubr(global_subrs, global_subrs_len,
-                 &buffer, &global_subrs_index)) {
+                 &buffer, &global_subrs_offsets, &global_subrs_index)) {
       return false;
     }
   }
   if (local_subrs) {
     if (!AddSubr(local_subrs, local_subrs_len,
-                 &buffer, local_subrs_index)) {
+                 &buffer, &local_subrs_offsets, local_subrs_index)) {
       return false;
     }
   }
@@ -1559,6 +1579,82 @@ TEST(ValidateTest, TestInfiniteLoop) {
   }
 }
 
+TEST(ValidateTest, TestRepeatedSubrCalls) {
+  // The same subr is valid with some arguments but not with others.
+  {
+    const int char_string[] = {
+      1, 2, kOpPrefix, ots::kRMoveTo,
+      1, 2, GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+      3, 4, GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+      kOpPrefix, ots::kEndChar,
+    };
+    const int local_subrs[] = {
+      kOpPrefix, ots::kRLineTo,
+      kOpPrefix, ots::kReturn,
+    };
+    EXPECT_TRUE(Validate(char_string, ARRAYSIZE(char_string),
+                         NULL, 0,
+                         local_subrs, ARRAYSIZE(local_subrs)));
+  }
+  {
+    const int char_string[] = {
+      1, 2, kOpPrefix, ots::kRMoveTo,
+      1, 2, GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+      1, 2, 3, GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+      kOpPrefix, ots::kEndChar,
+    };
+    const int local_subrs[] = {
+      kOpPrefix, ots::kRLineTo,
+      kOpPrefix, ots::kReturn,
+    };
+    EXPECT_FALSE(Validate(char_string, ARRAYSIZE(char_string),
+                          NULL, 0,
+                          local_subrs, ARRAYSIZE(local_subrs)));
+  }
+  // A global subr calling the local subr it is passed: the second call is
+  // to an undefined subr.
+  {
+    const int char_string[] = {
+      1, 2, kOpPrefix, ots::kRMoveTo,
+      GET_SUBR_NUMBER(0), GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallGSubr,
+      GET_SUBR_NUMBER(1), GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallGSubr,
+      kOpPrefix, ots::kEndChar,
+    };
+    const int global_subrs[] = {
+      kOpPrefix, ots::kCallSubr,
+      kOpPrefix, ots::kReturn,
+    };
+    const int local_subrs[] = {
+      kOpPrefix, ots::kReturn,
+    };
+    EXPECT_FALSE(Validate(char_string, ARRAYSIZE(char_string),
+                          global_subrs, ARRAYSIZE(global_subrs),
+                          local_subrs, ARRAYSIZE(local_subrs)));
+  }
+  // Likewise, with a subr that leaves its arguments on the stack for the next
+  // subr to use.
+  {
+    const int char_string[] = {
+      1, 2, kOpPrefix, ots::kRMoveTo,
+      GET_SUBR_NUMBER(0), GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+      GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallGSubr,
+      GET_SUBR_NUMBER(1), GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+      GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallGSubr,
+      kOpPrefix, ots::kEndChar,
+    };
+    const int global_subrs[] = {
+      kOpPrefix, ots::kCallSubr,
+      kOpPrefix, ots::kReturn,
+    };
+    const int local_subrs[] = {
+      kOpPrefix, ots::kReturn,
+    };
+    EXPECT_FALSE(Validate(char_string, ARRAYSIZE(char_string),
+                          global_subrs, ARRAYSIZE(global_subrs),
+                          local_subrs, ARRAYSIZE(local_subrs)));
+  }
+}
+
 TEST(ValidateTest, TestStackOverflow) {
   {
     const int char_string[] = {
@@ -1629,3 +1725,256 @@ TEST(ValidateTest, TestUnterminatedCharString) {
     EXPECT_FALSE(ValidateCharStrings(char_string, ARRAYSIZE(char_string)));
   }
 }
+
+namespace {
+
+// Keeps the messages about the font, and runs the validation of large fonts
+// on |executor|.
+class MessagesContext : public ots::OTSContext {
+ public:
+  explicit MessagesContext(ots::OTSExecutor *executor)
+      : executor_(executor) {}
+
+  void Message(int, const char *format, ...) override {
+    char message[256];
+    va_list va;
+    va_start(va, format);
+    std::vsnprintf(message, sizeof(message), format, va);
+    va_end(va);
+    std::lock_guard<std::mutex> lock(mutex_);
+    messages_.push_back(message);
+  }
+
+  ots::OTSExecutor *GetExecutor() override { return executor_; }
+
+  const std::vector<std::string>& messages() const { return messages_; }
+
+ private:
+  ots::OTSExecutor *executor_;
+  std::mutex mutex_;
+  std::vector<std::string> messages_;
+};
+
+// Validates |num_glyphs| charstrings, all valid but those of the glyphs in
+// |undefined_operators|, which use the given undefined operator.
+bool ValidateGlyphs(ots::OTSContext *context, unsigned num_glyphs,
+                    const std::map<unsigned, int>& undefined_operators) {
+  std::vector<uint8_t> buffer;
+  std::vector<uint8_t> char_strings_offsets;
+  ots::CFFIndex* char_strings_index = new ots::CFFIndex;
+  ots::CFFIndex global_subrs_index;
+  for (unsigned i = 0; i < num_glyphs; ++i) {
+    auto it = undefined_operators.find(i);
+    const int char_string[] = {
+      1, 2, kOpPrefix, ots::kRMoveTo,
+      kOpPrefix, it == undefined_operators.end() ? ots::kEndChar : it->second,
+    };
+    if (!AddSubr(char_string, ARRAYSIZE(char_string),
+                 &buffer, &char_strings_offsets, char_strings_index)) {
+      delete char_strings_index;
+      return false;
+    }
+  }
+
+  ots::Buffer ots_buffer(&buffer[0], buffer.size());
+
+  ots::FontFile file;
+  file.context = context;
+  ots::Font font(&file);
+  ots::OpenTypeCFF cff(&font, OTS_TAG_CFF);
+  cff.charstrings_index = char_strings_index;
+  return ots::ValidateCFFCharStrings(cff, global_subrs_index, &ots_buffer);
+}
+
+}  // namespace
+
+TEST(ValidateTest, TestGlyphRanges) {
+  ots::ThreadPool pool(4);
+  for (ots::OTSExecutor *executor : {static_cast<ots::OTSExecutor*>(NULL),
+                                     static_cast<ots::OTSExecutor*>(&pool)}) {
+    {
+      MessagesContext context(executor);
+      EXPECT_TRUE(ValidateGlyphs(&context, 5000, {}));
+      EXPECT_TRUE(context.messages().empty());
+    }
+    {
+      // Only the first glyph that fails is told about, even when a later
+      // range of glyphs fails first.
+      MessagesContext context(executor);
+      EXPECT_FALSE(ValidateGlyphs(&context, 5000, {{2100, 2}, {4000, 0}}));
+      EXPECT_EQ(std::vector<std::string>{"CFF: Undefined operator: 2 (0x2)"},
+                context.messages());
+    }
+  }
+}
+
+namespace {
+
+typedef std::vector<int> CharString;
+
+// Keeps the counters of the tables it is told about.
+class CountersObserver : public ots::OTSTableObserver {
+ public:
+  void OnTableBegin(uint32_t, size_t) override {}
+  void OnTableEnd(uint32_t, bool, size_t, uint64_t, uint64_t) override {}
+  void OnTableCounter(uint32_t, const char *name, uint64_t value) override {
+    counters_[name] = value;
+  }
+
+  const std::map<std::string, uint64_t>& counters() const { return counters_; }
+
+ private:
+  std::map<std::string, uint64_t> counters_;
+};
+
+// Validates |glyphs|, the |i|-th of which uses the local subroutines of font
+// DICT |fd_select[i]|, one of |local_subrs|. The global subroutines, and the
+// local ones of any font DICT but the first, are those of the first font DICT
+// (the same bytes of the table, in another INDEX) when they are empty.
+bool ValidateFontDicts(const std::vector<CharString>& glyphs,
+                       const std::vector<uint16_t>& fd_select,
+                       const std::vector<CharString>& global_subrs,
+                       const std::vector<std::vector<CharString> >& local_subrs,
+                       CountersObserver *observer) {
+  ots::OTSContext context;
+  ots::FontFile file;
+  file.context = &context;
+  file.observer = observer;
+  ots::Font font(&file);
+  ots::OpenTypeCFF cff(&font, OTS_TAG_CFF);
+  cff.charstrings_index = new ots::CFFIndex;
+  cff.fd_select = fd_select;
+  for (size_t i = 0; i < local_subrs.size(); ++i) {
+    cff.local_subrs_per_font.push_back(new ots::CFFIndex);
+  }
+
+  std::vector<uint8_t> buffer;
+  std::vector<std::vector<uint8_t> > offsets(local_subrs.size() + 2);
+  for (const CharString& glyph : glyphs) {
+    if (!AddSubr(glyph.data(), glyph.size(), &buffer, &offsets[0],
+                 cff.charstrings_index)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < local_subrs.size(); ++i) {
+    for (const CharString& subr : local_subrs[i]) {
+      if (!AddSubr(subr.data(), subr.size(), &buffer, &offsets[i + 2],
+                   cff.local_subrs_per_font[i])) {
+        return false;
+      }
+    }
+    if (local_subrs[i].empty()) {
+      *cff.local_subrs_per_font[i] = *cff.local_subrs_per_font[0];
+    }
+  }
+  ots::CFFIndex global_subrs_index;
+  for (const CharString& subr : global_subrs) {
+    if (!AddSubr(subr.data(), subr.size(), &buffer, &offsets[1],
+                 &global_subrs_index)) {
+      return false;
+    }
+  }
+  if (global_subrs.empty()) {
+    global_subrs_index = *cff.local_subrs_per_font[0];
+  }
+
+  ots::Buffer ots_buffer(&buffer[0], buffer.size());
+  return ots::ValidateCFFCharStrings(cff, global_subrs_index, &ots_buffer);
+}
+
+}  // namespace
+
+TEST(ValidateTest, TestSharedSubrs) {
+  const CharString call_subr = {
+    GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+    kOpPrefix, ots::kEndChar,
+  };
+  const CharString call_gsubr = {
+    GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallGSubr,
+    kOpPrefix, ots::kEndChar,
+  };
+  const CharString subr = {
+    1, 2, kOpPrefix, ots::kRMoveTo,
+    kOpPrefix, ots::kReturn,
+  };
+
+  // The subroutine is validated once, whichever INDEX it is called through.
+  CountersObserver observer;
+  EXPECT_TRUE(ValidateFontDicts({call_subr, call_subr, call_gsubr}, {0, 1, 0},
+                                {}, {{subr}, {}}, &observer));
+  const std::map<std::string, uint64_t> counters = {
+    {"subr_calls_validated", 1},
+    {"subr_calls_reused", 2},
+    {"subr_calls_shared", 2},
+  };
+  EXPECT_EQ(counters, observer.counters());
+}
+
+TEST(ValidateTest, TestSharedSubrsCallingLocalSubrs) {
+  const CharString call_gsubr = {
+    GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallGSubr,
+    kOpPrefix, ots::kEndChar,
+  };
+  const CharString global_subr = {
+    GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr,
+    kOpPrefix, ots::kReturn,
+  };
+  const CharString local_subr = {
+    1, 2, kOpPrefix, ots::kRMoveTo,
+    kOpPrefix, ots::kReturn,
+  };
+  const CharString invalid_local_subr = {
+    kOpPrefix, (12 << 8) + 13,  // 'load'.
+    kOpPrefix, ots::kReturn,
+  };
+
+  // A global subroutine calling a local one is not valid for the glyphs of
+  // another font DICT just because it is for those of the first...
+  EXPECT_FALSE(ValidateFontDicts({call_gsubr, call_gsubr}, {0, 1},
+                                 {global_subr},
+                                 {{local_subr}, {invalid_local_subr}}, NULL));
+  // ...unless the local subroutines of both are the same.
+  CountersObserver observer;
+  EXPECT_TRUE(ValidateFontDicts({call_gsubr, call_gsubr}, {0, 1},
+                                {global_subr}, {{local_subr}, {}}, &observer));
+  EXPECT_EQ(2u, observer.counters().at("subr_calls_validated"));
+  EXPECT_EQ(1u, observer.counters().at("subr_calls_reused"));
+  EXPECT_EQ(0u, observer.counters().at("subr_calls_shared"));
+}
+
+TEST(ValidateTest, TestSeacGlyphs) {
+  const CharString seac_subr = {
+    0, 10, 65, 97, kOpPrefix, ots::kEndChar,
+  };
+  const std::vector<CharString> glyphs = {
+    {kOpPrefix, ots::kEndChar},
+    {0, 10, 65, 97, kOpPrefix, ots::kEndChar},
+    {500, 0, 10, 65, 97, kOpPrefix, ots::kEndChar},  // with a width.
+    {500, kOpPrefix, ots::kEndChar},
+    {GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr},
+    // The same call again, whose effect is reused.
+    {GET_SUBR_NUMBER(0), kOpPrefix, ots::kCallSubr},
+  };
+
+  ots::OTSContext context;
+  ots::FontFile file;
+  file.context = &context;
+  ots::Font font(&file);
+  ots::OpenTypeCFF cff(&font, OTS_TAG_CFF);
+  cff.charstrings_index = new ots::CFFIndex;
+  cff.local_subrs = new ots::CFFIndex;
+  std::vector<uint8_t> buffer;
+  std::vector<uint8_t> char_strings_offsets, local_subrs_offsets;
+  for (const CharString& glyph : glyphs) {
+    ASSERT_TRUE(AddSubr(glyph.data(), glyph.size(), &buffer,
+                        &char_strings_offsets, cff.charstrings_index));
+  }
+  ASSERT_TRUE(AddSubr(seac_subr.data(), seac_subr.size(), &buffer,
+                      &local_subrs_offsets, cff.local_subrs));
+
+  ots::CFFIndex global_subrs_index;
+  ots::Buffer ots_buffer(&buffer[0], buffer.size());
+  ASSERT_TRUE(ots::ValidateCFFCharStrings(cff, global_subrs_index,
+                                          &ots_buffer));
+  EXPECT_EQ((std::vector<uint16_t>{1, 2, 4, 5}), cff.seac_glyphs);
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that the layout subtables already found valid are looked up in the
+// font's LayoutSubtableCache only when that is safe, and that the lookups are
+// counted for the table they belong to.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gdef.h"
+#include "layout.h"
+
+namespace {
+
+const uint16_t kNumGlyphs = 100;
+
+// Keeps the counters of the tables it is told about.
+class CountersObserver : public ots::OTSTableObserver {
+ public:
+  void OnTableBegin(uint32_t, size_t) override {}
+  void OnTableEnd(uint32_t, bool, size_t, uint64_t, uint64_t) override {}
+  void OnTableCounter(uint32_t tag, const char *name, uint64_t value) override {
+    counters_[tag][name] = value;
+  }
+
+  const std::map<uint32_t, std::map<std::string, uint64_t> >& counters() const {
+    return counters_;
+  }
+
+ private:
+  std::map<uint32_t, std::map<std::string, uint64_t> > counters_;
+};
+
+void AppendU16(std::vector<uint8_t> *data, uint16_t value) {
+  data->push_back(value >> 8);
+  data->push_back(value & 0xff);
+}
+
+// Appends a Coverage table of format 1 for the first |num_glyphs| glyphs to
+// |data|, returning its offset.
+size_t AppendCoverage(std::vector<uint8_t> *data, uint16_t num_glyphs) {
+  const size_t offset = data->size();
+  AppendU16(data, 1);
+  AppendU16(data, num_glyphs);
+  for (uint16_t glyph = 0; glyph < num_glyphs; ++glyph)
+    AppendU16(data, glyph);
+  return offset;
+}
+
+}  // namespace
+
+TEST(LayoutTest, CoverageCache) {
+  // A large Coverage table, looked up in the cache, and a small one, which
+  // is quicker to validate again.
+  std::vector<uint8_t> table;
+  const size_t large = AppendCoverage(&table, 40);
+  const size_t large_length = table.size() - large;
+  const size_t small = AppendCoverage(&table, 4);
+  const size_t small_length = table.size() - small;
+
+  CountersObserver observer;
+  ots::OTSContext context;
+  ots::FontFile file;
+  file.context = &context;
+  file.observer = &observer;
+  ots::Font font(&file);
+  ots::OpenTypeGDEF gdef(&font, OTS_TAG_GDEF);
+  {
+    ots::LayoutSubtableCounter counter(&gdef, table.data(), table.size());
+    const uint8_t *data = table.data();
+
+    // The same offset of two subtables is validated once.
+    EXPECT_TRUE(ots::ParseCoverageTable(&font, data + large, large_length,
+                                        kNumGlyphs));
+    EXPECT_TRUE(ots::ParseCoverageTable(&font, data + large, large_length,
+                                        kNumGlyphs));
+
+    // Another call where it goes past the end of the subtable it is in is
+    // not taken from the cache, and fails.
+    EXPECT_FALSE(ots::ParseCoverageTable(&font, data + large,
+                                         large_length - 2, kNumGlyphs));
+
+    // Nor is it when checked against other limits.
+    EXPECT_FALSE(ots::ParseCoverageTable(&font, data + large, large_length,
+                                         20));
+
+    EXPECT_TRUE(ots::ParseCoverageTable(&font, data + small, small_length,
+                                        kNumGlyphs));
+    EXPECT_TRUE(ots::ParseCoverageTable(&font, data + small, small_length,
+                                        kNumGlyphs));
+  }
+
+  const auto it = observer.counters().find(OTS_TAG_GDEF);
+  ASSERT_NE(observer.counters().end(), it);
+  const std::map<std::string, uint64_t>& counters = it->second;
+  EXPECT_EQ(3u, counters.at("coverage_lookups"));
+  EXPECT_EQ(1u, counters.at("coverage_hits"));
+  EXPECT_EQ(0u, counters.at("class_def_lookups"));
+  EXPECT_EQ(0u, counters.count("device_lookups"));
+}
+
+TEST(LayoutTest, NoObserver) {
+  std::vector<uint8_t> table;
+  AppendCoverage(&table, 40);
+
+  ots::OTSContext context;
+  ots::FontFile file;
+  file.context = &context;
+  ots::Font font(&file);
+  ots::OpenTypeGDEF gdef(&font, OTS_TAG_GDEF);
+  ots::LayoutSubtableCounter counter(&gdef, table.data(), table.size());
+  EXPECT_TRUE(ots::ParseCoverageTable(&font, table.data(), table.size(),
+                                      kNumGlyphs));
+  EXPECT_TRUE(ots::ParseCoverageTable(&font, table.data(), table.size(),
+                                      kNumGlyphs));
+}
@@ -0,0 +1,631 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Microbenchmarks of the kernels OTS spends most of its time in, each run on
+// its own over real data taken from the test fonts, so that optimizing one of
+// them can be measured without the noise of sanitizing whole fonts. Run them
+// with `meson test --benchmark`, or directly, optionally with the names of the
+// benchmarks to run:
+//
+//   OTS_TEST_FONTS=tests/fonts ./microbench [coverage glyf ...]
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <woff2/decode.h>
+#include <woff2/output.h>
+
+#ifdef OTS_GRAPHITE
+#include "lz4.h"
+#endif
+
+#include "cff.h"
+#include "cmap.h"
+#include "glyf.h"
+#include "layout.h"
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+#include "ots.h"
+#include "test_util.h"
+
+namespace {
+
+using ots_test::QuietContext;
+using ots_test::ReadFile;
+using ots_test::ReadU16;
+using ots_test::ReadU32;
+using ots_test::TestFonts;
+
+// Each benchmark runs at least this many times, and then until it has taken
+// this long, or run that many times.
+const size_t kMinRuns = 5;
+const double kMinSeconds = 0.2;
+const size_t kMaxRuns = 100000;
+
+struct Benchmark {
+  std::string name;
+  // The number of bytes a run processes.
+  size_t bytes;
+  // Called before each run, untimed.
+  std::function<bool()> setup;
+  std::function<bool()> run;
+};
+
+// Keeps the compiler from optimizing away what the benchmarks compute.
+volatile uint32_t g_sink;
+
+const uint8_t* Bytes(const std::string& data, size_t offset = 0) {
+  return reinterpret_cast<const uint8_t*>(data.data()) + offset;
+}
+
+// A TrueType or CFF font of the test corpus, and where its tables are.
+struct SfntFont {
+  std::string name;
+  std::string data;
+  std::map<uint32_t, ots::TableEntry> tables;
+
+  std::string Table(uint32_t tag) const {
+    auto it = tables.find(tag);
+    if (it == tables.end())
+      return "";
+    return data.substr(it->second.offset, it->second.length);
+  }
+
+  size_t TableLength(uint32_t tag) const {
+    auto it = tables.find(tag);
+    return it == tables.end() ? 0 : it->second.length;
+  }
+};
+
+bool ReadSfntFont(const std::filesystem::path& path, SfntFont* font) {
+  font->name = path.filename().string();
+  font->data = ReadFile(path);
+  const uint32_t version = ReadU32(font->data, 0);
+  if (version != 0x00010000 && version != OTS_TAG('O','T','T','O'))
+    return false;
+  const uint16_t num_tables = ReadU16(font->data, 4);
+  for (unsigned i = 0; i < num_tables; ++i) {
+    const size_t record = 12 + 16 * i;
+    ots::TableEntry entry;
+    entry.tag = ReadU32(font->data, record);
+    entry.chksum = ReadU32(font->data, record + 4);
+    entry.offset = ReadU32(font->data, record + 8);
+    entry.length = ReadU32(font->data, record + 12);
+    entry.uncompressed_length = entry.length;
+    if (record + 16 > font->data.size() || entry.offset > font->data.size() ||
+        entry.length > font->data.size() - entry.offset)
+      return false;
+    font->tables[entry.tag] = entry;
+  }
+  return true;
+}
+
+std::vector<SfntFont> GoodSfntFonts() {
+  std::vector<SfntFont> fonts;
+  for (const auto& path : TestFonts({"good"})) {
+    SfntFont font;
+    if (ReadSfntFont(path, &font))
+      fonts.push_back(std::move(font));
+  }
+  return fonts;
+}
+
+// The font in which |size| is the largest, or NULL if it is 0 in all.
+const SfntFont* Largest(const std::vector<SfntFont>& fonts,
+                        const std::function<size_t(const SfntFont&)>& size) {
+  const SfntFont* largest = NULL;
+  size_t largest_size = 0;
+  for (const auto& font : fonts) {
+    const size_t font_size = size(font);
+    if (font_size > largest_size) {
+      largest = &font;
+      largest_size = font_size;
+    }
+  }
+  return largest;
+}
+
+const SfntFont* LargestTable(const std::vector<SfntFont>& fonts, uint32_t tag) {
+  return Largest(fonts, [tag](const SfntFont& font) {
+    return font.TableLength(tag);
+  });
+}
+
+// A font of its own for each run of a table parser, with the tables that
+// parser looks at already parsed, since parsing a table can modify others.
+class TableFixture {
+ public:
+  bool Reset(const SfntFont& font, const std::vector<uint32_t>& tags) {
+    file_.reset(new ots::FontFile);
+    file_->context = &context_;
+    font_ = file_->NewFont();
+    for (uint32_t tag : tags) {
+      auto it = font.tables.find(tag);
+      if (it != font.tables.end() &&
+          !font_->ParseTable(it->second, Bytes(font.data)))
+        return false;
+    }
+    return true;
+  }
+
+  ots::Font* font() { return font_; }
+
+ private:
+  QuietContext context_;
+  std::unique_ptr<ots::FontFile> file_;
+  ots::Font* font_ = NULL;
+};
+
+// Returns a table parser benchmark for the table |tag| of |font|.
+template <typename T>
+Benchmark TableBenchmark(const std::string& name, const SfntFont& font,
+                         uint32_t tag, const std::vector<uint32_t>& tags) {
+  auto fixture = std::make_shared<TableFixture>();
+  auto data = std::make_shared<std::string>(font.Table(tag));
+  Benchmark benchmark;
+  benchmark.name = name;
+  benchmark.bytes = data->size();
+  benchmark.setup = [fixture, &font, tags] {
+    return fixture->Reset(font, tags);
+  };
+  benchmark.run = [fixture, data, tag] {
+    T table(fixture->font(), tag);
+    return table.Parse(Bytes(*data), data->size());
+  };
+  return benchmark;
+}
+
+// ots::Buffer reads, over the largest glyf table.
+
+std::vector<Benchmark> BufferBenchmarks(const std::vector<SfntFont>& fonts) {
+  const SfntFont* font = LargestTable(fonts, OTS_TAG_GLYF);
+  if (!font)
+    return {};
+  auto data = std::make_shared<std::string>(font->Table(OTS_TAG_GLYF));
+
+  Benchmark u8 = {"buffer_read_u8", data->size(), nullptr, [data] {
+    ots::Buffer buffer(Bytes(*data), data->size());
+    uint32_t sum = 0;
+    uint8_t value;
+    while (buffer.ReadU8(&value))
+      sum += value;
+    g_sink = sum;
+    return true;
+  }};
+  Benchmark u16 = {"buffer_read_u16", data->size(), nullptr, [data] {
+    ots::Buffer buffer(Bytes(*data), data->size());
+    uint32_t sum = 0;
+    uint16_t value;
+    while (buffer.ReadU16(&value))
+      sum += value;
+    g_sink = sum;
+    return true;
+  }};
+  Benchmark u32 = {"buffer_read_u32", data->size(), nullptr, [data] {
+    ots::Buffer buffer(Bytes(*data), data->size());
+    uint32_t sum = 0;
+    uint32_t value;
+    while (buffer.ReadU32(&value))
+      sum += value;
+    g_sink = sum;
+    return true;
+  }};
+  auto values = std::make_shared<std::vector<uint32_t> >(data->size() / 2);
+  Benchmark u16_array = {"buffer_read_u16_array", data->size(), nullptr,
+                         [data, values] {
+    ots::Buffer buffer(Bytes(*data), data->size());
+    uint16_t* dest = reinterpret_cast<uint16_t*>(values->data());
+    if (!buffer.ReadU16Array(dest, data->size() / 2))
+      return false;
+    g_sink = dest[0];
+    return true;
+  }};
+  Benchmark u32_array = {"buffer_read_u32_array", data->size(), nullptr,
+                         [data, values] {
+    ots::Buffer buffer(Bytes(*data), data->size());
+    if (!buffer.ReadU32Array(values->data(), data->size() / 4))
+      return false;
+    g_sink = (*values)[0];
+    return true;
+  }};
+  return {u8, u16, u32, u16_array, u32_array};
+}
+
+// OTSStream::Write() and the checksum it keeps, for a table written in one
+// go and for one written a field at a time, as serializers do.
+
+std::vector<Benchmark> StreamBenchmarks(const std::vector<SfntFont>& fonts) {
+  const SfntFont* font = LargestTable(fonts, OTS_TAG_GLYF);
+  if (!font)
+    return {};
+  auto data = std::make_shared<std::string>(font->Table(OTS_TAG_GLYF));
+  data->resize(data->size() & ~size_t(3));
+  auto output = std::make_shared<std::vector<uint8_t> >(data->size());
+
+  Benchmark table = {"stream_write", data->size(), nullptr, [data, output] {
+    ots::MemoryStream stream(output->data(), output->size());
+    if (!stream.Write(data->data(), data->size()))
+      return false;
+    g_sink = stream.chksum();
+    return true;
+  }};
+  Benchmark fields = {"stream_write_u16", data->size(), nullptr,
+                      [data, output] {
+    ots::MemoryStream stream(output->data(), output->size());
+    for (size_t i = 0; i < data->size(); i += 2) {
+      if (!stream.WriteU16(ReadU16(*data, i)))
+        return false;
+    }
+    g_sink = stream.chksum();
+    return true;
+  }};
+  return {table, fields};
+}
+
+// ParseCoverageTable() and ParseClassDefTable(), on all those the lookups of
+// the font with the largest GSUB and GPOS tables point to.
+
+struct LayoutSubtables {
+  // Offsets in the table.
+  std::set<size_t> coverages;
+  std::set<size_t> class_defs;
+};
+
+void CollectLayoutSubtables(const std::string& table, bool gpos,
+                            LayoutSubtables* subtables) {
+  const uint16_t extension_type = gpos ? 9 : 7;
+  const size_t lookup_list = ReadU16(table, 8);
+  const uint16_t num_lookups = ReadU16(table, lookup_list);
+  for (unsigned i = 0; i < num_lookups; ++i) {
+    const size_t lookup = lookup_list + ReadU16(table, lookup_list + 2 + 2 * i);
+    const uint16_t lookup_type = ReadU16(table, lookup);
+    const uint16_t num_subtables = ReadU16(table, lookup + 4);
+    for (unsigned j = 0; j < num_subtables; ++j) {
+      size_t subtable = lookup + ReadU16(table, lookup + 6 + 2 * j);
+      uint16_t type = lookup_type;
+      if (type == extension_type) {
+        type = ReadU16(table, subtable + 2);
+        subtable += ReadU32(table, subtable + 4);
+      }
+      const uint16_t format = ReadU16(table, subtable);
+      // Contextual lookups of format 3 have several coverage tables, and
+      // no coverage table where the others have it.
+      const bool contextual = gpos ? (type == 7 || type == 8)
+                                   : (type == 5 || type == 6);
+      if (subtable >= table.size() || (contextual && format == 3))
+        continue;
+      subtables->coverages.insert(subtable + ReadU16(table, subtable + 2));
+      if (gpos && type == 2 && format == 2) {
+        subtables->class_defs.insert(subtable + ReadU16(table, subtable + 8));
+        subtables->class_defs.insert(subtable + ReadU16(table, subtable + 10));
+      }
+    }
+  }
+}
+
+// The number of bytes taken by the coverage or class definition table at
+// |offset|, both of which have their number of glyphs or ranges first.
+size_t LayoutSubtableLength(const std::string& table, size_t offset,
+                            bool class_def) {
+  const uint16_t format = ReadU16(table, offset);
+  if (class_def && format == 1)
+    return 6 + 2 * ReadU16(table, offset + 4);
+  return 4 + (format == 1 ? 2 : 6) * ReadU16(table, offset + 2);
+}
+
+std::vector<Benchmark> LayoutBenchmarks(const std::vector<SfntFont>& fonts) {
+  const SfntFont* font = Largest(fonts, [](const SfntFont& font) {
+    return font.TableLength(OTS_TAG_GSUB) + font.TableLength(OTS_TAG_GPOS);
+  });
+  if (!font)
+    return {};
+  const uint16_t num_glyphs = ReadU16(font->Table(OTS_TAG_MAXP), 4);
+
+  // The subtables, as their data up to the end of the table they are in.
+  typedef std::vector<std::pair<const uint8_t*, size_t> > Subtables;
+  auto tables = std::make_shared<std::vector<std::string> >();
+  tables->push_back(font->Table(OTS_TAG_GSUB));
+  tables->push_back(font->Table(OTS_TAG_GPOS));
+  auto coverages = std::make_shared<Subtables>();
+  auto class_defs = std::make_shared<Subtables>();
+  size_t coverage_bytes = 0, class_def_bytes = 0;
+  for (size_t i = 0; i < tables->size(); ++i) {
+    const std::string& table = (*tables)[i];
+    const bool gpos = i == 1;
+    LayoutSubtables subtables;
+    CollectLayoutSubtables(table, gpos, &subtables);
+    for (size_t offset : subtables.coverages) {
+      coverages->push_back(std::make_pair(Bytes(table, offset),
+                                          table.size() - offset));
+      coverage_bytes += LayoutSubtableLength(table, offset, false);
+    }
+    for (size_t offset : subtables.class_defs) {
+      class_defs->push_back(std::make_pair(Bytes(table, offset),
+                                           table.size() - offset));
+      class_def_bytes += LayoutSubtableLength(table, offset, true);
+    }
+  }
+
+  // A new font for each run, as fonts remember the subtables they have
+  // already validated.
+  auto fixture = std::make_shared<TableFixture>();
+  auto setup = [fixture, font] { return fixture->Reset(*font, {}); };
+  std::vector<Benchmark> benchmarks;
+  if (!coverages->empty()) {
+    benchmarks.push_back({"coverage", coverage_bytes, setup,
+                          [fixture, tables, coverages, num_glyphs] {
+      for (const auto& coverage : *coverages) {
+        if (!ots::ParseCoverageTable(fixture->font(), coverage.first,
+                                     coverage.second, num_glyphs))
+          return false;
+      }
+      return true;
+    }});
+  }
+  if (!class_defs->empty()) {
+    benchmarks.push_back({"class_def", class_def_bytes, setup,
+                          [fixture, tables, class_defs, num_glyphs] {
+      for (const auto& class_def : *class_defs) {
+        if (!ots::ParseClassDefTable(fixture->font(), class_def.first,
+                                     class_def.second, num_glyphs,
+                                     ots::kMaxClassDefValue))
+          return false;
+      }
+      return true;
+    }});
+  }
+  return benchmarks;
+}
+
+// Table parsers spending most of their time in one kernel: the glyf table's
+// in reading the flags and coordinates of simple glyphs, the CFF table's in
+// ExecuteCharString().
+
+std::vector<Benchmark> TableBenchmarks(const std::vector<SfntFont>& fonts) {
+  std::vector<Benchmark> benchmarks;
+  if (const SfntFont* font = LargestTable(fonts, OTS_TAG_GLYF)) {
+    benchmarks.push_back(TableBenchmark<ots::OpenTypeGLYF>(
+        "glyf", *font, OTS_TAG_GLYF,
+        {OTS_TAG_HEAD, OTS_TAG_MAXP, OTS_TAG_LOCA, OTS_TAG_NAME}));
+  }
+  if (const SfntFont* font = LargestTable(fonts, OTS_TAG_CFF)) {
+    benchmarks.push_back(TableBenchmark<ots::OpenTypeCFF>(
+        "cff_charstrings", *font, OTS_TAG_CFF, {OTS_TAG_MAXP}));
+  }
+  return benchmarks;
+}
+
+// The validation of cmap subtables of format 4 and 12, each on its own in a
+// cmap table made of the largest such subtable.
+
+// The offset of the subtable of |format| for |platform| and |encoding| in
+// |table|, or 0.
+size_t FindCmapSubtable(const std::string& table, uint16_t platform,
+                        uint16_t encoding, uint16_t format) {
+  const uint16_t num_tables = ReadU16(table, 2);
+  for (unsigned i = 0; i < num_tables; ++i) {
+    const size_t record = 4 + 8 * i;
+    const size_t offset = ReadU32(table, record + 4);
+    if (ReadU16(table, record) == platform &&
+        ReadU16(table, record + 2) == encoding &&
+        ReadU16(table, offset) == format)
+      return offset;
+  }
+  return 0;
+}
+
+std::string CmapSubtable(const SfntFont& font, uint16_t platform,
+                         uint16_t encoding, uint16_t format) {
+  const std::string table = font.Table(OTS_TAG_CMAP);
+  const size_t offset = FindCmapSubtable(table, platform, encoding, format);
+  if (!offset)
+    return "";
+  const size_t length = format == 4 ? ReadU16(table, offset + 2)
+                                    : ReadU32(table, offset + 4);
+  if (offset + length > table.size())
+    return "";
+  return table.substr(offset, length);
+}
+
+Benchmark CmapBenchmark(const std::vector<SfntFont>& fonts, uint16_t platform,
+                        uint16_t encoding, uint16_t format) {
+  const SfntFont* font = Largest(fonts, [=](const SfntFont& font) {
+    return CmapSubtable(font, platform, encoding, format).size();
+  });
+  if (!font)
+    return Benchmark();
+
+  // A cmap table with a single encoding record, for the subtable.
+  const char header[] = {0, 0, 0, 1, 0, static_cast<char>(platform),
+                         0, static_cast<char>(encoding), 0, 0, 0, 12};
+  SfntFont cmap_font = *font;
+  const std::string cmap = std::string(header, sizeof(header)) +
+      CmapSubtable(*font, platform, encoding, format);
+  ots::TableEntry& entry = cmap_font.tables[OTS_TAG_CMAP];
+  entry.offset = cmap_font.data.size();
+  entry.length = entry.uncompressed_length = cmap.size();
+  cmap_font.data += cmap;
+  auto owned_font = std::make_shared<SfntFont>(std::move(cmap_font));
+
+  Benchmark benchmark = TableBenchmark<ots::OpenTypeCMAP>(
+      "cmap_format" + std::to_string(format), *owned_font, OTS_TAG_CMAP,
+      {OTS_TAG_HEAD, OTS_TAG_MAXP, OTS_TAG_OS2});
+  // Keep the font alive as long as the benchmark.
+  auto setup = benchmark.setup;
+  benchmark.setup = [owned_font, setup] { return setup(); };
+  return benchmark;
+}
+
+std::vector<Benchmark> CmapBenchmarks(const std::vector<SfntFont>& fonts) {
+  std::vector<Benchmark> benchmarks;
+  for (const Benchmark& benchmark : {CmapBenchmark(fonts, 3, 1, 4),
+                                     CmapBenchmark(fonts, 3, 10, 12)}) {
+    if (benchmark.run)
+      benchmarks.push_back(benchmark);
+  }
+  return benchmarks;
+}
+
+// Decompression: zlib for the tables of WOFF fonts, WOFF2, and LZ4 for
+// Graphite tables.
+
+std::vector<Benchmark> DecodeBenchmarks(const std::vector<SfntFont>&) {
+  std::vector<Benchmark> benchmarks;
+
+  // The largest compressed table of the WOFF fonts.
+  auto compressed = std::make_shared<std::string>();
+  size_t uncompressed_length = 0;
+  for (const auto& path : TestFonts({"good"})) {
+    const std::string data = ReadFile(path);
+    if (ReadU32(data, 0) != OTS_TAG('w','O','F','F'))
+      continue;
+    const uint16_t num_tables = ReadU16(data, 12);
+    for (unsigned i = 0; i < num_tables; ++i) {
+      const size_t entry = 44 + 20 * i;
+      const uint32_t offset = ReadU32(data, entry + 4);
+      const uint32_t length = ReadU32(data, entry + 8);
+      const uint32_t orig_length = ReadU32(data, entry + 12);
+      if (length < orig_length && orig_length > uncompressed_length &&
+          offset <= data.size() && length <= data.size() - offset) {
+        *compressed = data.substr(offset, length);
+        uncompressed_length = orig_length;
+      }
+    }
+  }
+  if (uncompressed_length) {
+    auto output = std::make_shared<std::vector<uint8_t> >(uncompressed_length);
+    benchmarks.push_back({"zlib_decode", uncompressed_length, nullptr,
+                          [compressed, output] {
+      uLongf length = output->size();
+      return uncompress(output->data(), &length, Bytes(*compressed),
+                        compressed->size()) == Z_OK &&
+             length == output->size();
+    }});
+  }
+
+  // The largest WOFF2 font that decodes. The corpus only has WOFF2 fonts
+  // among the bad and fuzzing ones.
+  auto woff2_font = std::make_shared<std::string>();
+  size_t woff2_size = 0;
+  for (const auto& path : TestFonts()) {
+    if (path.extension() != ".woff2")
+      continue;
+    const std::string data = ReadFile(path);
+    const size_t size = woff2::ComputeWOFF2FinalSize(Bytes(data),
+                                                     data.size());
+    if (size <= woff2_size)
+      continue;
+    std::vector<uint8_t> output(size);
+    woff2::WOFF2MemoryOut out(output.data(), output.size());
+    if (woff2::ConvertWOFF2ToTTF(Bytes(data), data.size(), &out)) {
+      *woff2_font = data;
+      woff2_size = size;
+    }
+  }
+  if (woff2_size) {
+    auto output = std::make_shared<std::vector<uint8_t> >(woff2_size);
+    benchmarks.push_back({"woff2_decode", woff2_size, nullptr,
+                          [woff2_font, output] {
+      woff2::WOFF2MemoryOut out(output->data(), output->size());
+      return woff2::ConvertWOFF2ToTTF(Bytes(*woff2_font), woff2_font->size(),
+                                      &out);
+    }});
+  }
+  return benchmarks;
+}
+
+#ifdef OTS_GRAPHITE
+// There are no Graphite fonts with compressed tables in the corpus: LZ4 is
+// run on the largest glyf table, compressed.
+std::vector<Benchmark> LZ4Benchmarks(const std::vector<SfntFont>& fonts) {
+  const SfntFont* font = LargestTable(fonts, OTS_TAG_GLYF);
+  if (!font)
+    return {};
+  const std::string table = font->Table(OTS_TAG_GLYF);
+  auto lz4 = std::make_shared<std::string>(
+      LZ4_compressBound(table.size()), '\0');
+  lz4->resize(LZ4_compress_default(table.data(), &(*lz4)[0], table.size(),
+                                   lz4->size()));
+  auto output = std::make_shared<std::string>(table.size(), '\0');
+  return {{"lz4_decode", table.size(), nullptr, [lz4, output] {
+    return LZ4_decompress_safe(lz4->data(), &(*output)[0], lz4->size(),
+                               output->size()) ==
+           static_cast<int>(output->size());
+  }}};
+}
+#endif
+
+// Runs |benchmark| and prints its median time, or returns false if a run
+// failed.
+bool Run(const Benchmark& benchmark) {
+  std::vector<double> times;
+  double total = 0;
+  while (times.size() < kMinRuns ||
+         (total < kMinSeconds * 1e9 && times.size() < kMaxRuns)) {
+    if (benchmark.setup && !benchmark.setup()) {
+      std::fprintf(stderr, "%s: setup failed\n", benchmark.name.c_str());
+      return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok = benchmark.run();
+    const double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+      std::fprintf(stderr, "%s: failed\n", benchmark.name.c_str());
+      return false;
+    }
+    times.push_back(ns);
+    total += ns;
+  }
+  std::sort(times.begin(), times.end());
+  const double median = times[times.size() / 2];
+  std::printf("%-20s %12.0f [ns] %10.1f [MB/s] (%zu bytes, %zu runs)\n",
+              benchmark.name.c_str(), median,
+              median ? benchmark.bytes * 1e3 / median : 0, benchmark.bytes,
+              times.size());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const std::vector<SfntFont> fonts = GoodSfntFonts();
+  if (fonts.empty()) {
+    std::fprintf(stderr, "OTS_TEST_FONTS environment variable not set\n");
+    return 1;
+  }
+
+  std::vector<Benchmark> benchmarks;
+  for (const auto& add : {BufferBenchmarks, StreamBenchmarks,
+                          LayoutBenchmarks, TableBenchmarks, CmapBenchmarks,
+                          DecodeBenchmarks,
+#ifdef OTS_GRAPHITE
+                          LZ4Benchmarks,
+#endif
+                          }) {
+    for (Benchmark& benchmark : add(fonts))
+      benchmarks.push_back(std::move(benchmark));
+  }
+
+  const std::set<std::string> names(argv + 1, argv + argc);
+  bool ok = true;
+  for (const Benchmark& benchmark : benchmarks) {
+    if (names.empty() || names.count(benchmark.name))
+      ok &= Run(benchmark);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that the table observer of a context hears about the beginning and
+// the end of every table, about the sizes the output actually has, and about
+// each counter of a table once.
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+#include "ots-thread-pool.h"
+#include "test_util.h"
+
+namespace {
+
+using ots_test::ReadFile;
+using ots_test::ReadTestFont;
+using ots_test::ReadU32;
+using ots_test::TestFonts;
+
+// A WOFF 1.0 font with zlib compressed tables.
+const char kWOFFFont[] = "good/1232d0423fe3bb731faa3da008281ca030d3fe0a.woff";
+const char kCFFFont[] = "good/c3886b3124a97b9b9212c426c50366773e9ef10c.otf";
+
+// Returns the length of each table of an sfnt font.
+std::map<uint32_t, size_t> ReadTableLengths(const std::string& font_data) {
+  std::map<uint32_t, size_t> lengths;
+  const uint32_t num_tables = ReadU32(font_data, 4) >> 16;
+  for (uint32_t i = 0; i < num_tables; ++i) {
+    const size_t record = 12 + 16 * i;
+    lengths[ReadU32(font_data, record)] = ReadU32(font_data, record + 12);
+  }
+  return lengths;
+}
+
+class Observer : public ots::OTSTableObserver {
+ public:
+  void OnTableBegin(uint32_t tag, size_t input_bytes) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++begun_[tag];
+    input_bytes_[tag] = input_bytes;
+  }
+
+  void OnTableEnd(uint32_t tag, bool ok, size_t output_bytes,
+                  uint64_t, uint64_t serialize_ns) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++ended_[tag];
+    if (ok)
+      output_bytes_[tag] = output_bytes;
+    else
+      EXPECT_EQ(0u, serialize_ns);
+  }
+
+  void OnTableCounter(uint32_t tag, const char* name, uint64_t) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++counted_[std::make_pair(tag, std::string(name))];
+  }
+
+  const std::map<uint32_t, int>& begun() const { return begun_; }
+  const std::map<uint32_t, int>& ended() const { return ended_; }
+  const std::map<uint32_t, size_t>& input_bytes() const {
+    return input_bytes_;
+  }
+  const std::map<uint32_t, size_t>& output_bytes() const {
+    return output_bytes_;
+  }
+  // How many times each counter of each table was given.
+  const std::map<std::pair<uint32_t, std::string>, int>& counted() const {
+    return counted_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<uint32_t, int> begun_;
+  std::map<uint32_t, int> ended_;
+  std::map<uint32_t, size_t> input_bytes_;
+  std::map<uint32_t, size_t> output_bytes_;
+  std::map<std::pair<uint32_t, std::string>, int> counted_;
+};
+
+class ObservedContext : public ots::OTSContext {
+ public:
+  explicit ObservedContext(ots::OTSTableObserver* observer,
+                           ots::OTSExecutor* executor = NULL,
+                           const ots::GlyphSubset* subset = NULL)
+      : observer_(observer), executor_(executor), subset_(subset) {}
+  void Message(int, const char*, ...) override {}
+  ots::OTSTableObserver* GetTableObserver() override { return observer_; }
+  ots::OTSExecutor* GetExecutor() override { return executor_; }
+  const ots::GlyphSubset* GetGlyphSubset() override { return subset_; }
+
+ private:
+  ots::OTSTableObserver* observer_;
+  ots::OTSExecutor* executor_;
+  const ots::GlyphSubset* subset_;
+};
+
+bool Sanitize(ots::OTSContext& context, const std::string& font_data,
+              std::string* output) {
+  ots::ExpandingMemoryStream stream(font_data.size() + 1,
+                                    font_data.size() * 8 + 1);
+  const bool ok = context.Process(
+      &stream, reinterpret_cast<const uint8_t*>(font_data.data()),
+      font_data.size());
+  output->assign(static_cast<const char*>(stream.get()), stream.Tell());
+  return ok;
+}
+
+}  // namespace
+
+TEST(ObserverTest, EveryTableEnds) {
+  const std::vector<std::filesystem::path> fonts = TestFonts();
+  ASSERT_FALSE(fonts.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  ots::ThreadPool pool(4);
+  for (const auto& path : fonts) {
+    for (ots::OTSExecutor* executor : {static_cast<ots::OTSExecutor*>(NULL),
+                                       static_cast<ots::OTSExecutor*>(&pool)}) {
+      Observer observer;
+      ObservedContext context(&observer, executor);
+      const std::string font_data = ReadFile(path);
+      std::string output;
+      const bool ok = Sanitize(context, font_data, &output);
+      EXPECT_EQ(observer.begun(), observer.ended()) << path;
+
+      // Only single fonts have tables with different tags. A table that OTS
+      // adds, rather than parses, is not reported.
+      if (ReadU32(font_data, 0) == OTS_TAG('t','t','c','f'))
+        continue;
+      for (const auto& it : observer.begun())
+        EXPECT_EQ(1, it.second) << path;
+      if (ok) {
+        std::map<uint32_t, size_t> lengths = ReadTableLengths(output);
+        for (auto it = lengths.begin(); it != lengths.end();) {
+          if (observer.begun().count(it->first))
+            ++it;
+          else
+            it = lengths.erase(it);
+        }
+        EXPECT_EQ(lengths, observer.output_bytes()) << path;
+      }
+    }
+  }
+}
+
+TEST(ObserverTest, CompressedTables) {
+  const std::string font_data = ReadTestFont(kWOFFFont);
+  ASSERT_FALSE(font_data.empty());
+
+  // The input bytes are those of the table in the WOFF font, compressed.
+  std::map<uint32_t, size_t> compressed_lengths;
+  const uint32_t num_tables = ReadU32(font_data, 12) >> 16;
+  for (uint32_t i = 0; i < num_tables; ++i) {
+    const size_t entry = 44 + 20 * i;
+    compressed_lengths[ReadU32(font_data, entry)] =
+        ReadU32(font_data, entry + 8);
+  }
+
+  Observer observer;
+  ObservedContext context(&observer);
+  std::string output;
+  ASSERT_TRUE(Sanitize(context, font_data, &output));
+  ASSERT_FALSE(observer.input_bytes().empty());
+  for (const auto& it : observer.input_bytes())
+    EXPECT_EQ(compressed_lengths[it.first], it.second);
+}
+
+TEST(ObserverTest, Validate) {
+  const std::string font_data = ReadTestFont(kWOFFFont);
+  ASSERT_FALSE(font_data.empty());
+
+  Observer observer;
+  ObservedContext context(&observer);
+  const ots::ValidationResult result = context.Validate(
+      reinterpret_cast<const uint8_t*>(font_data.data()), font_data.size());
+  ASSERT_TRUE(result.ok);
+  EXPECT_EQ(observer.begun(), observer.ended());
+  EXPECT_EQ(result.num_tables, observer.output_bytes().size());
+}
+
+TEST(ObserverTest, SubsetCountsOnce) {
+  const std::string font_data = ReadTestFont(kCFFFont);
+  ASSERT_FALSE(font_data.empty());
+
+  // The subset CFF table is validated again, but was only counted once.
+  ots::GlyphSubset subset;
+  subset.glyph_ids = {1, 2, 3};
+  Observer observer;
+  ObservedContext context(&observer, NULL, &subset);
+  std::string output;
+  ASSERT_TRUE(Sanitize(context, font_data, &output));
+  const uint32_t tag = OTS_TAG('C','F','F',' ');
+  for (const char* name :
+       {"subr_calls_validated", "subr_calls_reused", "subr_calls_shared"}) {
+    const auto it = observer.counted().find(std::make_pair(tag, name));
+    ASSERT_NE(observer.counted().end(), it) << name;
+    EXPECT_EQ(1, it->second) << name;
+  }
+}
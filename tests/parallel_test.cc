@@ -0,0 +1,202 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that sanitizing with an executor gives exactly the same result as
+// the serial path.
+
+#include <cstdarg>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+#include "ots-thread-pool.h"
+#include "test_util.h"
+
+namespace {
+
+using ots_test::BuildCollection;
+using ots_test::FontTables;
+using ots_test::QuietContext;
+using ots_test::ReadFile;
+using ots_test::ReadTables;
+using ots_test::ReadTestFont;
+using ots_test::ReadU32;
+using ots_test::TestFonts;
+
+class ParallelContext : public QuietContext {
+ public:
+  explicit ParallelContext(ots::OTSExecutor* executor)
+      : executor_(executor) {}
+  ots::OTSExecutor* GetExecutor() override { return executor_; }
+
+ private:
+  ots::OTSExecutor* executor_;
+};
+
+// Keeps the messages about one table, which are given in the same order
+// whether the table is parsed serially or not.
+class TableMessagesContext : public ParallelContext {
+ public:
+  TableMessagesContext(ots::OTSExecutor* executor, const std::string& prefix)
+      : ParallelContext(executor), prefix_(prefix) {}
+
+  void Message(int level, const char* format, ...) override {
+    char message[256];
+    va_list va;
+    va_start(va, format);
+    std::vsnprintf(message, sizeof(message), format, va);
+    va_end(va);
+    if (std::string(message).compare(0, prefix_.size(), prefix_) != 0)
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    messages_.push_back(std::to_string(level) + " " + message);
+  }
+
+  const std::vector<std::string>& messages() const { return messages_; }
+
+ private:
+  const std::string prefix_;
+  std::mutex mutex_;
+  std::vector<std::string> messages_;
+};
+
+struct Result {
+  bool ok;
+  std::string output;
+};
+
+Result Sanitize(ots::OTSContext& context, const std::string& font_data) {
+  ots::ExpandingMemoryStream stream(font_data.size() + 1,
+                                    font_data.size() * 8 + 1);
+  Result result;
+  result.ok = context.Process(&stream,
+                              reinterpret_cast<const uint8_t*>(font_data.data()),
+                              font_data.size());
+  result.output.assign(static_cast<const char*>(stream.get()), stream.Tell());
+  return result;
+}
+
+void ExpectSameAsSerial(ots::OTSExecutor* executor, const std::string& name,
+                        const std::string& font_data) {
+  QuietContext serial_context;
+  ParallelContext parallel_context(executor);
+  const Result serial = Sanitize(serial_context, font_data);
+  const Result parallel = Sanitize(parallel_context, font_data);
+  EXPECT_EQ(serial.ok, parallel.ok) << name;
+  if (serial.ok && parallel.ok) {
+    EXPECT_TRUE(serial.output == parallel.output) << name;
+  }
+}
+
+void ExpectSameAsSerial(ots::OTSExecutor* executor) {
+  const std::vector<std::filesystem::path> fonts = TestFonts();
+  ASSERT_FALSE(fonts.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  for (const auto& path : fonts)
+    ExpectSameAsSerial(executor, path.string(), ReadFile(path));
+}
+
+// Checks that the messages about the table |prefix| starts them with are the
+// same, and in the same order, as in the serial path.
+void ExpectSameMessagesAsSerial(ots::OTSExecutor* executor,
+                                const char* prefix) {
+  const std::vector<std::filesystem::path> fonts = TestFonts();
+  ASSERT_FALSE(fonts.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  for (const auto& path : fonts) {
+    // The fonts of a collection are parsed concurrently, each with its own
+    // tables.
+    const std::string font_data = ReadFile(path);
+    if (ReadU32(font_data, 0) == OTS_TAG('t','t','c','f'))
+      continue;
+    // Tables are parsed concurrently too, so the serial path may not get to
+    // the table at all in a font that fails.
+    TableMessagesContext serial_context(NULL, prefix);
+    if (!Sanitize(serial_context, font_data).ok)
+      continue;
+    TableMessagesContext parallel_context(executor, prefix);
+    Sanitize(parallel_context, font_data);
+    EXPECT_EQ(serial_context.messages(), parallel_context.messages()) << path;
+  }
+}
+
+}  // namespace
+
+TEST(ParallelTest, SingleThreadMatchesSerial) {
+  ots::ThreadPool pool(1);
+  ExpectSameAsSerial(&pool);
+}
+
+TEST(ParallelTest, ThreadPoolMatchesSerial) {
+  ots::ThreadPool pool(4);
+  ExpectSameAsSerial(&pool);
+}
+
+TEST(ParallelTest, GlyfMessagesMatchSerial) {
+  ots::ThreadPool pool(4);
+  ExpectSameMessagesAsSerial(&pool, "glyf: ");
+}
+
+TEST(ParallelTest, CFFMessagesMatchSerial) {
+  ots::ThreadPool pool(4);
+  ExpectSameMessagesAsSerial(&pool, "CFF: ");
+}
+
+TEST(ParallelTest, CollectionMatchesSerial) {
+  std::vector<FontTables> good_fonts;
+  for (const auto& path : TestFonts()) {
+    if (path.parent_path().filename() != "good")
+      continue;
+    FontTables tables = ReadTables(ReadFile(path));
+    if (!tables.empty())
+      good_fonts.push_back(tables);
+  }
+  ASSERT_FALSE(good_fonts.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  ots::ThreadPool pool(4);
+  for (size_t i = 0; i + 1 < good_fonts.size(); ++i) {
+    const FontTables& a = good_fonts[i];
+    const FontTables& b = good_fonts[i + 1];
+    // A font sharing the glyphs of |a| but with its own names and mapping,
+    // the way the fonts of a collection usually differ.
+    FontTables mixed = a;
+    for (auto& table : mixed) {
+      for (const auto& other : b) {
+        if (other.first == table.first &&
+            (table.first == OTS_TAG('n','a','m','e') ||
+             table.first == OTS_TAG('c','m','a','p') ||
+             table.first == OTS_TAG('p','o','s','t')))
+          table.second = other.second;
+      }
+    }
+    ExpectSameAsSerial(&pool, "collection " + std::to_string(i),
+                       BuildCollection({a, b, mixed, a}));
+  }
+}
+
+TEST(ParallelTest, CollectionTablesSharedByTag) {
+  // As in the serial path, a later font of a collection uses the table an
+  // earlier font parsed with the same tag, even where its own is elsewhere.
+  FontTables a = ReadTables(ReadTestFont(
+      "good/00ae3c2b1b7718361fc76ee31da97253057b15b7.ttf"));
+  ASSERT_FALSE(a.empty());
+  FontTables broken = a;
+  for (auto& table : broken) {
+    if (table.first == OTS_TAG('h','e','a','d'))
+      table.second.assign(table.second.size(), '\0');
+  }
+  const std::string collection = BuildCollection({a, broken});
+
+  QuietContext serial_context;
+  const Result serial = Sanitize(serial_context, collection);
+  EXPECT_TRUE(serial.ok);
+  ots::ThreadPool pool(4);
+  ExpectSameAsSerial(&pool, "collection", collection);
+}
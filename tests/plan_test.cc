@@ -0,0 +1,142 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that OTSContext::Plan() gives the exact size of the output, and that
+// OTSContext::Emit() writes the same font as OTSContext::Process().
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+#include "test_util.h"
+
+namespace {
+
+using ots_test::BuildCollection;
+using ots_test::FontTables;
+using ots_test::QuietContext;
+using ots_test::ReadFile;
+using ots_test::ReadTables;
+using ots_test::ReadTestFont;
+using ots_test::ReadU32;
+using ots_test::TestFonts;
+
+const char kTTFFont[] = "good/db4b768546934de921667761967706f4f527a75a.ttf";
+
+struct Result {
+  bool ok;
+  std::string output;
+};
+
+// Sanitizes |font_data| with Process(), into chunks whose size is not a
+// multiple of four, so that the checksums span them.
+Result Sanitize(ots::OTSContext& context, const std::string& font_data) {
+  ots::ChunkedMemoryStream stream(font_data.size() * 8 + 1, 1001);
+  Result result;
+  result.ok = context.Process(&stream,
+                              reinterpret_cast<const uint8_t*>(font_data.data()),
+                              font_data.size());
+  result.output.resize(stream.length());
+  stream.CopyTo(&result.output[0]);
+  return result;
+}
+
+// Sanitizes |font_data| with Plan() and Emit(), into a buffer of the size
+// returned by Plan().
+Result PlanAndEmit(ots::OTSContext& context, const std::string& font_data) {
+  ots::OTSPlan plan;
+  const size_t size = context.Plan(
+      &plan, reinterpret_cast<const uint8_t*>(font_data.data()),
+      font_data.size());
+  Result result;
+  result.ok = size != 0;
+  if (result.ok) {
+    EXPECT_EQ(size, plan.size());
+    result.output.resize(size);
+    ots::MemoryStream stream(&result.output[0], size);
+    result.ok = context.Emit(&plan, &stream);
+    EXPECT_EQ(static_cast<off_t>(size), stream.Tell());
+  }
+  return result;
+}
+
+void ExpectSameAsProcess(const std::string& name,
+                         const std::string& font_data) {
+  QuietContext context;
+  const Result expected = Sanitize(context, font_data);
+  const Result planned = PlanAndEmit(context, font_data);
+  EXPECT_EQ(expected.ok, planned.ok) << name;
+  if (expected.ok && planned.ok) {
+    EXPECT_TRUE(expected.output == planned.output) << name;
+  }
+}
+
+}  // namespace
+
+TEST(PlanTest, MatchesProcess) {
+  const std::vector<std::filesystem::path> fonts = TestFonts();
+  ASSERT_FALSE(fonts.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  for (const auto& path : fonts)
+    ExpectSameAsProcess(path.string(), ReadFile(path));
+}
+
+TEST(PlanTest, CollectionMatchesProcess) {
+  std::vector<FontTables> good_fonts;
+  for (const auto& path : TestFonts()) {
+    if (path.parent_path().filename() != "good")
+      continue;
+    const std::string font_data = ReadFile(path);
+    if (ReadU32(font_data, 0) != 0x00010000)
+      continue;
+    FontTables tables = ReadTables(font_data);
+    if (!tables.empty())
+      good_fonts.push_back(tables);
+  }
+  ASSERT_FALSE(good_fonts.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  for (size_t i = 0; i + 1 < good_fonts.size(); ++i) {
+    const FontTables& a = good_fonts[i];
+    const FontTables& b = good_fonts[i + 1];
+    ExpectSameAsProcess("collection " + std::to_string(i),
+                        BuildCollection({a, b, a}));
+
+    // A font with glyphs of its own but the loca, maxp and head tables of
+    // |a|, which parsing its glyf table modifies after |a| has been
+    // serialized: Plan() cannot parse all the fonts first.
+    FontTables own_glyphs = a;
+    for (auto& table : own_glyphs) {
+      if (table.first == OTS_TAG('g','l','y','f'))
+        table.second.append(4, '\0');
+    }
+    ExpectSameAsProcess("collection with own glyphs " + std::to_string(i),
+                        BuildCollection({a, own_glyphs}));
+  }
+}
+
+TEST(PlanTest, EmitTwice) {
+  const FontTables tables = ReadTables(ReadTestFont(kTTFFont));
+  ASSERT_FALSE(tables.empty());
+
+  // Tables shared by the fonts of a collection are only written out once
+  // each time.
+  const std::string font_data = BuildCollection({tables, tables});
+  QuietContext context;
+  ots::OTSPlan plan;
+  const size_t size = context.Plan(
+      &plan, reinterpret_cast<const uint8_t*>(font_data.data()),
+      font_data.size());
+  ASSERT_NE(0u, size);
+
+  std::string first(size, '\0'), second(size, '\0');
+  ots::MemoryStream first_stream(&first[0], size);
+  ots::MemoryStream second_stream(&second[0], size);
+  ASSERT_TRUE(context.Emit(&plan, &first_stream));
+  ASSERT_TRUE(context.Emit(&plan, &second_stream));
+  EXPECT_EQ(first, second);
+}
@@ -0,0 +1,174 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Tests for the table checksum functions and the OTSStream writers that use
+// them.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+
+namespace {
+
+std::vector<uint8_t> RandomBytes(size_t length) {
+  std::vector<uint8_t> data(length);
+  for (size_t i = 0; i < length; ++i) {
+    data[i] = static_cast<uint8_t>(std::rand());
+  }
+  return data;
+}
+
+// The checksum of |data| written at |position|, one byte at a time.
+uint32_t ReferenceChecksum(const std::vector<uint8_t>& data, size_t position) {
+  uint32_t sum = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    sum += static_cast<uint32_t>(data[i]) << (8 * (3 - (position + i) % 4));
+  }
+  return sum;
+}
+
+// A stream that only supports WriteRaw(), so the default OTSStream
+// implementations of everything else are used.
+class RawStream : public ots::OTSStream {
+ public:
+  size_t size() override { return data_.max_size(); }
+
+  bool WriteRaw(const void *data, size_t length) override {
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    data_.insert(data_.end(), bytes, bytes + length);
+    return true;
+  }
+
+  bool Seek(off_t) override { return false; }
+  off_t Tell() const override { return data_.size(); }
+
+  const std::vector<uint8_t>& data() const { return data_; }
+
+ private:
+  std::vector<uint8_t> data_;
+};
+
+}  // namespace
+
+TEST(ChecksumTest, MatchesReference) {
+  for (size_t length = 0; length < 300; ++length) {
+    const std::vector<uint8_t> data = RandomBytes(length);
+    for (size_t position = 0; position < 4; ++position) {
+      const uint32_t expected = ReferenceChecksum(data, position);
+      EXPECT_EQ(expected, ots::Checksum(data.data(), length, position))
+          << "length " << length << ", position " << position;
+
+      std::vector<uint8_t> copy(length + 1, 0xff);
+      EXPECT_EQ(expected,
+                ots::Checksum(data.data(), length, position, copy.data()));
+      EXPECT_TRUE(std::equal(data.begin(), data.end(), copy.begin()));
+      EXPECT_EQ(0xff, copy[length]);
+    }
+  }
+}
+
+TEST(ChecksumTest, Words) {
+  const std::vector<uint8_t> data = RandomBytes(4 * 1000 + 3);
+  for (size_t offset = 0; offset < 4; ++offset) {
+    const std::vector<uint8_t> words(data.begin() + offset,
+                                     data.begin() + offset + 4 * 1000);
+    const uint32_t expected = ReferenceChecksum(words, 0);
+    EXPECT_EQ(expected, ots::ChecksumWords(words.data(), 1000));
+
+    std::vector<uint8_t> copy(words.size());
+    EXPECT_EQ(expected,
+              ots::CopyAndChecksumWords(copy.data(), words.data(), 1000));
+    EXPECT_EQ(words, copy);
+  }
+}
+
+TEST(StreamTest, WriteAndWriteV) {
+  const std::vector<uint8_t> data = RandomBytes(1000);
+  // Segments of assorted lengths, so that most start at unaligned offsets.
+  std::vector<ots::OTSStream::Segment> segments;
+  for (size_t offset = 0, length = 1; offset < data.size();
+       offset += length, length = length * 3 % 97 + 1) {
+    length = std::min(length, data.size() - offset);
+    segments.push_back(std::make_pair(data.data() + offset, length));
+  }
+  const uint32_t expected = ReferenceChecksum(data, 0);
+
+  std::vector<uint8_t> buffer(data.size());
+  ots::MemoryStream memory(buffer.data(), buffer.size());
+  ASSERT_TRUE(memory.WriteV(segments.data(), segments.size()));
+  EXPECT_EQ(expected, memory.chksum());
+  EXPECT_EQ(data, buffer);
+  EXPECT_FALSE(memory.Write(data.data(), 1));
+
+  ots::ExpandingMemoryStream expanding(1, data.size());
+  for (size_t i = 0; i < segments.size(); ++i) {
+    ASSERT_TRUE(expanding.Write(segments[i].first, segments[i].second));
+  }
+  EXPECT_EQ(expected, expanding.chksum());
+  EXPECT_EQ(0, std::memcmp(expanding.get(), data.data(), data.size()));
+
+  RawStream raw;
+  ASSERT_TRUE(raw.WriteU8(data[0]));
+  ASSERT_TRUE(raw.WriteV(segments.data() + 1, segments.size() - 1));
+  EXPECT_EQ(expected, raw.chksum());
+  EXPECT_EQ(data, raw.data());
+}
+
+TEST(StreamTest, ChunkedMemoryStream) {
+  const std::vector<uint8_t> data = RandomBytes(1000);
+  std::vector<ots::OTSStream::Segment> segments;
+  for (size_t offset = 0, length = 1; offset < data.size();
+       offset += length, length = length * 3 % 97 + 1) {
+    length = std::min(length, data.size() - offset);
+    segments.push_back(std::make_pair(data.data() + offset, length));
+  }
+
+  // Chunk sizes that do and do not divide the words of the checksum.
+  for (size_t chunk_size : {1, 7, 64, 4096}) {
+    ots::ChunkedMemoryStream stream(data.size(), chunk_size);
+    ASSERT_TRUE(stream.WriteV(segments.data(), segments.size()));
+    EXPECT_EQ(ReferenceChecksum(data, 0), stream.chksum());
+    EXPECT_FALSE(stream.Write(data.data(), 1));
+    ASSERT_EQ(data.size(), stream.length());
+
+    std::vector<uint8_t> copy(data.size());
+    stream.CopyTo(copy.data());
+    EXPECT_EQ(data, copy);
+
+    size_t total_length = 0;
+    for (const auto& segment : stream.Segments()) {
+      EXPECT_LE(segment.second, chunk_size);
+      total_length += segment.second;
+    }
+    EXPECT_EQ(data.size(), total_length);
+
+    // Seeking back patches what was written.
+    ASSERT_TRUE(stream.Seek(10));
+    ASSERT_TRUE(stream.WriteU32(0x01020304));
+    ASSERT_TRUE(stream.Seek(data.size()));
+    stream.CopyTo(copy.data());
+    EXPECT_EQ(0x01, copy[10]);
+    EXPECT_EQ(0x04, copy[13]);
+    EXPECT_TRUE(std::equal(copy.begin() + 14, copy.end(), data.begin() + 14));
+  }
+
+  // Seeking past the end leaves zeros behind.
+  ots::ChunkedMemoryStream stream(100, 16);
+  ASSERT_TRUE(stream.WriteU8(0xff));
+  ASSERT_TRUE(stream.Seek(40));
+  ASSERT_TRUE(stream.WriteU8(0xff));
+  EXPECT_EQ(41u, stream.length());
+  std::vector<uint8_t> copy(stream.length());
+  stream.CopyTo(copy.data());
+  EXPECT_EQ(0xff, copy.front());
+  EXPECT_EQ(0xff, copy.back());
+  EXPECT_EQ(2, std::count(copy.begin(), copy.end(), 0xff));
+  EXPECT_FALSE(stream.Seek(101));
+}
@@ -0,0 +1,192 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that OTSContext::GetGlyphSubset() removes the glyphs it does not ask
+// for, keeping the others at the same ids, and that the result is still a
+// font OTS accepts.
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+#include "test_util.h"
+
+namespace {
+
+using ots_test::BuildCollection;
+using ots_test::FindTable;
+using ots_test::FontTables;
+using ots_test::ReadFile;
+using ots_test::ReadTables;
+using ots_test::ReadTestFont;
+using ots_test::ReadU16;
+using ots_test::ReadU32;
+using ots_test::TestFonts;
+
+const char kTTFFont[] = "good/db4b768546934de921667761967706f4f527a75a.ttf";
+const char kCFFFont[] = "good/c3886b3124a97b9b9212c426c50366773e9ef10c.otf";
+const char kCFF2Font[] = "good/171ec9ef597e59a0f33cdeae1d4cf43af1d255ce.otf";
+
+class SubsetContext : public ots::OTSContext {
+ public:
+  explicit SubsetContext(const ots::GlyphSubset* subset) : subset_(subset) {}
+
+  void Message(int level, const char*, ...) override {
+    if (level > 0)
+      warnings_++;
+  }
+  const ots::GlyphSubset* GetGlyphSubset() override { return subset_; }
+
+  int warnings() const { return warnings_; }
+
+ private:
+  const ots::GlyphSubset* subset_;
+  int warnings_ = 0;
+};
+
+bool Process(const std::string& input, const ots::GlyphSubset* subset,
+             std::string* output, int* warnings = nullptr,
+             uint32_t index = -1) {
+  SubsetContext context(subset);
+  std::vector<uint8_t> buffer(input.size() * 2 + 1024);
+  ots::MemoryStream stream(buffer.data(), buffer.size());
+  if (!context.Process(&stream,
+                       reinterpret_cast<const uint8_t*>(input.data()),
+                       input.size(), index))
+    return false;
+  output->assign(reinterpret_cast<const char*>(buffer.data()), stream.Tell());
+  if (warnings)
+    *warnings = context.warnings();
+  return true;
+}
+
+// Returns the glyph the Windows Unicode BMP subtable of |font_data| maps
+// |code_point| to, or 0.
+uint32_t LookUp(const std::string& font_data, uint32_t code_point) {
+  const size_t cmap = FindTable(font_data, OTS_TAG('c','m','a','p'));
+  const uint32_t num_subtables = ReadU16(font_data, cmap + 2);
+  size_t subtable = 0;
+  for (uint32_t i = 0; i < num_subtables; ++i) {
+    const size_t record = cmap + 4 + i * 8;
+    if (ReadU16(font_data, record) == 3 &&
+        ReadU16(font_data, record + 2) == 1)
+      subtable = cmap + ReadU32(font_data, record + 4);
+  }
+  if (!subtable || ReadU16(font_data, subtable) != 4)
+    return 0;
+
+  const uint32_t segcount = ReadU16(font_data, subtable + 6) / 2;
+  const size_t end_codes = subtable + 14;
+  const size_t start_codes = end_codes + segcount * 2 + 2;
+  const size_t deltas = start_codes + segcount * 2;
+  const size_t range_offsets = deltas + segcount * 2;
+  for (uint32_t i = 0; i < segcount; ++i) {
+    const uint32_t start = ReadU16(font_data, start_codes + i * 2);
+    if (code_point < start || code_point > ReadU16(font_data, end_codes + i * 2))
+      continue;
+    const uint32_t delta = ReadU16(font_data, deltas + i * 2);
+    const uint32_t range_offset = ReadU16(font_data, range_offsets + i * 2);
+    if (!range_offset)
+      return (code_point + delta) & 0xffff;
+    const uint32_t glyph = ReadU16(
+        font_data,
+        range_offsets + i * 2 + range_offset + (code_point - start) * 2);
+    return glyph ? (glyph + delta) & 0xffff : 0;
+  }
+  return 0;
+}
+
+void CheckSubset(const char* name) {
+  const std::string input = ReadTestFont(name);
+  ASSERT_FALSE(input.empty()) << name;
+
+  std::string original;
+  ASSERT_TRUE(Process(input, nullptr, &original)) << name;
+  const uint32_t glyph_a = LookUp(original, 'A');
+  const uint32_t glyph_b = LookUp(original, 'B');
+  ASSERT_NE(0u, glyph_a) << name;
+  ASSERT_NE(0u, glyph_b) << name;
+
+  ots::GlyphSubset subset;
+  subset.code_points.push_back('A');
+  std::string output;
+  ASSERT_TRUE(Process(input, &subset, &output)) << name;
+  EXPECT_LT(output.size(), original.size()) << name;
+  EXPECT_EQ(glyph_a, LookUp(output, 'A')) << name;
+  EXPECT_EQ(0u, LookUp(output, 'B')) << name;
+
+  // Glyphs asked for by id are kept too, with their mappings.
+  subset.glyph_ids.push_back(glyph_b);
+  std::string with_b;
+  ASSERT_TRUE(Process(input, &subset, &with_b)) << name;
+  EXPECT_GT(with_b.size(), output.size()) << name;
+  EXPECT_EQ(glyph_a, LookUp(with_b, 'A')) << name;
+  EXPECT_EQ(glyph_b, LookUp(with_b, 'B')) << name;
+
+  // The subset font is still one OTS accepts as it is.
+  std::string again;
+  ASSERT_TRUE(Process(output, nullptr, &again)) << name;
+  EXPECT_EQ(output, again) << name;
+}
+
+}  // namespace
+
+TEST(SubsetTest, TrueType) {
+  CheckSubset(kTTFFont);
+}
+
+TEST(SubsetTest, CFF) {
+  CheckSubset(kCFFFont);
+}
+
+TEST(SubsetTest, CFF2) {
+  CheckSubset(kCFF2Font);
+}
+
+TEST(SubsetTest, AllGoodFonts) {
+  const std::vector<std::filesystem::path> fonts = TestFonts({"good"});
+  ASSERT_FALSE(fonts.empty());
+
+  ots::GlyphSubset subset;
+  subset.glyph_ids.push_back(1);
+  for (uint32_t cp = 'a'; cp <= 'z'; ++cp)
+    subset.code_points.push_back(cp);
+  for (const auto& path : fonts) {
+    const std::string input = ReadFile(path);
+    std::string original, output, again;
+    if (!Process(input, nullptr, &original))
+      continue;
+    ASSERT_TRUE(Process(input, &subset, &output)) << path;
+    EXPECT_LE(output.size(), original.size()) << path;
+    EXPECT_TRUE(Process(output, nullptr, &again)) << path;
+  }
+}
+
+TEST(SubsetTest, WholeCollection) {
+  // A collection of one font.
+  const std::string font = ReadTestFont(kTTFFont);
+  ASSERT_FALSE(font.empty());
+  const FontTables tables = ReadTables(font);
+  ASSERT_FALSE(tables.empty());
+  const std::string collection = BuildCollection({tables});
+
+  ots::GlyphSubset subset;
+  subset.code_points.push_back('A');
+  std::string whole, whole_unsubset, single;
+  int warnings = 0, unsubset_warnings = 0;
+  ASSERT_TRUE(Process(collection, nullptr, &whole_unsubset,
+                      &unsubset_warnings));
+  ASSERT_TRUE(Process(collection, &subset, &whole, &warnings));
+  EXPECT_EQ(whole_unsubset, whole);
+  EXPECT_EQ(unsubset_warnings + 1, warnings);
+
+  // A font taken out of it is subset.
+  ASSERT_TRUE(Process(collection, &subset, &single, nullptr, 0));
+  EXPECT_EQ(0u, LookUp(single, 'B'));
+  EXPECT_NE(0u, LookUp(single, 'A'));
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OTS_TEST_UTIL_H_
+#define OTS_TEST_UTIL_H_
+
+// Helpers shared by the tests: reading the fonts of the test corpus, and
+// taking sfnt fonts apart and building collections out of their tables.
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "opentype-sanitiser.h"
+
+namespace ots_test {
+
+inline std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream f(path, std::ifstream::binary);
+  if (!f.good())
+    return "";
+  return std::string((std::istreambuf_iterator<char>(f)),
+                     (std::istreambuf_iterator<char>()));
+}
+
+// Reads |name|, relative to the OTS_TEST_FONTS directory.
+inline std::string ReadTestFont(const char* name) {
+  const char* dir = std::getenv("OTS_TEST_FONTS");
+  if (!dir)
+    return "";
+  return ReadFile(std::filesystem::path(dir) / name);
+}
+
+// The fonts in |subdirs| of the OTS_TEST_FONTS directory, sorted.
+inline std::vector<std::filesystem::path> TestFonts(
+    std::initializer_list<const char*> subdirs = {"good", "bad", "fuzzing"}) {
+  std::vector<std::filesystem::path> fonts;
+  const char* dir = std::getenv("OTS_TEST_FONTS");
+  if (!dir)
+    return fonts;
+  for (const char* subdir : subdirs) {
+    std::filesystem::path path = std::filesystem::path(dir) / subdir;
+    if (!std::filesystem::is_directory(path))
+      continue;
+    for (const auto& entry : std::filesystem::directory_iterator(path))
+      fonts.push_back(entry.path());
+  }
+  std::sort(fonts.begin(), fonts.end());
+  return fonts;
+}
+
+// Drops the messages, and passes the bitmap tables through as ots-sanitize
+// does.
+class QuietContext : public ots::OTSContext {
+ public:
+  void Message(int, const char*, ...) override {}
+  ots::TableAction GetTableAction(uint32_t tag) override {
+    switch (tag) {
+      case OTS_TAG('C','B','D','T'):
+      case OTS_TAG('C','B','L','C'):
+      case OTS_TAG('s','b','i','x'):
+        return ots::TABLE_ACTION_PASSTHRU;
+      default:
+        return ots::TABLE_ACTION_DEFAULT;
+    }
+  }
+};
+
+inline uint16_t ReadU16(const std::string& data, size_t offset) {
+  if (offset + 2 > data.size())
+    return 0;
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data()) + offset;
+  return (p[0] << 8) | p[1];
+}
+
+inline uint32_t ReadU32(const std::string& data, size_t offset) {
+  if (offset + 4 > data.size())
+    return 0;
+  return (uint32_t(ReadU16(data, offset)) << 16) | ReadU16(data, offset + 2);
+}
+
+inline void WriteU16(std::string& data, uint16_t value) {
+  data.push_back(static_cast<char>(value >> 8));
+  data.push_back(static_cast<char>(value & 0xff));
+}
+
+inline void WriteU32(std::string& data, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8)
+    data.push_back(static_cast<char>((value >> shift) & 0xff));
+}
+
+inline void SetU32(std::string& data, size_t offset, uint32_t value) {
+  for (int i = 0; i < 4; ++i)
+    data[offset + i] = static_cast<char>((value >> (24 - 8 * i)) & 0xff);
+}
+
+// Returns the offset of the table |tag| in an sfnt font, or 0.
+inline size_t FindTable(const std::string& font_data, uint32_t tag) {
+  const uint32_t num_tables = ReadU16(font_data, 4);
+  for (uint32_t i = 0; i < num_tables; ++i) {
+    const size_t record = 12 + 16 * i;
+    if (ReadU32(font_data, record) == tag)
+      return ReadU32(font_data, record + 8);
+  }
+  return 0;
+}
+
+typedef std::vector<std::pair<uint32_t, std::string> > FontTables;
+
+// Returns the tables of an sfnt font, or nothing for anything else.
+inline FontTables ReadTables(const std::string& font_data) {
+  FontTables tables;
+  const uint32_t version = ReadU32(font_data, 0);
+  if (version != 0x00010000 && version != OTS_TAG('O','T','T','O'))
+    return tables;
+  const uint32_t num_tables = ReadU16(font_data, 4);
+  for (uint32_t i = 0; i < num_tables; ++i) {
+    const size_t record = 12 + 16 * i;
+    const uint32_t offset = ReadU32(font_data, record + 8);
+    const uint32_t length = ReadU32(font_data, record + 12);
+    if (record + 16 > font_data.size() || offset > font_data.size() ||
+        length > font_data.size() - offset)
+      return FontTables();
+    tables.push_back(std::make_pair(ReadU32(font_data, record),
+                                    font_data.substr(offset, length)));
+  }
+  return tables;
+}
+
+// Builds a collection of |fonts|, storing tables with the same data only once
+// so that the fonts share them.
+inline std::string BuildCollection(const std::vector<FontTables>& fonts) {
+  size_t offset = 12 + 4 * fonts.size();
+  std::vector<size_t> directory_offsets;
+  for (const auto& tables : fonts) {
+    directory_offsets.push_back(offset);
+    offset += 12 + 16 * tables.size();
+  }
+
+  std::string data;
+  std::map<std::string, size_t> data_offsets;
+  std::string directories;
+  for (const auto& tables : fonts) {
+    uint16_t num_tables = tables.size();
+    WriteU32(directories, 0x00010000);
+    WriteU32(directories, num_tables << 16);
+    WriteU32(directories, 0);
+    for (const auto& table : tables) {
+      auto it = data_offsets.find(table.second);
+      if (it == data_offsets.end()) {
+        while (data.size() % 4)
+          data.push_back(0);
+        it = data_offsets.insert(
+            std::make_pair(table.second, offset + data.size())).first;
+        data += table.second;
+      }
+      WriteU32(directories, table.first);
+      WriteU32(directories, 0);
+      WriteU32(directories, it->second);
+      WriteU32(directories, table.second.size());
+    }
+  }
+
+  std::string collection;
+  WriteU32(collection, OTS_TAG('t','t','c','f'));
+  WriteU32(collection, 0x00010000);
+  WriteU32(collection, fonts.size());
+  for (size_t directory_offset : directory_offsets)
+    WriteU32(collection, directory_offset);
+  return collection + directories + data;
+}
+
+}  // namespace ots_test
+
+#endif  // OTS_TEST_UTIL_H_
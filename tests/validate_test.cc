@@ -0,0 +1,188 @@
+// Copyright (c) 2026 The OTS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks that OTSContext::Validate() accepts and rejects the same fonts as
+// OTSContext::Process(), and reports which table was rejected.
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opentype-sanitiser.h"
+#include "ots-memory-stream.h"
+#include "ots-thread-pool.h"
+#include "test_util.h"
+
+namespace {
+
+using ots_test::BuildCollection;
+using ots_test::FindTable;
+using ots_test::FontTables;
+using ots_test::QuietContext;
+using ots_test::ReadFile;
+using ots_test::ReadTables;
+using ots_test::ReadTestFont;
+using ots_test::ReadU32;
+using ots_test::SetU32;
+using ots_test::TestFonts;
+using ots_test::WriteU16;
+
+const char kTTFFont[] = "good/db4b768546934de921667761967706f4f527a75a.ttf";
+// One that takes a while to parse.
+const char kLargeTTFFont[] =
+    "good/6c26e8ccc29afe595364bf649455d10dc0e39861.ttf";
+
+class ConcurrentContext : public QuietContext {
+ public:
+  explicit ConcurrentContext(ots::OTSExecutor* executor)
+      : executor_(executor) {}
+  ots::OTSExecutor* GetExecutor() override { return executor_; }
+
+ private:
+  ots::OTSExecutor* executor_;
+};
+
+// Sets the byte at |offset| in the table |tag| of |tables| to |value|.
+void SetTableByte(FontTables* tables, uint32_t tag, size_t offset,
+                  char value) {
+  for (auto& table : *tables) {
+    if (table.first == tag)
+      table.second[offset] = value;
+  }
+}
+
+ots::ValidationResult Validate(ots::OTSContext& context,
+                               const std::string& font_data) {
+  return context.Validate(reinterpret_cast<const uint8_t*>(font_data.data()),
+                          font_data.size());
+}
+
+// The number of tables in the output of Process(), or 0 if it failed.
+uint32_t NumOutputTables(ots::OTSContext& context,
+                         const std::string& font_data) {
+  ots::ExpandingMemoryStream stream(font_data.size() + 1,
+                                    font_data.size() * 8 + 1);
+  if (!context.Process(&stream,
+                       reinterpret_cast<const uint8_t*>(font_data.data()),
+                       font_data.size()))
+    return 0;
+  const std::string output(static_cast<const char*>(stream.get()),
+                           stream.Tell());
+  if (ReadU32(output, 0) != OTS_TAG('t','t','c','f'))
+    return ReadU32(output, 4) >> 16;
+  uint32_t num_tables = 0;
+  const uint32_t num_fonts = ReadU32(output, 8);
+  for (uint32_t i = 0; i < num_fonts; ++i)
+    num_tables += ReadU32(output, ReadU32(output, 12 + 4 * i) + 4) >> 16;
+  return num_tables;
+}
+
+}  // namespace
+
+TEST(ValidateTest, MatchesProcess) {
+  const std::vector<std::filesystem::path> fonts = TestFonts();
+  ASSERT_FALSE(fonts.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  for (const auto& path : fonts) {
+    const std::string font_data = ReadFile(path);
+    QuietContext context;
+    const uint32_t num_tables = NumOutputTables(context, font_data);
+    const ots::ValidationResult result = Validate(context, font_data);
+    EXPECT_EQ(num_tables != 0, result.ok) << path;
+    EXPECT_EQ(num_tables, result.num_tables) << path;
+    if (result.ok) {
+      EXPECT_EQ(0u, result.failed_table) << path;
+    } else {
+      EXPECT_EQ(0u, result.num_dropped_tables) << path;
+    }
+  }
+}
+
+TEST(ValidateTest, ReportsFailedTable) {
+  std::string font_data = ReadTestFont(kTTFFont);
+  ASSERT_FALSE(font_data.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  QuietContext context;
+  ots::ValidationResult result = Validate(context, font_data);
+  ASSERT_TRUE(result.ok);
+  EXPECT_EQ(0u, result.failed_table);
+
+  // Break the magic number of the head table.
+  const size_t head = FindTable(font_data, OTS_TAG('h','e','a','d'));
+  ASSERT_NE(0u, head);
+  font_data[head + 12] ^= 0xff;
+  result = Validate(context, font_data);
+  EXPECT_FALSE(result.ok);
+  EXPECT_EQ(OTS_TAG('h','e','a','d'), result.failed_table);
+  EXPECT_EQ(0u, result.num_tables);
+}
+
+TEST(ValidateTest, ReportsFirstFailedFont) {
+  // The first font fails on its post table, once most of its other tables
+  // are parsed, and the second one as soon as its table directory is read,
+  // which has an empty table.
+  FontTables first = ReadTables(ReadTestFont(kLargeTTFFont));
+  ASSERT_FALSE(first.empty()) << "OTS_TEST_FONTS environment variable not set";
+  FontTables second = first;
+  SetTableByte(&first, OTS_TAG('p','o','s','t'), 1, 9);  // Major version.
+  second.push_back(std::make_pair(OTS_TAG('z','z','z','z'), std::string()));
+  const std::string collection = BuildCollection({first, second});
+
+  // The table reported is that of the first font, as in a serial run,
+  // however the fonts are parsed.
+  QuietContext serial;
+  EXPECT_EQ(OTS_TAG('p','o','s','t'), Validate(serial, collection).failed_table);
+  ots::ThreadPool pool(4);
+  ConcurrentContext concurrent(&pool);
+  for (int i = 0; i < 20; ++i) {
+    const ots::ValidationResult result = Validate(concurrent, collection);
+    EXPECT_FALSE(result.ok);
+    EXPECT_EQ(OTS_TAG('p','o','s','t'), result.failed_table);
+  }
+}
+
+TEST(ValidateTest, SerializeChecks) {
+  std::string font_data = ReadTestFont(kTTFFont);
+  ASSERT_FALSE(font_data.empty()) << "OTS_TEST_FONTS environment variable not set";
+
+  // A name table whose records all point at the same long string, which
+  // takes more than the 64K of string storage once each is written out.
+  const uint16_t kNumRecords = 40;
+  const uint16_t kStringLength = 2000;
+  const uint16_t string_offset = 6 + kNumRecords * 12;
+  std::string name;
+  for (uint16_t value : {uint16_t(0), kNumRecords, string_offset})
+    WriteU16(name, value);
+  for (uint16_t i = 0; i < kNumRecords; ++i) {
+    for (uint16_t value : {uint16_t(3), uint16_t(1), uint16_t(0x409),
+                           uint16_t(256 + i), kStringLength, uint16_t(0)})
+      WriteU16(name, value);
+  }
+  name.append(kStringLength, 'a');
+
+  // It goes at the end of the font, in place of the original one.
+  const uint32_t num_tables = ReadU32(font_data, 4) >> 16;
+  bool found = false;
+  for (uint32_t i = 0; i < num_tables; ++i) {
+    const size_t record = 12 + 16 * i;
+    if (ReadU32(font_data, record) != OTS_TAG('n','a','m','e'))
+      continue;
+    font_data.append((4 - font_data.size() % 4) % 4, '\0');
+    SetU32(font_data, record + 8, font_data.size());
+    SetU32(font_data, record + 12, name.size());
+    font_data += name;
+    font_data.append((4 - font_data.size() % 4) % 4, '\0');
+    found = true;
+  }
+  ASSERT_TRUE(found);
+
+  QuietContext context;
+  EXPECT_EQ(0u, NumOutputTables(context, font_data));
+  const ots::ValidationResult result = Validate(context, font_data);
+  EXPECT_FALSE(result.ok);
+  EXPECT_EQ(OTS_TAG('n','a','m','e'), result.failed_table);
+}
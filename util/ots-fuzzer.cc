@@ -4,6 +4,9 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #ifndef OTS_FUZZER_NO_MAIN
 #include <fstream>
 #include <iostream>
@@ -27,10 +30,31 @@ class Context: public ots::OTSContext {
 // Entry point for LibFuzzer.
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   Context context;
-  ots::ExpandingMemoryStream stream(size /*initial*/, size * 8 /*limit*/);
+  ots::ChunkedMemoryStream stream(size * 8 /*limit*/);
   bool ok = context.Process(&stream, data, size);
 
   if (ok) {
+    // Plan() must tell exactly how much Emit() writes, which must be what
+    // Process() wrote.
+    ots::OTSPlan plan;
+    const size_t planned_size = context.Plan(&plan, data, size);
+    if (planned_size != stream.length()) {
+      std::abort();
+    }
+    std::vector<uint8_t> planned(planned_size);
+    ots::MemoryStream planned_stream(planned.data(), planned.size());
+    if (!context.Emit(&plan, &planned_stream)) {
+      std::abort();
+    }
+    size_t offset = 0;
+    for (const auto &segment : stream.Segments()) {
+      if (std::memcmp(planned.data() + offset, segment.first,
+                      segment.second)) {
+        std::abort();
+      }
+      offset += segment.second;
+    }
+
     ots::Buffer file(data, size);
     uint32_t tag;
     if (file.ReadU32(&tag) && tag == OTS_TAG('t','t','c','f')) {
@@ -2,13 +2,24 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <time.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <cstdio>
@@ -20,48 +31,148 @@
 
 namespace {
 
-int Usage(const char *argv0) {
-  std::fprintf(stderr, "Usage: %s <ttf file>\n", argv0);
-  return 1;
-}
+// The number of calls to operator new so far, on this thread, so that
+// counting them does not have the threads of a scaling run contend for it.
+thread_local size_t g_num_allocations = 0;
 
 }  // namespace
 
-int main(int argc, char **argv) {
-  if (argc != 2) return Usage(argv[0]);
+// Keeps the compiler from inlining operator new and delete, and then warning
+// that the malloc() and free() it sees do not match them.
+#if defined(__GNUC__)
+#define OTS_PERF_NOINLINE __attribute__((noinline))
+#else
+#define OTS_PERF_NOINLINE
+#endif
 
-  // load the font to memory.
-  std::ifstream ifs(argv[1], std::ifstream::binary);
-  if (!ifs.good()) {
-    std::fprintf(stderr, "Failed to read file!\n");
-    return 1;
+OTS_PERF_NOINLINE void* operator new(size_t size) {
+  ++g_num_allocations;
+  void *p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
   }
+  return p;
+}
 
-  std::vector<uint8_t> in((std::istreambuf_iterator<char>(ifs)),
-                          (std::istreambuf_iterator<char>()));
+OTS_PERF_NOINLINE void operator delete(void *p) noexcept {
+  std::free(p);
+}
 
-  // A transcoded font is usually smaller than an original font.
-  // However, it can be slightly bigger than the original one due to
-  // name table replacement and/or padding for glyf table.
-  std::vector<uint8_t> result(in.size() * 8);
+OTS_PERF_NOINLINE void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+}
 
-  int num_repeat = 250;
-  if (in.size() < 1024 * 1024) {
-    num_repeat = 2500;
+namespace {
+
+class PerfContext : public ots::OTSContext {
+ public:
+  explicit PerfContext(ots::OTSSession *session,
+                       ots::OTSTableObserver *observer = NULL)
+      : session_(session), observer_(observer) {}
+
+  ots::OTSSession* GetSession() override { return session_; }
+  ots::OTSTableObserver* GetTableObserver() override { return observer_; }
+
+ private:
+  ots::OTSSession *session_;
+  ots::OTSTableObserver *observer_;
+};
+
+// The session of the current thread, for a context shared by all of them.
+thread_local ots::OTSSession *t_session = NULL;
+
+class SharedPerfContext : public ots::OTSContext {
+ public:
+  ots::OTSSession* GetSession() override { return t_session; }
+};
+
+// The time spent on the tables of each tag.
+class TableTimes : public ots::OTSTableObserver {
+ public:
+  struct Times {
+    Times() : count(0), parse_ns(0), serialize_ns(0) {}
+
+    uint64_t count;
+    uint64_t parse_ns;
+    uint64_t serialize_ns;
+  };
+
+  void OnTableBegin(uint32_t, size_t) override {}
+
+  void OnTableEnd(uint32_t tag, bool, size_t,
+                  uint64_t parse_ns, uint64_t serialize_ns) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Times &times = times_[tag];
+    times.count++;
+    times.parse_ns += parse_ns;
+    times.serialize_ns += serialize_ns;
   }
-  if (in.size() < 1024 * 100) {
-    num_repeat = 5000;
+
+  const std::map<uint32_t, Times>& times() const { return times_; }
+
+ private:
+  std::mutex mutex_;
+  std::map<uint32_t, Times> times_;
+};
+
+int Usage(const char *argv0) {
+  std::fprintf(stderr,
+               "Usage: %s [options] <font file or directory>...\n"
+               "\n"
+               "Options:\n"
+               "  --list FILE       Also benchmark the fonts listed in FILE\n"
+               "  --warmup N        Untimed runs per font (default: 2)\n"
+               "  --iterations N    Timed runs per font (default: 20)\n"
+               "  --session         Reuse the memory of one session\n"
+               "                    (per thread)\n"
+               "  --threads N       Measure how throughput scales with 1, 2,\n"
+               "                    4, ... N threads sanitizing the fonts\n"
+               "  --shared-context  Share one context between the threads\n"
+               "  --csv, --json     Print the results in that format\n",
+               argv0);
+  return 1;
+}
+
+bool ReadFont(const std::string& filename, std::vector<uint8_t> *in) {
+  std::ifstream ifs(filename.c_str(), std::ifstream::binary);
+  if (!ifs.good()) {
+    return false;
+  }
+  in->assign((std::istreambuf_iterator<char>(ifs)),
+             (std::istreambuf_iterator<char>()));
+  return true;
+}
+
+// Sanitizes |in| |num_repeat| times, then prints the time and number of
+// allocations it took on average.
+bool Run(const char *filename, const std::vector<uint8_t>& in,
+         int num_repeat, ots::OTSSession *session) {
+  // Plan() tells the exact size of the transcoded font.
+  std::vector<uint8_t> result;
+  {
+    ots::OTSPlan plan;
+    PerfContext context(NULL);
+    result.resize(context.Plan(&plan, in.data(), in.size()));
+  }
+
+  if (session) {
+    // Let the session see the font once, as it would have seen others
+    // before in a long running process.
+    ots::MemoryStream output(result.data(), result.size());
+    PerfContext context(session);
+    context.Process(&output, in.data(), in.size());
   }
 
+  const size_t num_allocations = g_num_allocations;
   struct timeval start, end, elapsed;
   ::gettimeofday(&start, 0);
   for (int i = 0; i < num_repeat; ++i) {
     ots::MemoryStream output(result.data(), result.size());
-    ots::OTSContext context;
+    PerfContext context(session);
     bool r = context.Process(&output, in.data(), in.size());
     if (!r) {
       std::fprintf(stderr, "Failed to sanitize file!\n");
-      return 1;
+      return false;
     }
   }
 
@@ -70,9 +181,574 @@ int main(int argc, char **argv) {
 
   long long unsigned us
       = ((elapsed.tv_sec * 1000 * 1000) + elapsed.tv_usec) / num_repeat;
-  std::fprintf(stderr, "%llu [us] %s (%llu bytes, %llu [byte/us])\n",
-               us, argv[1], static_cast<long long>(in.size()),
-               (us ? in.size() / us : 0));
+  long long unsigned allocations
+      = (g_num_allocations - num_allocations) / num_repeat;
+  std::fprintf(stderr,
+               "%llu [us] %s%s (%llu bytes, %llu [byte/us], "
+               "%llu allocations)\n",
+               us, filename, session ? " with session" : "",
+               static_cast<long long>(in.size()),
+               (us ? in.size() / us : 0), allocations);
+  return true;
+}
+
+// Benchmarking a whole corpus of fonts, as opposed to a single one.
+
+enum Format {
+  kText,
+  kCSV,
+  kJSON,
+};
+
+struct CorpusOptions {
+  CorpusOptions()
+      : warmup(2), iterations(20), session(false), threads(0),
+        shared_context(false), format(kText) {}
+
+  int warmup;
+  int iterations;
+  bool session;
+  // The largest number of threads to scale to, or 0 not to.
+  int threads;
+  bool shared_context;
+  Format format;
+};
+
+struct FontResult {
+  std::string filename;
+  size_t bytes;
+  bool ok;
+  // Latencies, in microseconds.
+  double p50, p90, p99;
+  double megabytes_per_second;
+  long peak_rss_kb;
+  // The time spent on each table in one run, on average.
+  std::map<uint32_t, TableTimes::Times> tables;
+};
+
+// Adds |path| to |filenames|, or the files under it if it is a directory.
+void AddFiles(const std::string& path, std::vector<std::string> *filenames) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    filenames->push_back(path);
+    return;
+  }
+  DIR *dir = ::opendir(path.c_str());
+  if (!dir) {
+    return;
+  }
+  std::vector<std::string> entries;
+  while (struct dirent *entry = ::readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name != "." && name != "..") {
+      entries.push_back(path + "/" + name);
+    }
+  }
+  ::closedir(dir);
+  std::sort(entries.begin(), entries.end());
+  for (const auto& entry : entries) {
+    AddFiles(entry, filenames);
+  }
+}
+
+bool AddListedFiles(const std::string& list, std::vector<std::string> *filenames) {
+  std::ifstream ifs(list.c_str());
+  if (!ifs.good()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (!line.empty()) {
+      AddFiles(line, filenames);
+    }
+  }
+  return true;
+}
+
+long PeakRSSKB() {
+  struct rusage usage;
+  if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;  // bytes
+#else
+  return usage.ru_maxrss;  // kilobytes
+#endif
+}
+
+// The |percent|th percentile of |sorted|, by nearest rank.
+double Percentile(const std::vector<double>& sorted, int percent) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = (sorted.size() * percent + 99) / 100;
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+bool Sanitize(const std::vector<uint8_t>& in, std::vector<uint8_t> *result,
+              ots::OTSSession *session, ots::OTSTableObserver *observer) {
+  ots::MemoryStream output(result->data(), result->size());
+  PerfContext context(session, observer);
+  return context.Process(&output, in.data(), in.size());
+}
+
+// Sanitizes |in| as many times as |options| say, timing each run, then as
+// many times again with a tracing context to tell where the time goes.
+FontResult RunFont(const std::string& filename, const std::vector<uint8_t>& in,
+                   const CorpusOptions& options, ots::OTSSession *session) {
+  FontResult font;
+  font.filename = filename;
+  font.bytes = in.size();
+
+  std::vector<uint8_t> result;
+  {
+    ots::OTSPlan plan;
+    PerfContext context(NULL);
+    result.resize(context.Plan(&plan, in.data(), in.size()));
+  }
+  font.ok = !result.empty();
+
+  for (int i = 0; i < options.warmup; ++i) {
+    Sanitize(in, &result, session, NULL);
+  }
+
+  std::vector<double> latencies;
+  double total_us = 0;
+  for (int i = 0; i < options.iterations; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    Sanitize(in, &result, session, NULL);
+    const double us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+    latencies.push_back(us);
+    total_us += us;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  font.p50 = Percentile(latencies, 50);
+  font.p90 = Percentile(latencies, 90);
+  font.p99 = Percentile(latencies, 99);
+  font.megabytes_per_second = total_us ?
+      in.size() * options.iterations / total_us : 0;
+
+  TableTimes tracer;
+  for (int i = 0; i < options.iterations; ++i) {
+    Sanitize(in, &result, session, &tracer);
+  }
+  for (const auto& it : tracer.times()) {
+    TableTimes::Times& times = font.tables[it.first];
+    times.count = it.second.count / options.iterations;
+    times.parse_ns = it.second.parse_ns / options.iterations;
+    times.serialize_ns = it.second.serialize_ns / options.iterations;
+  }
+
+  font.peak_rss_kb = PeakRSSKB();
+  return font;
+}
+
+std::string TagString(uint32_t tag) {
+  std::string s;
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    const char c = static_cast<char>((tag >> shift) & 0xff);
+    s += (c >= 0x20 && c < 0x7f) ? c : '?';
+  }
+  return s;
+}
+
+std::string JSONString(const std::string& s) {
+  std::string json = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      json += '\\';
+      json += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      json += escaped;
+    } else {
+      json += c;
+    }
+  }
+  return json + "\"";
+}
+
+std::string CSVField(const std::string& s) {
+  if (s.find_first_of(",\"\n") == std::string::npos) {
+    return s;
+  }
+  std::string csv = "\"";
+  for (char c : s) {
+    if (c == '"') {
+      csv += '"';
+    }
+    csv += c;
+  }
+  return csv + "\"";
+}
+
+// Adds up the time spent on each table over all |fonts|.
+std::map<uint32_t, TableTimes::Times> TotalTableTimes(
+    const std::vector<FontResult>& fonts) {
+  std::map<uint32_t, TableTimes::Times> total;
+  for (const auto& font : fonts) {
+    for (const auto& it : font.tables) {
+      TableTimes::Times& times = total[it.first];
+      times.count += it.second.count;
+      times.parse_ns += it.second.parse_ns;
+      times.serialize_ns += it.second.serialize_ns;
+    }
+  }
+  return total;
+}
+
+void PrintText(const std::vector<FontResult>& fonts) {
+  for (const auto& font : fonts) {
+    std::printf("%s%s: %zu bytes, p50 %.1f [us], p90 %.1f [us], "
+                "p99 %.1f [us], %.1f [MB/s], peak RSS %ld [kB]\n",
+                font.filename.c_str(), font.ok ? "" : " (failed)",
+                font.bytes, font.p50, font.p90, font.p99,
+                font.megabytes_per_second, font.peak_rss_kb);
+  }
+  std::printf("\nTime per table, in all fonts:\n");
+  for (const auto& it : TotalTableTimes(fonts)) {
+    std::printf("%s: %llu tables, parse %.1f [us], serialize %.1f [us]\n",
+                TagString(it.first).c_str(),
+                static_cast<unsigned long long>(it.second.count),
+                it.second.parse_ns / 1000.0, it.second.serialize_ns / 1000.0);
+  }
+}
+
+void PrintCSV(const std::vector<FontResult>& fonts) {
+  std::printf("file,bytes,ok,p50_us,p90_us,p99_us,mb_per_s,peak_rss_kb\n");
+  for (const auto& font : fonts) {
+    std::printf("%s,%zu,%d,%.1f,%.1f,%.1f,%.2f,%ld\n",
+                CSVField(font.filename).c_str(), font.bytes, font.ok ? 1 : 0,
+                font.p50, font.p90, font.p99, font.megabytes_per_second,
+                font.peak_rss_kb);
+  }
+  std::printf("\ntag,count,parse_us,serialize_us\n");
+  for (const auto& it : TotalTableTimes(fonts)) {
+    std::printf("%s,%llu,%.1f,%.1f\n", CSVField(TagString(it.first)).c_str(),
+                static_cast<unsigned long long>(it.second.count),
+                it.second.parse_ns / 1000.0, it.second.serialize_ns / 1000.0);
+  }
+}
+
+void PrintJSONTables(const std::map<uint32_t, TableTimes::Times>& tables,
+                     const char *indent) {
+  bool first = true;
+  for (const auto& it : tables) {
+    std::printf("%s\n%s%s: {\"count\": %llu, \"parse_us\": %.1f, "
+                "\"serialize_us\": %.1f}",
+                first ? "" : ",", indent, JSONString(TagString(it.first)).c_str(),
+                static_cast<unsigned long long>(it.second.count),
+                it.second.parse_ns / 1000.0, it.second.serialize_ns / 1000.0);
+    first = false;
+  }
+}
+
+void PrintJSON(const std::vector<FontResult>& fonts) {
+  std::printf("{\n  \"fonts\": [");
+  for (size_t i = 0; i < fonts.size(); ++i) {
+    const FontResult& font = fonts[i];
+    std::printf("%s\n    {\"file\": %s, \"bytes\": %zu, \"ok\": %s, "
+                "\"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, "
+                "\"mb_per_s\": %.2f, \"peak_rss_kb\": %ld, \"tables\": {",
+                i ? "," : "", JSONString(font.filename).c_str(), font.bytes,
+                font.ok ? "true" : "false", font.p50, font.p90, font.p99,
+                font.megabytes_per_second, font.peak_rss_kb);
+    PrintJSONTables(font.tables, "      ");
+    std::printf("}}");
+  }
+  std::printf("\n  ],\n  \"tables\": {");
+  PrintJSONTables(TotalTableTimes(fonts), "    ");
+  size_t bytes = 0, num_failed = 0;
+  for (const auto& font : fonts) {
+    bytes += font.bytes;
+    num_failed += !font.ok;
+  }
+  std::printf("\n  },\n  \"summary\": {\"fonts\": %zu, \"failed\": %zu, "
+              "\"bytes\": %zu, \"peak_rss_kb\": %ld}\n}\n",
+              fonts.size(), num_failed, bytes, PeakRSSKB());
+}
+
+int RunCorpus(const std::vector<std::string>& filenames,
+              const CorpusOptions& options) {
+  ots::OTSSession session;
+  std::vector<FontResult> fonts;
+  for (const auto& filename : filenames) {
+    std::vector<uint8_t> in;
+    if (!ReadFont(filename, &in)) {
+      std::fprintf(stderr, "Failed to read %s\n", filename.c_str());
+      return 1;
+    }
+    fonts.push_back(RunFont(filename, in, options,
+                            options.session ? &session : NULL));
+  }
+
+  switch (options.format) {
+    case kText: PrintText(fonts); break;
+    case kCSV: PrintCSV(fonts); break;
+    case kJSON: PrintJSON(fonts); break;
+  }
+  return 0;
+}
+
+// Sanitizing a corpus on several threads at once.
+
+struct ScalingResult {
+  int threads;
+  double megabytes_per_second;
+  // Latencies of all the runs of all the threads, in microseconds.
+  double p50, p99;
+  // The highest 99th percentile latency of any one thread.
+  double worst_thread_p99;
+};
+
+// Runs |num_threads| threads that each sanitize the whole corpus as many
+// times as |options| say, starting at different fonts.
+ScalingResult RunThreads(const std::vector<std::vector<uint8_t> >& inputs,
+                         const std::vector<size_t>& output_sizes,
+                         const CorpusOptions& options, int num_threads) {
+  SharedPerfContext shared_context;
+  std::vector<std::vector<double> > latencies(num_threads);
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  int num_ready = 0;
+  bool started = false;
+
+  auto worker = [&](int thread_index) {
+    ots::OTSSession session;
+    t_session = options.session ? &session : NULL;
+    PerfContext own_context(t_session);
+    ots::OTSContext *context = options.shared_context ?
+        static_cast<ots::OTSContext*>(&shared_context) : &own_context;
+
+    std::vector<std::vector<uint8_t> > outputs;
+    for (size_t size : output_sizes) {
+      outputs.push_back(std::vector<uint8_t>(std::max<size_t>(size, 1)));
+    }
+    const size_t first = inputs.size() * thread_index / num_threads;
+    auto sanitize = [&](size_t i) {
+      ots::MemoryStream output(outputs[i].data(), outputs[i].size());
+      context->Process(&output, inputs[i].data(), inputs[i].size());
+    };
+
+    for (int i = 0; i < options.warmup; ++i) {
+      for (size_t j = 0; j < inputs.size(); ++j) {
+        sanitize((first + j) % inputs.size());
+      }
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ++num_ready;
+      cond.notify_all();
+      cond.wait(lock, [&] { return started; });
+    }
+
+    std::vector<double>& thread_latencies = latencies[thread_index];
+    thread_latencies.reserve(options.iterations * inputs.size());
+    for (int i = 0; i < options.iterations; ++i) {
+      for (size_t j = 0; j < inputs.size(); ++j) {
+        const auto start = std::chrono::steady_clock::now();
+        sanitize((first + j) % inputs.size());
+        thread_latencies.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+      }
+    }
+    t_session = NULL;
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(std::thread(worker, i));
+  }
+  std::chrono::steady_clock::time_point start;
+  {
+    // Start timing once all the threads are warm.
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&] { return num_ready == num_threads; });
+    started = true;
+    start = std::chrono::steady_clock::now();
+    cond.notify_all();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double total_us = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count();
+
+  size_t bytes = 0;
+  for (const auto& in : inputs) {
+    bytes += in.size();
+  }
+  ScalingResult result;
+  result.threads = num_threads;
+  result.megabytes_per_second = total_us ?
+      static_cast<double>(bytes) * options.iterations * num_threads / total_us :
+      0;
+  result.worst_thread_p99 = 0;
+  std::vector<double> all_latencies;
+  for (auto& thread_latencies : latencies) {
+    std::sort(thread_latencies.begin(), thread_latencies.end());
+    result.worst_thread_p99 = std::max(result.worst_thread_p99,
+                                       Percentile(thread_latencies, 99));
+    all_latencies.insert(all_latencies.end(), thread_latencies.begin(),
+                         thread_latencies.end());
+  }
+  std::sort(all_latencies.begin(), all_latencies.end());
+  result.p50 = Percentile(all_latencies, 50);
+  result.p99 = Percentile(all_latencies, 99);
+  return result;
+}
+
+void PrintScaling(const std::vector<ScalingResult>& results,
+                  const CorpusOptions& options, size_t num_fonts) {
+  const double single = results.empty() ? 0 : results[0].megabytes_per_second;
+  switch (options.format) {
+    case kText:
+      for (const auto& result : results) {
+        std::printf("%d threads: %.1f [MB/s] (x%.2f), p50 %.1f [us], "
+                    "p99 %.1f [us], worst thread p99 %.1f [us]\n",
+                    result.threads, result.megabytes_per_second,
+                    single ? result.megabytes_per_second / single : 0,
+                    result.p50, result.p99, result.worst_thread_p99);
+      }
+      break;
+    case kCSV:
+      std::printf("threads,mb_per_s,speedup,p50_us,p99_us,"
+                  "worst_thread_p99_us\n");
+      for (const auto& result : results) {
+        std::printf("%d,%.2f,%.2f,%.1f,%.1f,%.1f\n", result.threads,
+                    result.megabytes_per_second,
+                    single ? result.megabytes_per_second / single : 0,
+                    result.p50, result.p99, result.worst_thread_p99);
+      }
+      break;
+    case kJSON:
+      std::printf("{\n  \"shared_context\": %s,\n  \"session\": %s,\n"
+                  "  \"scaling\": [",
+                  options.shared_context ? "true" : "false",
+                  options.session ? "true" : "false");
+      for (size_t i = 0; i < results.size(); ++i) {
+        const ScalingResult& result = results[i];
+        std::printf("%s\n    {\"threads\": %d, \"mb_per_s\": %.2f, "
+                    "\"speedup\": %.2f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+                    "\"worst_thread_p99_us\": %.1f}",
+                    i ? "," : "", result.threads, result.megabytes_per_second,
+                    single ? result.megabytes_per_second / single : 0,
+                    result.p50, result.p99, result.worst_thread_p99);
+      }
+      std::printf("\n  ],\n  \"summary\": {\"fonts\": %zu, "
+                  "\"peak_rss_kb\": %ld}\n}\n",
+                  num_fonts, PeakRSSKB());
+      break;
+  }
+}
+
+int RunScaling(const std::vector<std::string>& filenames,
+               const CorpusOptions& options) {
+  std::vector<std::vector<uint8_t> > inputs;
+  std::vector<size_t> output_sizes;
+  for (const auto& filename : filenames) {
+    inputs.push_back(std::vector<uint8_t>());
+    if (!ReadFont(filename, &inputs.back())) {
+      std::fprintf(stderr, "Failed to read %s\n", filename.c_str());
+      return 1;
+    }
+    ots::OTSPlan plan;
+    PerfContext context(NULL);
+    output_sizes.push_back(context.Plan(&plan, inputs.back().data(),
+                                        inputs.back().size()));
+  }
+
+  // 1, 2, 4, ... threads, and then |options.threads| itself.
+  std::vector<ScalingResult> results;
+  for (int threads = 1; ; threads *= 2) {
+    threads = std::min(threads, options.threads);
+    results.push_back(RunThreads(inputs, output_sizes, options, threads));
+    if (threads == options.threads) {
+      break;
+    }
+  }
+  PrintScaling(results, options, inputs.size());
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  CorpusOptions options;
+  std::vector<std::string> filenames;
+  bool corpus = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--list" && i + 1 < argc) {
+      if (!AddListedFiles(argv[++i], &filenames)) {
+        std::fprintf(stderr, "Failed to read %s\n", argv[i]);
+        return 1;
+      }
+      corpus = true;
+    } else if (arg == "--warmup" && i + 1 < argc) {
+      options.warmup = std::atoi(argv[++i]);
+      corpus = true;
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      options.iterations = std::max(1, std::atoi(argv[++i]));
+      corpus = true;
+    } else if (arg == "--session") {
+      options.session = true;
+      corpus = true;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      options.threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--shared-context") {
+      options.shared_context = true;
+    } else if (arg == "--csv") {
+      options.format = kCSV;
+      corpus = true;
+    } else if (arg == "--json") {
+      options.format = kJSON;
+      corpus = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      return Usage(argv[0]);
+    } else {
+      const size_t num_files = filenames.size();
+      AddFiles(arg, &filenames);
+      // A directory, even with a single font in it, is a corpus.
+      corpus |= filenames.size() != num_files + 1 || filenames.back() != arg;
+    }
+  }
+  if (filenames.empty()) return Usage(argv[0]);
+  if (options.threads) {
+    return RunScaling(filenames, options);
+  }
+  if (corpus || filenames.size() > 1) {
+    return RunCorpus(filenames, options);
+  }
+
+  // A single font: load it to memory.
+  std::vector<uint8_t> in;
+  if (!ReadFont(filenames[0], &in)) {
+    std::fprintf(stderr, "Failed to read file!\n");
+    return 1;
+  }
+
+  int num_repeat = 250;
+  if (in.size() < 1024 * 1024) {
+    num_repeat = 2500;
+  }
+  if (in.size() < 1024 * 100) {
+    num_repeat = 5000;
+  }
+
+  if (!Run(filenames[0].c_str(), in, num_repeat, NULL)) {
+    return 1;
+  }
+
+  // Then again, reusing the memory of one session for all fonts.
+  ots::OTSSession session;
+  if (!Run(filenames[0].c_str(), in, num_repeat, &session)) {
+    return 1;
+  }
 
   return 0;
 }